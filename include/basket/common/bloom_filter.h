@@ -0,0 +1,190 @@
+/*
+ * Copyright (C) 2019  Hariharan Devarajan, Keith Bateman
+ *
+ * This file is part of Basket
+ *
+ * Basket is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/*-------------------------------------------------------------------------
+ *
+ * Created: bloom_filter.h
+ *
+ * Purpose: Defines the Bloom filter servers keep over the keys of their
+ * partition and the snapshots of it clients use to skip requests for
+ * absent keys.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef INCLUDE_BASKET_COMMON_BLOOM_FILTER_H_
+#define INCLUDE_BASKET_COMMON_BLOOM_FILTER_H_
+
+#include <basket/common/typedefs.h>
+#include <basket/common/hash.h>
+#include <basket/common/client_cache.h>
+#include <boost/interprocess/managed_mapped_file.hpp>
+#include <boost/interprocess/allocators/allocator.hpp>
+#include <boost/interprocess/containers/vector.hpp>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace basket {
+
+/**
+ * Position of probe i of a key in a filter of bits positions. The probes are
+ * derived from the routing hash by double hashing, remixed first so they do
+ * not correlate with the choice of the server.
+ */
+inline size_t BloomProbe(size_t hash, uint16_t i, size_t bits) {
+    uint64_t h1 = hashing::Mix64(hash ^ 0x5851F42D4C957F2DULL);
+    uint64_t h2 = hashing::Mix64(h1) | 1;
+    return (h1 + i * h2) % bits;
+}
+
+/**
+ * Counting Bloom filter over the keys of a server partition. It is
+ * constructed inside the mapped segment so inserts of on-node clients are
+ * counted as well. Counters saturate and then stay set, which keeps the
+ * filter free of false negatives. All methods expect the partition mutex to
+ * be held, exclusively for Add and Remove.
+ */
+class CountingBloomFilter {
+  private:
+    typedef boost::interprocess::allocator<
+        uint8_t, boost::interprocess::managed_mapped_file::segment_manager>
+    ShmemAllocator;
+    typedef boost::interprocess::vector<uint8_t, ShmemAllocator> CounterVector;
+
+    uint16_t hashes;
+    CounterVector counters;
+
+  public:
+    CountingBloomFilter(size_t bits, uint16_t hashes_,
+                        boost::interprocess::managed_mapped_file::segment_manager *manager)
+            : hashes(hashes_), counters(bits, 0, ShmemAllocator(manager)) {}
+
+    /**
+     * Count a key that was not present before.
+     * @param hash, the basket::hash of the key
+     */
+    void Add(size_t hash) {
+        for (uint16_t i = 0; i < hashes; ++i) {
+            uint8_t &counter = counters[BloomProbe(hash, i, counters.size())];
+            if (counter < UINT8_MAX) ++counter;
+        }
+    }
+
+    /**
+     * Uncount a key that was present and is gone.
+     * @param hash, the basket::hash of the key
+     */
+    void Remove(size_t hash) {
+        for (uint16_t i = 0; i < hashes; ++i) {
+            uint8_t &counter = counters[BloomProbe(hash, i, counters.size())];
+            if (counter > 0 && counter < UINT8_MAX) --counter;
+        }
+    }
+
+    /**
+     * Copy the filter as a plain bit array, one bit per counter.
+     * @return the words of the bit array
+     */
+    std::vector<uint64_t> Snapshot() const {
+        std::vector<uint64_t> words((counters.size() + 63) / 64, 0);
+        for (size_t i = 0; i < counters.size(); ++i) {
+            if (counters[i] > 0) words[i / 64] |= 1ULL << (i % 64);
+        }
+        return words;
+    }
+};
+
+/**
+ * Snapshots of the Bloom filters of all servers, kept by a client. A snapshot
+ * is used until refresh microseconds after it was fetched, so keys other
+ * processes insert meanwhile may be reported absent. Keys the client puts
+ * itself are added to its snapshot right away.
+ */
+class BloomFilterCache {
+  private:
+    struct Snapshot {
+        std::vector<uint64_t> words;
+        HTime expiry;
+    };
+    size_t bits;
+    uint16_t hashes;
+    HTime refresh;
+    std::vector<Snapshot> servers;
+    std::mutex mutex;
+
+    bool Test(const Snapshot &snapshot, size_t hash) const {
+        /* servers without a filter, or with another size, answer empty */
+        if (snapshot.words.size() != (bits + 63) / 64) return true;
+        for (uint16_t i = 0; i < hashes; ++i) {
+            size_t bit = BloomProbe(hash, i, bits);
+            if ((snapshot.words[bit / 64] & (1ULL << (bit % 64))) == 0) return false;
+        }
+        return true;
+    }
+
+  public:
+    BloomFilterCache(size_t bits_, uint16_t hashes_, HTime refresh_, uint16_t num_servers)
+            : bits(bits_), hashes(hashes_), refresh(refresh_),
+              servers(num_servers, Snapshot{std::vector<uint64_t>(), 0}), mutex() {}
+
+    bool Enabled() const { return bits > 0 && refresh > 0; }
+
+    /**
+     * Check whether server may hold a key, fetching a new snapshot of its
+     * filter first if the cached one is too old.
+     * @param server, the server the key is routed to
+     * @param hash, the basket::hash of the key
+     * @param fetch, callable returning the current bit array of server
+     * @return false if the key is absent from the snapshot, true otherwise
+     */
+    template<typename Fetch>
+    bool MayContain(uint16_t server, size_t hash, Fetch fetch) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (servers[server].expiry > LeaseClock()) {
+                return Test(servers[server], hash);
+            }
+        }
+        /* fetch without the lock, concurrent refreshes are harmless */
+        HTime start = LeaseClock();
+        std::vector<uint64_t> words = fetch();
+        std::lock_guard<std::mutex> lock(mutex);
+        servers[server] = Snapshot{std::move(words), start + refresh};
+        return Test(servers[server], hash);
+    }
+
+    /**
+     * Record a key this client put on server.
+     */
+    void Add(uint16_t server, size_t hash) {
+        std::lock_guard<std::mutex> lock(mutex);
+        Snapshot &snapshot = servers[server];
+        if (snapshot.words.size() != (bits + 63) / 64) return;
+        for (uint16_t i = 0; i < hashes; ++i) {
+            size_t bit = BloomProbe(hash, i, bits);
+            snapshot.words[bit / 64] |= 1ULL << (bit % 64);
+        }
+    }
+};
+
+}  // namespace basket
+
+#endif  // INCLUDE_BASKET_COMMON_BLOOM_FILTER_H_
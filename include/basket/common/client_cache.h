@@ -0,0 +1,253 @@
+/*
+ * Copyright (C) 2019  Hariharan Devarajan, Keith Bateman
+ *
+ * This file is part of Basket
+ * 
+ * Basket is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/*-------------------------------------------------------------------------
+ *
+ * Created: client_cache.h
+ *
+ * Purpose: Defines the client side read cache and the server side lease
+ * table used to keep the cached values fresh.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef INCLUDE_BASKET_COMMON_CLIENT_CACHE_H_
+#define INCLUDE_BASKET_COMMON_CLIENT_CACHE_H_
+
+#include <basket/common/typedefs.h>
+#include <basket/common/hash.h>
+#include <basket/common/data_structures.h>
+#include <boost/interprocess/managed_mapped_file.hpp>
+#include <boost/interprocess/allocators/allocator.hpp>
+#include <boost/interprocess/sync/interprocess_mutex.hpp>
+#include <boost/interprocess/sync/scoped_lock.hpp>
+#include <boost/unordered/unordered_map.hpp>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+namespace basket {
+
+/**
+ * Microseconds on the node wide monotonic clock. All processes of a node see
+ * the same value, which lets leases be stored in the mapped segment.
+ */
+inline HTime LeaseClock() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * Lease bookkeeping of a server partition. It is constructed inside the
+ * mapped segment so that writes of on-node clients honour the leases handed
+ * out by the server. The table has its own mutex, so readers granting
+ * leases only need to hold the partition lock shared; writers hold it
+ * exclusively while they wait. Expired leases of keys that are never
+ * written are swept out once the table doubled since the last sweep.
+ *
+ * @tparam KeyType, the key of the partition
+ */
+template<typename KeyType>
+class LeaseTable {
+  private:
+    struct Lease {
+        HTime expiry;
+        bool write_pending;
+    };
+    typedef std::pair<const KeyType, Lease> ValueType;
+    typedef boost::interprocess::allocator<
+        ValueType, boost::interprocess::managed_mapped_file::segment_manager>
+    ShmemAllocator;
+    typedef boost::unordered::unordered_map<KeyType, Lease, basket::hash<KeyType>,
+                                            std::equal_to<KeyType>,
+                                            ShmemAllocator> LeaseMap;
+    static constexpr size_t MIN_SWEEP = 64;
+
+    HTime lease_time;
+    LeaseMap leases;
+    size_t sweep_at;
+    boost::interprocess::interprocess_mutex mutex;
+
+    /* drop the leases that expired, the table mutex must be held */
+    void Sweep(HTime now) {
+        for (auto iterator = leases.begin(); iterator != leases.end();) {
+            if (iterator->second.expiry <= now) {
+                iterator = leases.erase(iterator);
+            } else {
+                ++iterator;
+            }
+        }
+        sweep_at = std::max(MIN_SWEEP, 2 * leases.size());
+    }
+
+  public:
+    LeaseTable(HTime lease_time_,
+               boost::interprocess::managed_mapped_file::segment_manager *manager)
+            : lease_time(lease_time_),
+              leases(16, basket::hash<KeyType>(), std::equal_to<KeyType>(),
+                     ShmemAllocator(manager)),
+              sweep_at(MIN_SWEEP), mutex() {}
+
+    size_t Size() {
+        boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex> lock(mutex);
+        return leases.size();
+    }
+
+    /**
+     * Grant a lease on key to a reader.
+     * @return the remaining lease in microseconds, 0 if no lease was granted.
+     * An active lease is never extended and no lease is given out while a
+     * writer waits, so writers wait for at most one lease period.
+     */
+    HTime Grant(const KeyType &key) {
+        HTime now = LeaseClock();
+        boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex> lock(mutex);
+        auto iterator = leases.find(key);
+        if (iterator == leases.end()) {
+            if (leases.size() >= sweep_at) Sweep(now);
+            leases.emplace(key, Lease{now + lease_time, false});
+            return lease_time;
+        }
+        if (iterator->second.write_pending) return 0;
+        if (iterator->second.expiry <= now) {
+            iterator->second.expiry = now + lease_time;
+            return lease_time;
+        }
+        return iterator->second.expiry - now;
+    }
+
+    /**
+     * Whether a lease on key is live, so a client may serve key from its
+     * cache.
+     */
+    bool Leased(const KeyType &key) {
+        boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex> lock(mutex);
+        auto iterator = leases.find(key);
+        return iterator != leases.end() && iterator->second.expiry > LeaseClock();
+    }
+
+    /**
+     * Block the writer of key until every lease on key expired. The
+     * partition lock, held exclusively, is released while sleeping.
+     */
+    template<typename Lock>
+    void WaitForWrite(Lock &lock, const KeyType &key) {
+        while (true) {
+            HTime remaining;
+            {
+                boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex>
+                        table_lock(mutex);
+                auto iterator = leases.find(key);
+                if (iterator == leases.end()) return;
+                HTime now = LeaseClock();
+                if (iterator->second.expiry <= now) {
+                    leases.erase(iterator);
+                    return;
+                }
+                iterator->second.write_pending = true;
+                remaining = iterator->second.expiry - now;
+            }
+            lock.unlock();
+            usleep(remaining);
+            lock.lock();
+        }
+    }
+};
+
+/**
+ * Bounded LRU cache kept by clients in front of remote Gets. Entries are
+ * served only until the lease granted by the owning server runs out.
+ *
+ * @tparam KeyType, the key of the container
+ * @tparam MappedType, the value of the container
+ */
+template<typename KeyType, typename MappedType>
+class ClientCache {
+  private:
+    typedef std::pair<KeyType, std::pair<MappedType, HTime>> Entry;
+    typedef std::list<Entry> EntryList;
+    size_t capacity;
+    EntryList entries;
+    std::unordered_map<KeyType, typename EntryList::iterator> index;
+    std::mutex mutex;
+
+  public:
+    explicit ClientCache(size_t capacity_) : capacity(capacity_), entries(),
+                                             index(), mutex() {}
+
+    bool Enabled() const { return capacity > 0; }
+
+    /**
+     * Get the cached value of key.
+     * @return an Optional holding the value, empty on a miss or if the lease
+     * of the entry expired.
+     */
+    Optional<MappedType> Get(KeyType &key) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto iterator = index.find(key);
+        if (iterator == index.end()) {
+            return Optional<MappedType>();
+        }
+        if (iterator->second->second.second <= LeaseClock()) {
+            entries.erase(iterator->second);
+            index.erase(iterator);
+            return Optional<MappedType>();
+        }
+        entries.splice(entries.begin(), entries, iterator->second);
+        return Optional<MappedType>(iterator->second->second.first);
+    }
+
+    /**
+     * Cache data for key until expiry, evicting the least recently used
+     * entry if the cache is full.
+     */
+    void Put(KeyType &key, MappedType &data, HTime expiry) {
+        if (!Enabled()) return;
+        std::lock_guard<std::mutex> lock(mutex);
+        auto iterator = index.find(key);
+        if (iterator != index.end()) {
+            entries.erase(iterator->second);
+            index.erase(iterator);
+        } else if (entries.size() >= capacity) {
+            index.erase(entries.back().first);
+            entries.pop_back();
+        }
+        entries.emplace_front(key, std::make_pair(data, expiry));
+        index.emplace(key, entries.begin());
+    }
+
+    void Erase(KeyType &key) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto iterator = index.find(key);
+        if (iterator != index.end()) {
+            entries.erase(iterator->second);
+            index.erase(iterator);
+        }
+    }
+};
+
+}  // namespace basket
+
+#endif  // INCLUDE_BASKET_COMMON_CLIENT_CACHE_H_
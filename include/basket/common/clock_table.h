@@ -0,0 +1,209 @@
+/*
+ * Copyright (C) 2019  Hariharan Devarajan, Keith Bateman
+ *
+ * This file is part of Basket
+ * 
+ * Basket is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+
+/*-------------------------------------------------------------------------
+ *
+ * Created: clock_table.h
+ *
+ * Purpose: Defines the expiry and eviction bookkeeping of a partition used
+ * as a cache.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef INCLUDE_BASKET_COMMON_CLOCK_TABLE_H_
+#define INCLUDE_BASKET_COMMON_CLOCK_TABLE_H_
+
+#include <basket/common/typedefs.h>
+#include <basket/common/hash.h>
+#include <basket/common/data_structures.h>
+#include <boost/interprocess/managed_mapped_file.hpp>
+#include <boost/interprocess/allocators/allocator.hpp>
+#include <boost/interprocess/containers/vector.hpp>
+#include <boost/unordered/unordered_map.hpp>
+#include <algorithm>
+#include <functional>
+#include <utility>
+
+namespace basket {
+
+/**
+ * CLOCK approximation of LRU over the keys of a partition, together with
+ * their expiry time. Keys sit in a ring of slots with a reference bit that
+ * reads set; the hand clears set bits and evicts the first key found
+ * unreferenced. It is constructed inside the mapped segment so accesses of
+ * on-node clients count as well. Touch and Expired may run under the shared
+ * partition lock, all other methods expect it held exclusively.
+ *
+ * @tparam KeyType, the key of the partition
+ */
+template<typename KeyType>
+class ClockTable {
+  private:
+    struct Slot {
+        KeyType key;
+        HTime expiry;  // 0 if the key never expires
+        uint8_t referenced;
+        bool used;
+    };
+    typedef boost::interprocess::managed_mapped_file::segment_manager SegmentManager;
+    typedef boost::interprocess::allocator<Slot, SegmentManager> SlotAllocator;
+    typedef boost::interprocess::vector<Slot, SlotAllocator> SlotVector;
+    typedef boost::interprocess::allocator<size_t, SegmentManager> FreeAllocator;
+    typedef boost::interprocess::vector<size_t, FreeAllocator> FreeVector;
+    typedef std::pair<const KeyType, size_t> IndexValue;
+    typedef boost::interprocess::allocator<IndexValue, SegmentManager> IndexAllocator;
+    typedef boost::unordered::unordered_map<KeyType, size_t, basket::hash<KeyType>,
+                                            std::equal_to<KeyType>,
+                                            IndexAllocator> IndexMap;
+    SlotVector slots;
+    FreeVector free_slots;
+    IndexMap index;
+    size_t hand, sweep_hand;
+
+    static bool IsExpired(const Slot &slot, HTime now) {
+        return slot.expiry != 0 && slot.expiry <= now;
+    }
+
+    void Release(size_t position) {
+        index.erase(slots[position].key);
+        slots[position].used = false;
+        free_slots.push_back(position);
+    }
+
+  public:
+    explicit ClockTable(SegmentManager *manager)
+            : slots(SlotAllocator(manager)), free_slots(FreeAllocator(manager)),
+              index(16, basket::hash<KeyType>(), std::equal_to<KeyType>(),
+                    IndexAllocator(manager)),
+              hand(0), sweep_hand(0) {}
+
+    size_t Size() const { return index.size(); }
+
+    /**
+     * Track key until expiry, or refresh it if it is tracked already. New
+     * keys start unreferenced, so a scan of one-off keys cannot push out the
+     * keys that are read again. Space is reserved before the slot is
+     * touched, so a failed allocation leaves the table unchanged.
+     */
+    void Insert(const KeyType &key, HTime expiry) {
+        auto iterator = index.find(key);
+        if (iterator != index.end()) {
+            slots[iterator->second].expiry = expiry;
+            slots[iterator->second].referenced = 1;
+            return;
+        }
+        size_t position = slots.size();
+        if (free_slots.empty()) {
+            slots.reserve(std::max<size_t>(16, slots.size() * 2));
+            free_slots.reserve(slots.capacity());
+            index.emplace(key, position);
+            slots.push_back(Slot{key, expiry, 0, true});
+        } else {
+            position = free_slots.back();
+            index.emplace(key, position);
+            free_slots.pop_back();
+            slots[position] = Slot{key, expiry, 0, true};
+        }
+    }
+
+    void Erase(const KeyType &key) {
+        auto iterator = index.find(key);
+        if (iterator != index.end()) Release(iterator->second);
+    }
+
+    /**
+     * Record a read of key.
+     * @return false if key expired, true otherwise
+     */
+    bool Touch(const KeyType &key, HTime now) {
+        auto iterator = index.find(key);
+        if (iterator == index.end()) return true;
+        Slot &slot = slots[iterator->second];
+        if (IsExpired(slot, now)) return false;
+        __atomic_store_n(&slot.referenced, 1, __ATOMIC_RELAXED);
+        return true;
+    }
+
+    bool Expired(const KeyType &key, HTime now) const {
+        auto iterator = index.find(key);
+        return iterator != index.end() && IsExpired(slots[iterator->second], now);
+    }
+
+    /**
+     * Advance the hand to the next key to evict and stop tracking it. The
+     * hand takes the first key it reaches that is expired or unreferenced;
+     * referenced keys get a second chance and keys pinned returns true for
+     * are passed over.
+     * @return the evicted key, empty if every key is pinned
+     */
+    template<typename Pinned>
+    Optional<KeyType> Victim(HTime now, Pinned pinned) {
+        /* the first round clears every reference bit, so after two rounds
+           only pinned keys are left */
+        for (size_t step = 0; !index.empty() && step < 2 * slots.size(); ++step) {
+            if (hand >= slots.size()) hand = 0;
+            size_t position = hand++;
+            Slot &slot = slots[position];
+            if (!slot.used) continue;
+            if (!IsExpired(slot, now) &&
+                __atomic_exchange_n(&slot.referenced, 0, __ATOMIC_RELAXED)) {
+                continue;
+            }
+            if (pinned(static_cast<const KeyType &>(slot.key))) continue;
+            Optional<KeyType> victim(slot.key);
+            Release(position);
+            return victim;
+        }
+        return Optional<KeyType>();
+    }
+
+    Optional<KeyType> Victim(HTime now) {
+        return Victim(now, [](const KeyType &) { return false; });
+    }
+
+    /**
+     * Stop tracking the expired keys among the next budget slots of the
+     * sweep, calling erase on each of them. Keys pinned returns true for
+     * are kept for a later sweep.
+     * @return the number of slots examined
+     */
+    template<typename Pinned, typename Erase>
+    size_t Expire(HTime now, size_t budget, Pinned pinned, Erase erase) {
+        size_t examined = std::min(budget, slots.size());
+        for (size_t i = 0; i < examined; ++i) {
+            if (sweep_hand >= slots.size()) sweep_hand = 0;
+            size_t position = sweep_hand++;
+            if (slots[position].used && IsExpired(slots[position], now) &&
+                !pinned(static_cast<const KeyType &>(slots[position].key))) {
+                erase(slots[position].key);
+                Release(position);
+            }
+        }
+        return examined;
+    }
+
+    size_t Slots() const { return slots.size(); }
+};
+
+}  // namespace basket
+
+#endif  // INCLUDE_BASKET_COMMON_CLOCK_TABLE_H_
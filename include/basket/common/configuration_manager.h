@@ -53,12 +53,36 @@ namespace basket{
         CharStruct SERVER_LIST_PATH;
         std::vector<CharStruct> SERVER_LIST;
         CharStruct BACKED_FILE_DIR;
+        really_long CLIENT_CACHE_SIZE;  // entries cached by clients, 0 disables
+        HTime CLIENT_CACHE_LEASE;  // lease granted by servers, in microseconds, kept only if CLIENT_CACHE_SIZE > 0
+        uint32_t HOT_KEY_CAPACITY;  // hot keys tracked per partition, 0 disables
+        uint16_t SCAN_THREADS;  // threads a server uses to scan its partition
+        uint32_t SCAN_PAGE_SIZE;  // elements an ordered scan pulls from a server at once
+        bool CACHE_MODE;  // expire and evict unordered_map entries like a cache
+        HTime CACHE_TTL;  // default lifetime of cached entries in microseconds, 0 never expires
+        double CACHE_HIGH_WATER;  // fraction of the segment in use before entries are evicted
+        HTime CACHE_SWEEP_INTERVAL;  // microseconds between sweeps of expired entries, 0 disables
+        uint32_t BLOOM_FILTER_BITS;  // bits of the per partition Bloom filter, 0 disables
+        uint16_t BLOOM_FILTER_HASHES;  // probes per key in the Bloom filter
+        HTime BLOOM_FILTER_REFRESH;  // microseconds clients use a filter snapshot, 0 disables
+        HTime LONG_POLL_TIMEOUT;  // microseconds a server holds a remote wait, up to RPC_THREADS - 1 at once
+        uint32_t STEAL_BATCH;  // most elements PopAny steals from another server at once
+        uint32_t QUEUE_RING_CAPACITY;  // slots of the lock free queue backend, 0 uses a deque
+        uint32_t QUEUE_CAPACITY;  // elements per queue and priority_queue partition, 0 is unbounded
+        QueueFullPolicy QUEUE_FULL_POLICY;  // whether Push fails or blocks on a full partition
+        HTime TOP_CACHE_REFRESH;  // microseconds clients use a cached priority_queue top, 0 until they pop or push there
 
         bool DYN_CONFIG;  // Does not do anything (yet)
 
       ConfigurationManager():
               SERVER_LIST(),
               BACKED_FILE_DIR("/dev/shm"),
+              CLIENT_CACHE_SIZE(0), CLIENT_CACHE_LEASE(1000), HOT_KEY_CAPACITY(0),
+              SCAN_THREADS(4), SCAN_PAGE_SIZE(128), CACHE_MODE(false), CACHE_TTL(0), CACHE_HIGH_WATER(0.9),
+              CACHE_SWEEP_INTERVAL(1000000), BLOOM_FILTER_BITS(0), BLOOM_FILTER_HASHES(4),
+              BLOOM_FILTER_REFRESH(100000), LONG_POLL_TIMEOUT(100000),
+              STEAL_BATCH(64), QUEUE_RING_CAPACITY(0), QUEUE_CAPACITY(0),
+              QUEUE_FULL_POLICY(QUEUE_FULL_FAIL), TOP_CACHE_REFRESH(0),
               MEMORY_ALLOCATED(1024ULL * 1024ULL * 128ULL),
               RPC_PORT(8080), RPC_THREADS(1),
 #if defined(BASKET_ENABLE_RPCLIB)
@@ -26,6 +26,8 @@
 const uint16_t RPC_PORT = 8080;
 const uint16_t RPC_THREADS = 1;
 const int TEST_REQUEST_SIZE = 1000;
+const size_t SCAN_ENTRIES_PER_THREAD = 4096;
+const size_t CACHE_SWEEP_BATCH = 4096;
 const CharStruct PATH_SEPARATOR = "/";
 
 #endif  // INCLUDE_BASKET_COMMON_CONSTANTS_H_
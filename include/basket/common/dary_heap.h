@@ -0,0 +1,183 @@
+/*
+ * Copyright (C) 2019  Hariharan Devarajan, Keith Bateman
+ *
+ * This file is part of Basket
+ *
+ * Basket is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/*-------------------------------------------------------------------------
+ *
+ * Created: dary_heap.h
+ *
+ * Purpose: Defines the d-ary heap behind priority_queue partitions.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef INCLUDE_BASKET_COMMON_DARY_HEAP_H_
+#define INCLUDE_BASKET_COMMON_DARY_HEAP_H_
+
+#include <boost/interprocess/managed_mapped_file.hpp>
+#include <boost/interprocess/allocators/allocator.hpp>
+#include <boost/interprocess/containers/vector.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <queue>
+#include <utility>
+#include <vector>
+
+namespace basket {
+
+/**
+ * Heap with Arity children per node, living in a mapped segment. The
+ * children of a node are adjacent, so with four or eight of them a sift
+ * down compares a whole cache line of children per level and the tree is
+ * half or a third as deep as a binary heap. It orders like
+ * std::priority_queue: top is an element no other element compares greater
+ * than under Compare.
+ *
+ * @tparam T, the element type
+ * @tparam Compare, the strict weak order, less gives a max heap
+ * @tparam Arity, the children per node
+ */
+template<typename T, typename Compare = std::less<T>, size_t Arity = 4>
+class DaryHeap {
+  private:
+    typedef boost::interprocess::allocator<
+        T, boost::interprocess::managed_mapped_file::segment_manager>
+    ShmemAllocator;
+    typedef boost::interprocess::vector<T, ShmemAllocator> Container;
+
+    Compare compare;
+    Container heap;
+
+    static size_t Parent(size_t index) { return (index - 1) / Arity; }
+
+    static size_t FirstChild(size_t index) { return index * Arity + 1; }
+
+    /* index of the best child of index, which must have one */
+    size_t BestChild(size_t index) const {
+        size_t first = FirstChild(index);
+        size_t last = std::min(first + Arity, heap.size());
+        size_t best = first;
+        for (size_t child = first + 1; child < last; ++child) {
+            if (compare(heap[best], heap[child])) best = child;
+        }
+        return best;
+    }
+
+    /* move the element at index up to its place, shifting parents down */
+    void SiftUp(size_t index) {
+        T value = std::move(heap[index]);
+        while (index > 0 && compare(heap[Parent(index)], value)) {
+            heap[index] = std::move(heap[Parent(index)]);
+            index = Parent(index);
+        }
+        heap[index] = std::move(value);
+    }
+
+    /* move the element at index down to its place, shifting children up */
+    void SiftDown(size_t index) {
+        T value = std::move(heap[index]);
+        while (FirstChild(index) < heap.size()) {
+            size_t child = BestChild(index);
+            if (!compare(value, heap[child])) break;
+            heap[index] = std::move(heap[child]);
+            index = child;
+        }
+        heap[index] = std::move(value);
+    }
+
+  public:
+    DaryHeap(const Compare &compare_,
+             boost::interprocess::managed_mapped_file::segment_manager *manager)
+            : compare(compare_), heap(ShmemAllocator(manager)) {}
+
+    bool empty() const { return heap.empty(); }
+
+    size_t size() const { return heap.size(); }
+
+    const T &top() const { return heap.front(); }
+
+    void push(T &&value) {
+        heap.push_back(std::move(value));
+        SiftUp(heap.size() - 1);
+    }
+
+    void pop() {
+        if (heap.size() > 1) heap.front() = std::move(heap.back());
+        heap.pop_back();
+        if (!heap.empty()) SiftDown(0);
+    }
+
+    /**
+     * Move the top out of the heap and remove it.
+     */
+    T pop_top() {
+        T value = std::move(heap.front());
+        pop();
+        return value;
+    }
+
+    /**
+     * Move a range of elements into the heap. A range larger than the heap
+     * is appended and the whole heap rebuilt bottom up in linear time,
+     * a smaller one is sifted up element by element. Room is made
+     * geometrically, so a stream of small batches stays amortized linear.
+     */
+    template<typename Iterator>
+    void push_n(Iterator first, Iterator last) {
+        size_t old_size = heap.size();
+        size_t needed = old_size + std::distance(first, last);
+        if (needed > heap.capacity()) heap.reserve(std::max(needed, 2 * heap.capacity()));
+        for (; first != last; ++first) heap.push_back(std::move(*first));
+        size_t added = heap.size() - old_size;
+        if (added > old_size) {
+            if (heap.size() < 2) return;
+            for (size_t index = Parent(heap.size() - 1) + 1; index-- > 0;) SiftDown(index);
+        } else {
+            for (size_t index = old_size; index < heap.size(); ++index) SiftUp(index);
+        }
+    }
+
+    /**
+     * Copy the k best elements, best first, without removing them. The heap
+     * is walked from the root, so only those elements and their children
+     * are compared.
+     */
+    std::vector<T> top_n(size_t k) const {
+        auto lower = [this](size_t a, size_t b) { return compare(heap[a], heap[b]); };
+        std::priority_queue<size_t, std::vector<size_t>, decltype(lower)> frontier(lower);
+        std::vector<T> values;
+        values.reserve(std::min(k, heap.size()));
+        if (!heap.empty()) frontier.push(0);
+        while (values.size() < k && !frontier.empty()) {
+            size_t index = frontier.top();
+            frontier.pop();
+            values.push_back(heap[index]);
+            size_t last = std::min(FirstChild(index) + Arity, heap.size());
+            for (size_t child = FirstChild(index); child < last; ++child) {
+                frontier.push(child);
+            }
+        }
+        return values;
+    }
+};
+
+}  // namespace basket
+
+#endif  // INCLUDE_BASKET_COMMON_DARY_HEAP_H_
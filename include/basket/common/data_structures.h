@@ -35,10 +35,17 @@
 #include <boost/interprocess/containers/string.hpp>
 #include <boost/interprocess/containers/vector.hpp>
 
+#include <basket/common/hash.h>
+#include <basket/common/serialization.h>
+
 #ifdef BASKET_ENABLE_RPCLIB
 #include <rpc/msgpack.hpp>
 #endif
 
+#include <algorithm>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
 #include <string>
 #include <vector>
 #include <cstdint>
@@ -46,112 +53,200 @@
 
 namespace bip = boost::interprocess;
 
-typedef struct CharStruct {
+/**
+ * Fixed capacity string used for names and as a key in shared memory. It
+ * stores its length and hash next to the characters, so size(), hashing and
+ * comparisons never scan the string. The object holds no pointers and can be
+ * copied into mapped segments as is.
+ *
+ * @tparam N, the inline capacity including the terminating null. Longer
+ * strings are refused with std::length_error rather than cut, since two
+ * keys sharing their first N - 1 characters would then collide.
+ */
+template<size_t N>
+struct BasicCharStruct {
+    static_assert(N > 0 && N <= UINT32_MAX, "invalid BasicCharStruct capacity");
   private:
-    char value[256];
-    void Set(char* data_, size_t size) {
-        snprintf(this->value, size+1, "%s", data_);
+    size_t hash_;
+    uint32_t length_;
+    char value[N];
+
+    void Set(const char* data_, size_t size) {
+        if (size > N - 1) {
+            throw std::length_error("basket::BasicCharStruct<" + std::to_string(N) +
+                                    ">: " + std::to_string(size) +
+                                    " characters exceed the capacity");
+        }
+        memcpy(this->value, data_, size);
+        this->value[size] = '\0';
+        this->length_ = static_cast<uint32_t>(size);
+        this->hash_ = basket::hashing::HashBytes(this->value, size);
     }
-    void Set(std::string data_) {
-        snprintf(this->value, data_.length()+1, "%s", data_.c_str());
+    int Compare(const BasicCharStruct &o) const {
+        int c = memcmp(value, o.value, std::min(length_, o.length_));
+        if (c != 0) return c;
+        return length_ < o.length_ ? -1 : (length_ > o.length_ ? 1 : 0);
     }
   public:
-    CharStruct() {}
-    CharStruct(const CharStruct &other) : CharStruct(other.value) {} /* copy constructor*/
-    CharStruct(CharStruct &&other) :CharStruct(other.value){} /* move constructor*/
+    BasicCharStruct() { Set("", 0); }
+    BasicCharStruct(const BasicCharStruct &other) { *this = other; } /* copy constructor*/
+    BasicCharStruct(BasicCharStruct &&other) { *this = other; } /* move constructor*/
 
+    BasicCharStruct(const char* data_) { Set(data_, strlen(data_)); }
+    BasicCharStruct(std::string data_) { Set(data_.data(), data_.length()); }
 
-    CharStruct(const char* data_) {
-        snprintf(this->value, strlen(data_)+1, "%s", data_);
-    }
-    CharStruct(std::string data_):CharStruct(data_.c_str()) {}
-
-    CharStruct(char* data_, size_t size) {
-        snprintf(this->value, size, "%s", data_);
+    BasicCharStruct(char* data_, size_t size) {
+        Set(data_, size > 0 ? strnlen(data_, size - 1) : 0);
     }
     const char* c_str() const {
         return value;
     }
-  std::string string() const {
-    return std::string(value);
+    std::string string() const {
+        return std::string(value, length_);
     }
 
-    char* data() {
+    const char* data() const {
         return value;
     }
     const size_t size() const {
-        return strlen(value);
+        return length_;
+    }
+    /** Hash of the characters, cached on assignment. */
+    size_t hash() const {
+        return hash_;
     }
     /**
    * Operators
    */
-    CharStruct &operator=(const CharStruct &other) {
-        strcpy(value,other.c_str());
+    BasicCharStruct &operator=(const BasicCharStruct &other) {
+        hash_ = other.hash_;
+        length_ = other.length_;
+        memcpy(value, other.value, other.length_ + 1);
         return *this;
     }
     /* equal operator for comparing two Chars. */
-    bool operator==(const CharStruct &o) const {
-        return strcmp(value, o.value) == 0;
+    bool operator==(const BasicCharStruct &o) const {
+        return hash_ == o.hash_ && length_ == o.length_ &&
+               memcmp(value, o.value, length_) == 0;
     }
-    CharStruct operator+(const CharStruct& o){
-        std::string added=std::string(this->c_str())+std::string(o.c_str());
-        return CharStruct(added);
+    bool operator!=(const BasicCharStruct &o) const {
+        return !(*this == o);
     }
-    CharStruct operator+(std::string &o)
+    BasicCharStruct operator+(const BasicCharStruct& o){
+        return BasicCharStruct(string() + o.string());
+    }
+    BasicCharStruct operator+(std::string &o)
     {
-        std::string added=std::string(this->c_str())+o;
-        return CharStruct(added);
+        return BasicCharStruct(string() + o);
     }
-    CharStruct& operator+=(const CharStruct& rhs){
-        std::string added=std::string(this->c_str())+std::string(rhs.c_str());
-        Set(added);
+    BasicCharStruct& operator+=(const BasicCharStruct& rhs){
+        std::string added = string() + rhs.string();
+        Set(added.data(), added.length());
         return *this;
     }
-    bool operator>(const CharStruct &o) const {
-        return  strcmp(this->value,o.c_str()) > 0;
+    bool operator>(const BasicCharStruct &o) const {
+        return Compare(o) > 0;
     }
-    bool operator>=(const CharStruct &o) const {
-        return strcmp(this->value,o.c_str()) >= 0;
+    bool operator>=(const BasicCharStruct &o) const {
+        return Compare(o) >= 0;
     }
-    bool operator<(const CharStruct &o) const {
-        return strcmp(this->value,o.c_str()) < 0;
+    bool operator<(const BasicCharStruct &o) const {
+        return Compare(o) < 0;
     }
-    bool operator<=(const CharStruct &o) const {
-        return strcmp(this->value,o.c_str()) <= 0;
+    bool operator<=(const BasicCharStruct &o) const {
+        return Compare(o) <= 0;
     }
+};
+
+/** Names and paths, up to 255 characters. */
+typedef BasicCharStruct<256> CharStruct;
+/** Compact string key, up to 31 characters in 48 bytes. */
+typedef BasicCharStruct<32> ShortCharStruct;
 
-} CharStruct;
 namespace std {
-template<>
-struct hash<CharStruct> {
-    size_t operator()(const CharStruct &k) const {
-        std::string val(k.c_str());
-        return std::hash<std::string>()(val);
+template<size_t N>
+struct hash<BasicCharStruct<N>> {
+    size_t operator()(const BasicCharStruct<N> &k) const {
+        return k.hash();
     }
 };
 }
+namespace basket {
+template<size_t N>
+struct hash<BasicCharStruct<N>> {
+    size_t operator()(const BasicCharStruct<N> &k) const {
+        return k.hash();
+    }
+};
+
+/**
+ * Result of a lookup that may miss. An empty Optional holds no value, so a
+ * miss never constructs a MappedType and is sent as a single nil over RPC.
+ *
+ * @tparam T, the type of the value
+ */
+template<typename T>
+class Optional : public std::optional<T> {
+  public:
+    using std::optional<T>::optional;
+    using std::optional<T>::operator=;
+    Optional() : std::optional<T>() {}
+    Optional(const std::optional<T> &other) : std::optional<T>(other) {}
+    Optional(std::optional<T> &&other) : std::optional<T>(std::move(other)) {}
+
+#if defined(BASKET_ENABLE_THALLIUM_TCP) || defined(BASKET_ENABLE_THALLIUM_ROCE)
+    template<typename A>
+    void serialize(A &ar) {
+        bool found = this->has_value();
+        ar & found;
+        if (!found) {
+            this->reset();
+            return;
+        }
+        if (!this->has_value()) this->emplace();
+        SerializeValue(ar, **this);
+    }
+
+    template<typename A>
+    void serialize(A &ar) const {
+        bool found = this->has_value();
+        ar & found;
+        if (found) SerializeValue(ar, **this);
+    }
+
+  private:
+    /* Raw serializable values cross the archive with a single memcpy. */
+    template<typename A, typename V>
+    static void SerializeValue(A &ar, V &value) {
+        if constexpr (basket::is_raw_serializable<T>::value) {
+            basket::raw_serialize(ar, value);
+        } else {
+            ar & value;
+        }
+    }
+#endif
+};
+}
 
 #ifdef BASKET_ENABLE_RPCLIB
 namespace clmdep_msgpack {
 MSGPACK_API_VERSION_NAMESPACE(MSGPACK_DEFAULT_API_NS) {
     namespace adaptor {
     namespace mv1 = clmdep_msgpack::v1;
-    template<>
-    struct convert<CharStruct> {
+    template<size_t N>
+    struct convert<BasicCharStruct<N>> {
         mv1::object const &operator()(mv1::object const &o,
-                                      CharStruct &input) const {
-            std::string v = std::string();
-            v.assign(o.via.str.ptr, o.via.str.size);
-            input = CharStruct(v);
+                                      BasicCharStruct<N> &input) const {
+            input = BasicCharStruct<N>(std::string(o.via.str.ptr, o.via.str.size));
             return o;
         }
     };
 
-    template<>
-    struct pack<CharStruct> {
+    template<size_t N>
+    struct pack<BasicCharStruct<N>> {
         template<typename Stream>
         packer <Stream> &operator()(mv1::packer <Stream> &o,
-                                    CharStruct const &input) const {
+                                    BasicCharStruct<N> const &input) const {
             uint32_t size = checked_get_container_size(input.size());
             o.pack_str(size);
             o.pack_str_body(input.c_str(), size);
@@ -159,10 +254,10 @@ MSGPACK_API_VERSION_NAMESPACE(MSGPACK_DEFAULT_API_NS) {
         }
     };
 
-    template<>
-    struct object_with_zone<CharStruct> {
+    template<size_t N>
+    struct object_with_zone<BasicCharStruct<N>> {
         void operator()(mv1::object::with_zone &o,
-                        CharStruct const &input) const {
+                        BasicCharStruct<N> const &input) const {
             uint32_t size = checked_get_container_size(input.size());
             o.type = clmdep_msgpack::type::STR;
             char *ptr = static_cast<char *>(
@@ -172,6 +267,43 @@ MSGPACK_API_VERSION_NAMESPACE(MSGPACK_DEFAULT_API_NS) {
             std::memcpy(ptr, input.c_str(), input.size());
         }
     };
+
+    template<typename T>
+    struct convert<basket::Optional<T>> {
+        mv1::object const &operator()(mv1::object const &o,
+                                      basket::Optional<T> &input) const {
+            if (o.is_nil()) {
+                input.reset();
+            } else {
+                input.emplace();
+                o.convert(*input);
+            }
+            return o;
+        }
+    };
+
+    template<typename T>
+    struct pack<basket::Optional<T>> {
+        template<typename Stream>
+        packer <Stream> &operator()(mv1::packer <Stream> &o,
+                                    basket::Optional<T> const &input) const {
+            if (input.has_value()) o.pack(*input);
+            else o.pack_nil();
+            return o;
+        }
+    };
+
+    template<typename T>
+    struct object_with_zone<basket::Optional<T>> {
+        void operator()(mv1::object::with_zone &o,
+                        basket::Optional<T> const &input) const {
+            if (input.has_value()) {
+                object_with_zone<T>()(o, *input);
+            } else {
+                o.type = clmdep_msgpack::type::NIL;
+            }
+        }
+    };
     }  // namespace adaptor
 }
 }  // namespace clmdep_msgpack
@@ -188,7 +320,10 @@ std::ostream &operator<<(std::ostream &os, std::pair<T,O> const m){
                 << "second:" << m.second << "}";
 }
 std::ostream &operator<<(std::ostream &os, uint8_t const &m);
-std::ostream &operator<<(std::ostream &os, CharStruct const &m);
+template<size_t N>
+std::ostream &operator<<(std::ostream &os, BasicCharStruct<N> const &m){
+    return os   << "{TYPE:CharStruct," << "value:" << m.c_str()<<"}";
+}
 template <typename T>
 std::ostream &operator<<(std::ostream &os, std::vector<T> const &ms){
     os << "[";
@@ -27,4 +27,15 @@ typedef enum RPCImplementation {
   THALLIUM_ROCE = 2
 } RPCImplementation;
 
+typedef enum QueueFullPolicy {
+  QUEUE_FULL_FAIL = 0,
+  QUEUE_FULL_BLOCK = 1
+} QueueFullPolicy;
+
+typedef enum SetOperation {
+  SET_INTERSECTION = 0,
+  SET_UNION = 1,
+  SET_DIFFERENCE = 2
+} SetOperation;
+
 #endif //INCLUDE_BASKET_COMMON_ENUMERATIONS_H
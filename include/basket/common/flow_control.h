@@ -0,0 +1,197 @@
+/*
+ * Copyright (C) 2019  Hariharan Devarajan, Keith Bateman
+ *
+ * This file is part of Basket
+ *
+ * Basket is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/*-------------------------------------------------------------------------
+ *
+ * Created: flow_control.h
+ *
+ * Purpose: Defines the credits remote producers hold for the free slots of
+ * bounded queue partitions, and the limit on long polls a server holds.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef INCLUDE_BASKET_COMMON_FLOW_CONTROL_H_
+#define INCLUDE_BASKET_COMMON_FLOW_CONTROL_H_
+
+#include <basket/common/typedefs.h>
+#include <basket/common/enumerations.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace basket {
+
+/**
+ * Slots a server grants a producer asking for n of its free slots. The
+ * producer gets its share of the free slots, split among all processes, but
+ * never less than it asked for so a batch is not starved by the split.
+ * @param free, the free slots of the partition
+ * @param n, the slots the producer needs
+ * @param producers, the processes that may push to the partition
+ * @return the granted slots, 0 if fewer than n are free
+ */
+inline size_t CreditGrant(size_t free, size_t n, int producers) {
+    if (free < n) return 0;
+    return std::max(n, free / static_cast<size_t>(std::max(producers, 1)));
+}
+
+/**
+ * RPC handler threads a server lends to long polls. A held request keeps
+ * its thread until it is answered, so at most rpc_threads - 1 requests are
+ * held at once and one thread is always left for pushes and pops. With a
+ * single RPC thread no request is held.
+ */
+class LongPollLimit {
+  private:
+    std::atomic<uint32_t> held;
+    uint32_t limit;
+
+  public:
+    explicit LongPollLimit(uint16_t rpc_threads)
+            : held(0), limit(rpc_threads > 1 ? rpc_threads - 1u : 0u) {}
+
+    /**
+     * Take a thread for a request to hold.
+     * @return bool, false if every thread that may be lent is taken
+     */
+    bool TryAcquire() {
+        uint32_t count = held.load(std::memory_order_relaxed);
+        while (count < limit) {
+            if (held.compare_exchange_weak(count, count + 1)) return true;
+        }
+        return false;
+    }
+
+    void Release() { held.fetch_sub(1); }
+};
+
+/**
+ * Scoped use of a LongPollLimit by one request.
+ */
+class LongPollSlot {
+  private:
+    LongPollLimit &limit;
+    bool held;
+
+  public:
+    explicit LongPollSlot(LongPollLimit &limit_)
+            : limit(limit_), held(limit_.TryAcquire()) {}
+    ~LongPollSlot() {
+        if (held) limit.Release();
+    }
+    LongPollSlot(const LongPollSlot &) = delete;
+    LongPollSlot &operator=(const LongPollSlot &) = delete;
+
+    /**
+     * @return timeout if the request may be held, 0 if it is answered now
+     */
+    HTime Timeout(HTime timeout) const { return held ? timeout : 0; }
+};
+
+/**
+ * Pause a client after a long poll came back empty before its timeout,
+ * which means the server had no thread to hold it, so that it does not
+ * reissue the request in a tight loop. The pause is a tenth of the poll and
+ * never outlasts it.
+ * @param timeout, the timeout the poll was issued with
+ * @param start, when the poll was issued
+ */
+inline void LongPollBackoff(HTime timeout, std::chrono::steady_clock::time_point start) {
+    std::chrono::steady_clock::time_point end = start + std::chrono::microseconds(timeout);
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (now >= end) return;
+    std::this_thread::sleep_until(
+        std::min(end, now + std::chrono::microseconds(std::max<HTime>(timeout / 10, 1))));
+}
+
+/**
+ * Credits of a remote producer on every server. A credit stands for a slot
+ * the server saw free when it granted it; elements are only sent against
+ * credits, so a full partition is found out by a small request instead of
+ * by shipping the elements. Grants to different producers may overlap, so
+ * servers still check the capacity and a rejected push revokes the credits.
+ */
+class CreditTable {
+  private:
+    size_t capacity;
+    QueueFullPolicy policy;
+    HTime poll;
+    std::vector<size_t> credits;
+    std::mutex mutex;
+
+  public:
+    CreditTable(size_t capacity_, QueueFullPolicy policy_, HTime poll_, uint16_t num_servers)
+            : capacity(capacity_), policy(policy_), poll(poll_),
+              credits(num_servers, 0), mutex() {}
+
+    bool Bounded() const { return capacity > 0; }
+
+    bool Blocking() const { return policy == QUEUE_FULL_BLOCK; }
+
+    bool Fits(size_t n) const { return !Bounded() || n <= capacity; }
+
+    /**
+     * Take n credits on server, requesting new ones if there are not
+     * enough. Blocking producers long poll the server until it has room,
+     * pausing between polls the server could not hold.
+     * @param fetch, callable (n, timeout) returning the slots server grants
+     * @return bool, false if server has no room and pushes fail fast, or if
+     * n exceeds the capacity
+     */
+    template<typename Fetch>
+    bool Acquire(uint16_t server, size_t n, Fetch fetch) {
+        if (!Bounded()) return true;
+        if (!Fits(n)) return false;
+        while (true) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (credits[server] >= n) {
+                    credits[server] -= n;
+                    return true;
+                }
+            }
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            size_t granted = fetch(n, Blocking() ? poll : 0);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                credits[server] = granted;
+            }
+            if (granted == 0 && !Blocking()) return false;
+            if (granted == 0) LongPollBackoff(poll, start);
+        }
+    }
+
+    /**
+     * Drop the credits on server after it rejected a push.
+     */
+    void Revoke(uint16_t server) {
+        std::lock_guard<std::mutex> lock(mutex);
+        credits[server] = 0;
+    }
+};
+
+}  // namespace basket
+
+#endif  // INCLUDE_BASKET_COMMON_FLOW_CONTROL_H_
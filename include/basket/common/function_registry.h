@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2019  Hariharan Devarajan, Keith Bateman
+ *
+ * This file is part of Basket
+ * 
+ * Basket is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+
+/*-------------------------------------------------------------------------
+ *
+ * Created: function_registry.h
+ *
+ * Purpose: Defines a process local registry of named functions that the
+ * containers run on the server side of a request.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef INCLUDE_BASKET_COMMON_FUNCTION_REGISTRY_H_
+#define INCLUDE_BASKET_COMMON_FUNCTION_REGISTRY_H_
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <typeindex>
+#include <unordered_map>
+#include <utility>
+
+namespace basket {
+
+/**
+ * Maps names to std::function objects of any signature. A lookup names the
+ * signature it expects and fails if the function was registered with a
+ * different one, so a request with mismatched argument types is refused
+ * instead of calling through the wrong type. Functions cannot travel over
+ * RPC, every process that may run a request has to register it.
+ */
+class FunctionRegistry {
+  private:
+    typedef std::pair<std::type_index, std::shared_ptr<void>> Entry;
+    std::unordered_map<std::string, Entry> functions;
+    mutable std::shared_mutex mutex;
+
+  public:
+    FunctionRegistry() : functions(), mutex() {}
+
+    /**
+     * Register function under name, replacing any previous one.
+     */
+    template<typename ReturnType, typename... Args>
+    void Register(const std::string &name,
+                  std::function<ReturnType(Args...)> function) {
+        typedef std::function<ReturnType(Args...)> Function;
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        functions.insert_or_assign(
+            name, Entry(std::type_index(typeid(Function)),
+                        std::make_shared<Function>(std::move(function))));
+    }
+
+    /**
+     * Find the function registered under name.
+     * @tparam Function, the std::function type the caller expects
+     * @return the function, or nullptr if name is unknown or was registered
+     * with another signature
+     */
+    template<typename Function>
+    std::shared_ptr<Function> Find(const std::string &name) const {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        auto iterator = functions.find(name);
+        if (iterator == functions.end() ||
+            iterator->second.first != std::type_index(typeid(Function))) {
+            return nullptr;
+        }
+        return std::static_pointer_cast<Function>(iterator->second.second);
+    }
+};
+
+}  // namespace basket
+
+#endif  // INCLUDE_BASKET_COMMON_FUNCTION_REGISTRY_H_
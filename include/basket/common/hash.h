@@ -0,0 +1,252 @@
+/*
+ * Copyright (C) 2019  Hariharan Devarajan, Keith Bateman
+ *
+ * This file is part of Basket
+ *
+ * Basket is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/*-------------------------------------------------------------------------
+ *
+ * Created: hash.h
+ *
+ * Purpose: Defines the hash family used by Basket to route keys to servers
+ * and to index the shared memory tables.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef INCLUDE_BASKET_COMMON_HASH_H_
+#define INCLUDE_BASKET_COMMON_HASH_H_
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <type_traits>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace basket {
+namespace hashing {
+
+/* Random constants. The layout follows XXH3: stripe n of a block reads
+ * words [n, n + 8), the scramble reads words [16, 24). */
+static const uint64_t kSecret[24] = {
+    0x0bd2db2e48789d20ULL, 0x7c621bc543b550a8ULL, 0xb27410639e13de46ULL,
+    0xd3c4eb1714b569e5ULL, 0x9fc8be2266edda39ULL, 0x491e4aceebe4be30ULL,
+    0x180afb1a9570beb0ULL, 0xca454537878d2950ULL, 0xa96a98c828045478ULL,
+    0xa4a4b920c8e15bf5ULL, 0xae09d92fba683111ULL, 0x1defe04876a32064ULL,
+    0x1b830cede5f3a95fULL, 0x5d45a31f3dd3297fULL, 0x1b37fd03b9ada18eULL,
+    0xa9cad3754033f149ULL, 0x2bbe59b3c2df09d1ULL, 0xc01f604b97fba984ULL,
+    0xdad0325410c910f5ULL, 0x0677e5dd8bdbadf9ULL, 0x2bc9abfd44bc3b36ULL,
+    0x08cf102312742cefULL, 0x495cf4650c95833dULL, 0x288961efe041bc37ULL,
+};
+static const size_t kStripe = 64;
+static const size_t kStripesPerBlock = 16;
+static const uint64_t kScramblePrime = 0x9E3779B1ULL;
+
+inline uint64_t Read64(const unsigned char *p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline uint64_t Read32(const unsigned char *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+/** Fold the 128 bit product of a and b into 64 bits. */
+inline uint64_t Mum(uint64_t a, uint64_t b) {
+    __uint128_t r = static_cast<__uint128_t>(a) * b;
+    return static_cast<uint64_t>(r) ^ static_cast<uint64_t>(r >> 64);
+}
+
+/** Bijective 64 bit finalizer (moremur). */
+inline uint64_t Mix64(uint64_t x) {
+    x ^= x >> 27;
+    x *= 0x3C79AC492BA7B653ULL;
+    x ^= x >> 33;
+    x *= 0x1C69B3F74AC4AE35ULL;
+    x ^= x >> 27;
+    return x;
+}
+
+inline uint64_t Avalanche(uint64_t h) {
+    h ^= h >> 37;
+    h *= 0x165667919E3779F9ULL;
+    return h ^ (h >> 32);
+}
+
+/* The vector and scalar kernels give bit identical results, so processes
+ * built with and without AVX2 agree on the placement of keys. */
+#if defined(__AVX2__)
+inline void Accumulate512(uint64_t *acc, const unsigned char *p,
+                          const uint64_t *secret) {
+    for (size_t j = 0; j < 2; ++j) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(acc) + j);
+        __m256i data = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i *>(p) + j);
+        __m256i key = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i *>(secret + 4 * j));
+        __m256i data_key = _mm256_xor_si256(data, key);
+        __m256i product = _mm256_mul_epu32(data_key,
+                                           _mm256_srli_epi64(data_key, 32));
+        __m256i swapped = _mm256_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+        a = _mm256_add_epi64(a, _mm256_add_epi64(swapped, product));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(acc) + j, a);
+    }
+}
+
+inline void Scramble(uint64_t *acc, const uint64_t *secret) {
+    const __m256i prime = _mm256_set1_epi64x(kScramblePrime);
+    for (size_t j = 0; j < 2; ++j) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(acc) + j);
+        __m256i key = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i *>(secret + 4 * j));
+        a = _mm256_xor_si256(a, _mm256_srli_epi64(a, 47));
+        a = _mm256_xor_si256(a, key);
+        __m256i low = _mm256_mul_epu32(a, prime);
+        __m256i high = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), prime);
+        a = _mm256_add_epi64(low, _mm256_slli_epi64(high, 32));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(acc) + j, a);
+    }
+}
+#else
+inline void Accumulate512(uint64_t *acc, const unsigned char *p,
+                          const uint64_t *secret) {
+    for (size_t i = 0; i < 8; ++i) {
+        uint64_t data = Read64(p + 8 * i);
+        uint64_t data_key = data ^ secret[i];
+        acc[i ^ 1] += data;
+        acc[i] += (data_key & 0xFFFFFFFFULL) * (data_key >> 32);
+    }
+}
+
+inline void Scramble(uint64_t *acc, const uint64_t *secret) {
+    for (size_t i = 0; i < 8; ++i) {
+        uint64_t a = acc[i];
+        a ^= a >> 47;
+        a ^= secret[i];
+        acc[i] = a * kScramblePrime;
+    }
+}
+#endif
+
+/** Striped hash for inputs longer than one stripe. */
+inline uint64_t HashLong(const unsigned char *p, size_t len, uint64_t seed) {
+    uint64_t acc[8] = {
+        0x00000000C2B2AE3DULL ^ seed, 0x9E3779B185EBCA87ULL - seed,
+        0xC2B2AE3D27D4EB4FULL ^ seed, 0x165667B19E3779F9ULL - seed,
+        0x85EBCA77C2B2AE63ULL ^ seed, 0x0000000085EBCA77ULL - seed,
+        0x27D4EB2F165667C5ULL ^ seed, 0x000000009E3779B1ULL - seed,
+    };
+    const size_t block = kStripe * kStripesPerBlock;
+    size_t blocks = (len - 1) / block;
+    for (size_t b = 0; b < blocks; ++b) {
+        for (size_t s = 0; s < kStripesPerBlock; ++s) {
+            Accumulate512(acc, p + b * block + s * kStripe, kSecret + s);
+        }
+        Scramble(acc, kSecret + 16);
+    }
+    size_t stripes = ((len - 1) - blocks * block) / kStripe;
+    for (size_t s = 0; s < stripes; ++s) {
+        Accumulate512(acc, p + blocks * block + s * kStripe, kSecret + s);
+    }
+    /* the last stripe overlaps the previous one instead of padding */
+    Accumulate512(acc, p + len - kStripe, kSecret + 9);
+    uint64_t h = len * 0x9E3779B185EBCA87ULL;
+    for (size_t i = 0; i < 4; ++i) {
+        h += Mum(acc[2 * i] ^ kSecret[11 + 2 * i],
+                 acc[2 * i + 1] ^ kSecret[12 + 2 * i]);
+    }
+    return Avalanche(h);
+}
+
+/**
+ * Hash len bytes at data. Short inputs follow wyhash, inputs longer than 64
+ * bytes use an XXH3 style striped accumulator.
+ */
+inline uint64_t HashBytes(const void *data, size_t len, uint64_t seed = 0) {
+    const unsigned char *p = static_cast<const unsigned char *>(data);
+    if (len > kStripe) return HashLong(p, len, seed);
+    seed ^= Mum(seed ^ kSecret[0], kSecret[1]);
+    uint64_t a, b;
+    if (len <= 16) {
+        if (len >= 4) {
+            a = (Read32(p) << 32) | Read32(p + ((len >> 3) << 2));
+            b = (Read32(p + len - 4) << 32) |
+                Read32(p + len - 4 - ((len >> 3) << 2));
+        } else if (len > 0) {
+            a = (static_cast<uint64_t>(p[0]) << 16) |
+                (static_cast<uint64_t>(p[len >> 1]) << 8) | p[len - 1];
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        size_t i = len;
+        const unsigned char *q = p;
+        while (i > 16) {
+            seed = Mum(Read64(q) ^ kSecret[1], Read64(q + 8) ^ seed);
+            q += 16;
+            i -= 16;
+        }
+        a = Read64(p + len - 16);
+        b = Read64(p + len - 8);
+    }
+    __uint128_t r = static_cast<__uint128_t>(a ^ kSecret[1]) * (b ^ seed);
+    return Mum(static_cast<uint64_t>(r) ^ kSecret[0] ^ len,
+               static_cast<uint64_t>(r >> 64) ^ kSecret[1]);
+}
+
+}  // namespace hashing
+
+/**
+ * Hash used for routing keys to servers and inside the shared memory tables.
+ * Integers are mixed directly, other types have their std::hash value
+ * mixed, so identity hashes still spread over servers. Specialize
+ * basket::hash<T> to control the placement of a key type.
+ *
+ * @tparam T, the key type
+ */
+template<typename T, typename Enable = void>
+struct hash {
+    size_t operator()(const T &key) const {
+        return hashing::Mix64(std::hash<T>()(key));
+    }
+};
+
+template<typename T>
+struct hash<T, typename std::enable_if<std::is_integral<T>::value ||
+                                       std::is_enum<T>::value>::type> {
+    size_t operator()(const T &key) const {
+        return hashing::Mix64(static_cast<uint64_t>(key));
+    }
+};
+
+template<>
+struct hash<std::string> {
+    size_t operator()(const std::string &key) const {
+        return hashing::HashBytes(key.data(), key.size());
+    }
+};
+
+}  // namespace basket
+
+#endif  // INCLUDE_BASKET_COMMON_HASH_H_
@@ -0,0 +1,278 @@
+/*
+ * Copyright (C) 2019  Hariharan Devarajan, Keith Bateman
+ *
+ * This file is part of Basket
+ *
+ * Basket is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/*-------------------------------------------------------------------------
+ *
+ * Created: hot_key_sketch.h
+ *
+ * Purpose: Defines a streaming sketch of the keys accessed on a server
+ * partition, used to report the hottest keys of a container.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef INCLUDE_BASKET_COMMON_HOT_KEY_SKETCH_H_
+#define INCLUDE_BASKET_COMMON_HOT_KEY_SKETCH_H_
+
+#include <basket/common/typedefs.h>
+#include <basket/common/hash.h>
+#include <basket/common/data_structures.h>
+#include <boost/interprocess/managed_mapped_file.hpp>
+#include <boost/interprocess/allocators/allocator.hpp>
+#include <boost/interprocess/containers/vector.hpp>
+#include <boost/container/vector.hpp>
+#include <boost/interprocess/sync/interprocess_mutex.hpp>
+#include <boost/interprocess/sync/scoped_lock.hpp>
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace basket {
+
+/**
+ * Bytes of data a key or value carries, which HotKeySketch accounts per
+ * access. Strings and containers count their contents, not their
+ * footprint.
+ */
+template<typename T>
+inline size_t PayloadSize(const T &) { return sizeof(T); }
+
+template<size_t N>
+inline size_t PayloadSize(const BasicCharStruct<N> &value) { return value.size(); }
+
+inline size_t PayloadSize(const std::string &value) { return value.size(); }
+
+template<typename T, typename Allocator>
+inline size_t PayloadSize(const std::vector<T, Allocator> &values) {
+    size_t size = 0;
+    for (const T &value : values) size += PayloadSize(value);
+    return size;
+}
+
+template<typename T, typename Allocator>
+inline size_t PayloadSize(const boost::container::vector<T, Allocator> &values) {
+    size_t size = 0;
+    for (const T &value : values) size += PayloadSize(value);
+    return size;
+}
+
+/**
+ * Count-min sketch of key accesses combined with a small table of the
+ * current heavy hitters. The sketch is constructed inside the mapped segment
+ * so accesses of on-node clients are counted as well. Counters are bumped
+ * with atomic adds, so readers holding the partition lock shared are not
+ * serialized by the sketch; the mutex is only taken when a key that is not
+ * tracked yet grows hotter than the coldest tracked key. Members of the
+ * table are found without the mutex through an open addressed set of
+ * their hashes.
+ *
+ * @tparam KeyType, the key of the container
+ */
+template<typename KeyType>
+class HotKeySketch {
+  public:
+    static const size_t DEPTH = 4;
+    static const size_t WIDTH = 2048;
+
+  private:
+    struct Entry {
+        KeyType key;
+        uint64_t hash;
+    };
+    typedef boost::interprocess::allocator<
+        Entry, boost::interprocess::managed_mapped_file::segment_manager>
+    ShmemAllocator;
+    typedef boost::interprocess::vector<Entry, ShmemAllocator> EntryVector;
+    typedef boost::interprocess::allocator<
+        uint64_t, boost::interprocess::managed_mapped_file::segment_manager>
+    HashAllocator;
+    typedef boost::interprocess::vector<uint64_t, HashAllocator> HashVector;
+
+    /* markers of the member set, real hashes are remapped around them */
+    static constexpr uint64_t EMPTY = 0;
+    static constexpr uint64_t REMOVED = 1;
+
+    boost::interprocess::interprocess_mutex mutex;
+    uint64_t hits[DEPTH][WIDTH];
+    uint64_t bytes[DEPTH][WIDTH];
+    size_t capacity;
+    EntryVector top;
+    HashVector members;
+    size_t removed;
+    /* fewest hits of a tracked key when last computed, 0 until the table
+       is full; it only lags behind, so colder keys skip the mutex safely */
+    uint64_t threshold;
+
+    static size_t Slot(size_t hash, size_t row) {
+        /* derive one independent slot per row from the key hash */
+        uint64_t x = hash + (row + 1) * 0x9E3779B97F4A7C15ULL;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+        return (x ^ (x >> 31)) % WIDTH;
+    }
+
+    /* a user hash may be the identity, so remix it before moving the two
+       values that would be a marker, else keys 0 and 2 would collide */
+    static uint64_t Marked(uint64_t hash) {
+        uint64_t mixed = hashing::Mix64(hash);
+        return mixed > REMOVED ? mixed : mixed + 2;
+    }
+
+    static size_t MemberSlots(size_t capacity) {
+        size_t slots = 4;
+        while (slots < 2 * capacity) slots <<= 1;
+        return slots;
+    }
+
+    bool IsMember(uint64_t hash) const {
+        size_t mask = members.size() - 1;
+        for (size_t slot = hash & mask;; slot = (slot + 1) & mask) {
+            uint64_t member = __atomic_load_n(&members[slot], __ATOMIC_ACQUIRE);
+            if (member == hash) return true;
+            if (member == EMPTY) return false;
+        }
+    }
+
+    /* the mutex must be held for the member set changes below */
+    void AddMember(uint64_t hash) {
+        size_t mask = members.size() - 1;
+        size_t slot = hash & mask;
+        while (members[slot] != EMPTY && members[slot] != REMOVED) slot = (slot + 1) & mask;
+        if (members[slot] == REMOVED) --removed;
+        __atomic_store_n(&members[slot], hash, __ATOMIC_RELEASE);
+    }
+
+    void RemoveMember(uint64_t hash) {
+        size_t mask = members.size() - 1;
+        size_t slot = hash & mask;
+        while (members[slot] != hash) slot = (slot + 1) & mask;
+        __atomic_store_n(&members[slot], REMOVED, __ATOMIC_RELEASE);
+        /* keep at least one empty slot, so lookups of absent keys end */
+        if (++removed >= members.size() - top.size() - 1) {
+            for (size_t i = 0; i < members.size(); ++i) {
+                __atomic_store_n(&members[i], EMPTY, __ATOMIC_RELEASE);
+            }
+            removed = 0;
+            for (const Entry &entry : top) {
+                if (entry.hash != hash) AddMember(entry.hash);
+            }
+        }
+    }
+
+    uint64_t Estimate(const uint64_t (&counters)[DEPTH][WIDTH], uint64_t hash) const {
+        uint64_t estimate = UINT64_MAX;
+        for (size_t row = 0; row < DEPTH; ++row) {
+            estimate = std::min(estimate, __atomic_load_n(&counters[row][Slot(hash, row)],
+                                                          __ATOMIC_RELAXED));
+        }
+        return estimate;
+    }
+
+  public:
+    HotKeySketch(size_t capacity_,
+                 boost::interprocess::managed_mapped_file::segment_manager *manager)
+            : mutex(), hits(), bytes(), capacity(capacity_),
+              top(ShmemAllocator(manager)),
+              members(MemberSlots(capacity_), EMPTY, HashAllocator(manager)),
+              removed(0), threshold(0) {
+        top.reserve(capacity);
+    }
+
+    /**
+     * Count one access of key carrying size bytes, see PayloadSize.
+     */
+    void Record(const KeyType &key, size_t size) {
+        uint64_t hash = Marked(basket::hash<KeyType>()(key));
+        uint64_t estimate = UINT64_MAX;
+        for (size_t row = 0; row < DEPTH; ++row) {
+            size_t slot = Slot(hash, row);
+            estimate = std::min(estimate,
+                                __atomic_add_fetch(&hits[row][slot], 1, __ATOMIC_RELAXED));
+            __atomic_add_fetch(&bytes[row][slot], size, __ATOMIC_RELAXED);
+        }
+        if (capacity == 0 || estimate <= __atomic_load_n(&threshold, __ATOMIC_RELAXED) ||
+            IsMember(hash)) {
+            return;
+        }
+        boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex>
+                lock(mutex);
+        if (IsMember(hash)) return;
+        if (top.size() < capacity) {
+            top.push_back(Entry{key, hash});
+            AddMember(hash);
+        } else {
+            typename EntryVector::iterator coldest = top.begin();
+            uint64_t coldest_hits = UINT64_MAX;
+            for (auto iterator = top.begin(); iterator != top.end(); ++iterator) {
+                uint64_t entry_hits = Estimate(hits, iterator->hash);
+                if (entry_hits < coldest_hits) {
+                    coldest = iterator;
+                    coldest_hits = entry_hits;
+                }
+            }
+            if (coldest_hits >= estimate) {
+                __atomic_store_n(&threshold, coldest_hits, __ATOMIC_RELAXED);
+                return;
+            }
+            RemoveMember(coldest->hash);
+            *coldest = Entry{key, hash};
+            AddMember(hash);
+        }
+        if (top.size() == capacity) {
+            uint64_t coldest_hits = UINT64_MAX;
+            for (const Entry &entry : top) {
+                coldest_hits = std::min(coldest_hits, Estimate(hits, entry.hash));
+            }
+            __atomic_store_n(&threshold, coldest_hits, __ATOMIC_RELAXED);
+        }
+    }
+
+    /**
+     * Get the k hottest keys seen so far.
+     * @return a vector of key and (estimated hits, estimated bytes), hottest
+     * first.
+     */
+    std::vector<std::pair<KeyType, std::pair<uint64_t, uint64_t>>> Top(size_t k) {
+        std::vector<std::pair<KeyType, std::pair<uint64_t, uint64_t>>> result;
+        {
+            boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex>
+                    lock(mutex);
+            result.reserve(top.size());
+            for (const Entry &entry : top) {
+                result.emplace_back(entry.key,
+                                    std::make_pair(Estimate(hits, entry.hash),
+                                                   Estimate(bytes, entry.hash)));
+            }
+        }
+        std::sort(result.begin(), result.end(),
+                  [](const std::pair<KeyType, std::pair<uint64_t, uint64_t>> &a,
+                     const std::pair<KeyType, std::pair<uint64_t, uint64_t>> &b) {
+                      return a.second.first > b.second.first;
+                  });
+        if (result.size() > k) result.resize(k);
+        return result;
+    }
+};
+
+}  // namespace basket
+
+#endif  // INCLUDE_BASKET_COMMON_HOT_KEY_SKETCH_H_
@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2019  Hariharan Devarajan, Keith Bateman
+ *
+ * This file is part of Basket
+ *
+ * Basket is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/*-------------------------------------------------------------------------
+ *
+ * Created: kway_merge.h
+ *
+ * Purpose: Defines the client side merge of the sorted runs of all servers
+ * into one globally ordered stream.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef INCLUDE_BASKET_COMMON_KWAY_MERGE_H_
+#define INCLUDE_BASKET_COMMON_KWAY_MERGE_H_
+
+#include <basket/common/data_structures.h>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <iterator>
+#include <queue>
+#include <utility>
+#include <vector>
+
+namespace basket {
+
+/**
+ * Globally ordered iterator over sources that each hold a sorted run, such
+ * as the partitions of an ordered container. Pages of a few elements are
+ * pulled from a source only once the merge consumed its previous page, and
+ * a heap over the heads of the sources picks the next element, so reading n
+ * elements transfers at most n plus one page per source.
+ *
+ * @tparam T, the element type
+ * @tparam Less, the order the runs are sorted in
+ */
+template<typename T, typename Less>
+class KWayMerge {
+  public:
+    /**
+     * Callable (source, last, n) returning up to n elements of source
+     * following last, the final element of its previous page, or its first
+     * n elements if last is empty.
+     */
+    typedef std::function<std::vector<T>(uint16_t, const Optional<T> &, uint32_t)> Fetch;
+
+  private:
+    struct Run {
+        std::deque<T> page;
+        Optional<T> last;
+        bool exhausted;
+    };
+    std::vector<Run> runs;
+    Less less;
+    Fetch fetch;
+    uint32_t page_size;
+    bool started;
+    std::priority_queue<uint16_t, std::vector<uint16_t>,
+                        std::function<bool(uint16_t, uint16_t)>> heads;
+
+    /* pull the next page of source, return whether it has one */
+    bool Refill(uint16_t source) {
+        Run &run = runs[source];
+        if (run.exhausted) return false;
+        std::vector<T> page = fetch(source, run.last, page_size);
+        if (page.size() < page_size) run.exhausted = true;
+        if (page.empty()) return false;
+        run.last = Optional<T>(page.back());
+        run.page.assign(std::make_move_iterator(page.begin()),
+                        std::make_move_iterator(page.end()));
+        return true;
+    }
+
+    void Start() {
+        started = true;
+        for (uint16_t source = 0; source < runs.size(); ++source) {
+            if (Refill(source)) heads.push(source);
+        }
+    }
+
+  public:
+    /**
+     * @param sources, the number of sources, numbered from 0
+     * @param page_size_, the elements pulled from a source at once
+     */
+    KWayMerge(uint16_t sources, uint32_t page_size_, Less less_, Fetch fetch_)
+            : runs(sources, Run{std::deque<T>(), Optional<T>(), false}), less(less_),
+              fetch(fetch_), page_size(page_size_ > 0 ? page_size_ : 1), started(false),
+              heads([this](uint16_t a, uint16_t b) {
+                  return less(runs[b].page.front(), runs[a].page.front());
+              }) {}
+
+    KWayMerge(const KWayMerge &) = delete;
+    KWayMerge &operator=(const KWayMerge &) = delete;
+
+    /**
+     * Get the next element in global order.
+     * @return an Optional holding the element, empty once all sources are
+     * drained
+     */
+    Optional<T> Next() {
+        if (!started) Start();
+        if (heads.empty()) return Optional<T>();
+        uint16_t source = heads.top();
+        heads.pop();
+        Run &run = runs[source];
+        Optional<T> value(std::move(run.page.front()));
+        run.page.pop_front();
+        if (!run.page.empty() || Refill(source)) heads.push(source);
+        return value;
+    }
+
+    /**
+     * Get up to n next elements in global order.
+     */
+    std::vector<T> NextN(size_t n) {
+        std::vector<T> values;
+        while (values.size() < n) {
+            Optional<T> value = Next();
+            if (!value) break;
+            values.push_back(std::move(*value));
+        }
+        return values;
+    }
+};
+
+}  // namespace basket
+
+#endif  // INCLUDE_BASKET_COMMON_KWAY_MERGE_H_
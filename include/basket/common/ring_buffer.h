@@ -0,0 +1,195 @@
+/*
+ * Copyright (C) 2019  Hariharan Devarajan, Keith Bateman
+ *
+ * This file is part of Basket
+ *
+ * Basket is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/*-------------------------------------------------------------------------
+ *
+ * Created: ring_buffer.h
+ *
+ * Purpose: Defines a bounded lock free multi producer multi consumer ring
+ * buffer living in a mapped segment.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef INCLUDE_BASKET_COMMON_RING_BUFFER_H_
+#define INCLUDE_BASKET_COMMON_RING_BUFFER_H_
+
+#include <boost/interprocess/managed_mapped_file.hpp>
+#include <boost/interprocess/offset_ptr.hpp>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+
+namespace basket {
+
+/**
+ * Bounded MPMC queue after Vyukov. Every slot carries a sequence number that
+ * tells producers and consumers whose turn it is, so push and pop take no
+ * lock and never allocate; the slots are allocated once from the segment.
+ * The sequence numbers are address free atomics, which lets processes
+ * mapping the segment share the buffer.
+ *
+ * @tparam T, the element type, it must be default constructible
+ */
+template<typename T>
+class RingBuffer {
+  private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T data;
+    };
+    static const size_t CACHE_LINE = 64;
+
+    boost::interprocess::offset_ptr<Cell> cells;
+    size_t mask;
+    char pad0[CACHE_LINE];
+    std::atomic<size_t> enqueue_pos;
+    char pad1[CACHE_LINE];
+    std::atomic<size_t> dequeue_pos;
+    char pad2[CACHE_LINE];
+
+    static size_t RoundUp(size_t capacity) {
+        size_t size = 2;
+        while (size < capacity) size <<= 1;
+        return size;
+    }
+
+  public:
+    /**
+     * @param capacity, the number of slots, rounded up to a power of two
+     */
+    RingBuffer(size_t capacity,
+               boost::interprocess::managed_mapped_file::segment_manager *manager)
+            : cells(), mask(RoundUp(capacity) - 1), pad0(), enqueue_pos(0), pad1(),
+              dequeue_pos(0), pad2() {
+        Cell *raw = static_cast<Cell *>(manager->allocate(sizeof(Cell) * (mask + 1)));
+        for (size_t i = 0; i <= mask; ++i) {
+            Cell *cell = new (raw + i) Cell();
+            cell->sequence.store(i, std::memory_order_relaxed);
+        }
+        cells = raw;
+    }
+
+    RingBuffer(const RingBuffer &) = delete;
+    RingBuffer &operator=(const RingBuffer &) = delete;
+
+    /**
+     * Move value into the buffer.
+     * @return bool, false if the buffer was full, value is left untouched
+     */
+    bool TryPush(T &value) {
+        return TryPushN(&value, 1);
+    }
+
+    /**
+     * Move n values into the buffer as one contiguous run. Producers reserve
+     * the run with one CAS once its last slot is free; the earlier slots
+     * may still be drained by consumers and are waited for.
+     * @return bool, false if fewer than n slots were free, nothing is pushed
+     */
+    bool TryPushN(T *values, size_t n) {
+        if (n == 0) return true;
+        if (n > mask + 1) return false;
+        size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+        while (true) {
+            Cell &last = cells[(pos + n - 1) & mask];
+            size_t sequence = last.sequence.load(std::memory_order_acquire);
+            intptr_t difference = static_cast<intptr_t>(sequence) -
+                                  static_cast<intptr_t>(pos + n - 1);
+            if (difference == 0) {
+                if (enqueue_pos.compare_exchange_weak(pos, pos + n,
+                                                      std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (difference < 0) {
+                return false;
+            } else {
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        for (size_t i = 0; i < n; ++i) {
+            Cell &cell = cells[(pos + i) & mask];
+            while (cell.sequence.load(std::memory_order_acquire) != pos + i) {}
+            cell.data = std::move(values[i]);
+            cell.sequence.store(pos + i + 1, std::memory_order_release);
+        }
+        return true;
+    }
+
+    /**
+     * Move the oldest value out of the buffer.
+     * @return bool, false if the buffer was empty
+     */
+    bool TryPop(T &value) {
+        return TryPopInto([&value](T &&data) { value = std::move(data); });
+    }
+
+    /**
+     * Hand the oldest value to sink as an rvalue, so the caller constructs
+     * its copy in place instead of assigning over a default one. The slot
+     * is released once sink returns, also if it throws.
+     * @return bool, false if the buffer was empty, sink is not called
+     */
+    template<typename Sink>
+    bool TryPopInto(Sink &&sink) {
+        size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+        Cell *cell;
+        while (true) {
+            cell = &cells[pos & mask];
+            size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            intptr_t difference = static_cast<intptr_t>(sequence) -
+                                  static_cast<intptr_t>(pos + 1);
+            if (difference == 0) {
+                if (dequeue_pos.compare_exchange_weak(pos, pos + 1,
+                                                      std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (difference < 0) {
+                return false;
+            } else {
+                pos = dequeue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        struct Release {
+            Cell *cell;
+            size_t sequence;
+            ~Release() { cell->sequence.store(sequence, std::memory_order_release); }
+        } release{cell, pos + mask + 1};
+        sink(std::move(cell->data));
+        return true;
+    }
+
+    /**
+     * Number of elements, exact only while no push or pop is in flight.
+     */
+    size_t Size() const {
+        size_t head = dequeue_pos.load(std::memory_order_acquire);
+        size_t tail = enqueue_pos.load(std::memory_order_acquire);
+        return tail > head ? tail - head : 0;
+    }
+
+    size_t Capacity() const { return mask + 1; }
+};
+
+}  // namespace basket
+
+#endif  // INCLUDE_BASKET_COMMON_RING_BUFFER_H_
@@ -0,0 +1,418 @@
+/*
+ * Copyright (C) 2019  Hariharan Devarajan, Keith Bateman
+ *
+ * This file is part of Basket
+ *
+ * Basket is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/*-------------------------------------------------------------------------
+ *
+ * Created: roaring_set.h
+ *
+ * Purpose: Defines the compressed bitmap set partitions of integral keys
+ * are kept in.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+
+#ifndef INCLUDE_BASKET_COMMON_ROARING_SET_H_
+#define INCLUDE_BASKET_COMMON_ROARING_SET_H_
+
+#include <boost/interprocess/managed_mapped_file.hpp>
+#include <boost/interprocess/allocators/allocator.hpp>
+#include <boost/interprocess/containers/map.hpp>
+#include <boost/interprocess/containers/set.hpp>
+#include <boost/interprocess/containers/vector.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <type_traits>
+#include <utility>
+
+namespace basket {
+
+/**
+ * Roaring bitmap over integral keys, living in a mapped segment and usable
+ * in place of a boost::interprocess::set ordered by std::less. A key is
+ * split into its upper 48 bits, which select a container, and its lower 16
+ * bits, which the container holds: as a sorted array while it has at most
+ * ARRAY_MAX keys, else as a bitmap of 65536 bits. Dense ranges then cost
+ * about one bit per key instead of a tree node, and the bitmap containers
+ * are scanned and counted a 64 bit word at a time.
+ *
+ * @tparam KeyType, the integral key type, signed keys keep their order
+ */
+template<typename KeyType>
+class RoaringSet {
+    static_assert(std::is_integral<KeyType>::value && sizeof(KeyType) <= sizeof(uint64_t),
+                  "RoaringSet holds integral keys of at most 64 bits");
+
+  private:
+    typedef boost::interprocess::managed_mapped_file::segment_manager SegmentManager;
+    typedef boost::interprocess::allocator<uint16_t, SegmentManager> ArrayAllocator;
+    typedef boost::interprocess::allocator<uint64_t, SegmentManager> WordAllocator;
+
+    static constexpr uint32_t ARRAY_MAX = 4096;
+    static constexpr uint32_t BITMAP_WORDS = 1024;
+    static constexpr uint64_t SIGN = std::is_signed<KeyType>::value ? uint64_t(1) << 63 : 0;
+
+    struct Container {
+        boost::interprocess::vector<uint16_t, ArrayAllocator> array;
+        /* empty unless the container is a bitmap */
+        boost::interprocess::vector<uint64_t, WordAllocator> bitmap;
+        uint32_t cardinality;
+
+        explicit Container(SegmentManager *manager)
+                : array(ArrayAllocator(manager)), bitmap(WordAllocator(manager)),
+                  cardinality(0) {}
+
+        bool IsBitmap() const { return !bitmap.empty(); }
+
+        bool Contains(uint16_t low) const {
+            if (IsBitmap()) return (bitmap[low >> 6] >> (low & 63)) & 1;
+            return std::binary_search(array.begin(), array.end(), low);
+        }
+
+        bool Add(uint16_t low) {
+            if (IsBitmap()) {
+                uint64_t bit = uint64_t(1) << (low & 63);
+                if (bitmap[low >> 6] & bit) return false;
+                bitmap[low >> 6] |= bit;
+            } else {
+                auto position = std::lower_bound(array.begin(), array.end(), low);
+                if (position != array.end() && *position == low) return false;
+                array.insert(position, low);
+                if (array.size() > ARRAY_MAX) ToBitmap();
+            }
+            ++cardinality;
+            return true;
+        }
+
+        bool Remove(uint16_t low) {
+            if (IsBitmap()) {
+                uint64_t bit = uint64_t(1) << (low & 63);
+                if (!(bitmap[low >> 6] & bit)) return false;
+                bitmap[low >> 6] &= ~bit;
+                /* convert back only well below ARRAY_MAX, so a container
+                   at the limit does not flip on every insert and erase */
+                if (--cardinality <= ARRAY_MAX / 2) ToArray();
+                return true;
+            }
+            auto position = std::lower_bound(array.begin(), array.end(), low);
+            if (position == array.end() || *position != low) return false;
+            array.erase(position);
+            --cardinality;
+            return true;
+        }
+
+        void ToBitmap() {
+            bitmap.assign(BITMAP_WORDS, 0);
+            for (uint16_t low : array) bitmap[low >> 6] |= uint64_t(1) << (low & 63);
+            array.clear();
+            array.shrink_to_fit();
+        }
+
+        void ToArray() {
+            array.reserve(cardinality);
+            for (uint32_t word = 0; word < BITMAP_WORDS; ++word) {
+                for (uint64_t bits = bitmap[word]; bits != 0; bits &= bits - 1) {
+                    array.push_back(static_cast<uint16_t>(word * 64 + __builtin_ctzll(bits)));
+                }
+            }
+            bitmap.clear();
+            bitmap.shrink_to_fit();
+        }
+
+        /* Positions are array indices for arrays and the low bits for
+           bitmaps; -1 stands for none. */
+
+        int32_t LowerBound(uint32_t low) const {
+            if (!IsBitmap()) {
+                size_t index = std::lower_bound(array.begin(), array.end(), low) - array.begin();
+                return index < array.size() ? static_cast<int32_t>(index) : -1;
+            }
+            if (low >= BITMAP_WORDS * 64) return -1;
+            uint32_t word = low >> 6;
+            uint64_t bits = bitmap[word] & (~uint64_t(0) << (low & 63));
+            while (bits == 0) {
+                if (++word == BITMAP_WORDS) return -1;
+                bits = bitmap[word];
+            }
+            return static_cast<int32_t>(word * 64 + __builtin_ctzll(bits));
+        }
+
+        /* the last position holding a key of at most low */
+        int32_t LastAtMost(int32_t low) const {
+            if (low < 0) return -1;
+            if (!IsBitmap()) {
+                size_t index = std::upper_bound(array.begin(), array.end(), low) - array.begin();
+                return static_cast<int32_t>(index) - 1;
+            }
+            int32_t word = low >> 6;
+            uint64_t bits = bitmap[word] & (~uint64_t(0) >> (63 - (low & 63)));
+            while (bits == 0) {
+                if (--word < 0) return -1;
+                bits = bitmap[word];
+            }
+            return word * 64 + 63 - __builtin_clzll(bits);
+        }
+
+        int32_t First() const { return LowerBound(0); }
+
+        int32_t Last() const { return LastAtMost(BITMAP_WORDS * 64 - 1); }
+
+        int32_t Next(int32_t position) const {
+            if (!IsBitmap()) {
+                return position + 1 < static_cast<int32_t>(array.size()) ? position + 1 : -1;
+            }
+            return LowerBound(position + 1);
+        }
+
+        int32_t Previous(int32_t position) const {
+            if (!IsBitmap()) return position - 1;
+            return LastAtMost(position - 1);
+        }
+
+        uint16_t Low(int32_t position) const {
+            return IsBitmap() ? static_cast<uint16_t>(position) : array[position];
+        }
+    };
+
+    typedef std::pair<const uint64_t, Container> Entry;
+    typedef boost::interprocess::allocator<Entry, SegmentManager> EntryAllocator;
+    typedef boost::interprocess::map<uint64_t, Container, std::less<uint64_t>, EntryAllocator>
+    Containers;
+
+    Containers containers;
+    size_t keys;
+
+    static uint64_t Encode(KeyType key) { return static_cast<uint64_t>(key) ^ SIGN; }
+
+    static KeyType Decode(uint64_t value) { return static_cast<KeyType>(value ^ SIGN); }
+
+  public:
+    /**
+     * Bidirectional iterator over the keys in ascending order. Dereferencing
+     * yields the key by value; inserts and erases invalidate iterators.
+     */
+    class const_iterator {
+      private:
+        friend class RoaringSet;
+        const Containers *containers;
+        typename Containers::const_iterator container;
+        int32_t position;
+
+        const_iterator(const Containers *containers_,
+                       typename Containers::const_iterator container_, int32_t position_)
+                : containers(containers_), container(container_), position(position_) {}
+
+      public:
+        typedef std::bidirectional_iterator_tag iterator_category;
+        typedef KeyType value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const KeyType *pointer;
+        typedef KeyType reference;
+
+        const_iterator() : containers(nullptr), container(), position(-1) {}
+
+        KeyType operator*() const {
+            return Decode((container->first << 16) | container->second.Low(position));
+        }
+
+        const_iterator &operator++() {
+            position = container->second.Next(position);
+            if (position < 0 && ++container != containers->end()) {
+                position = container->second.First();
+            }
+            return *this;
+        }
+
+        const_iterator operator++(int) {
+            const_iterator previous = *this;
+            ++*this;
+            return previous;
+        }
+
+        const_iterator &operator--() {
+            if (container != containers->end()) position = container->second.Previous(position);
+            if (container == containers->end() || position < 0) {
+                --container;
+                position = container->second.Last();
+            }
+            return *this;
+        }
+
+        const_iterator operator--(int) {
+            const_iterator previous = *this;
+            --*this;
+            return previous;
+        }
+
+        bool operator==(const const_iterator &other) const {
+            return container == other.container &&
+                   (container == containers->end() || position == other.position);
+        }
+
+        bool operator!=(const const_iterator &other) const { return !(*this == other); }
+    };
+    typedef const_iterator iterator;
+    typedef KeyType key_type;
+    typedef KeyType value_type;
+
+    /**
+     * Takes the arguments of a boost::interprocess::set, so either can be
+     * constructed in the segment.
+     */
+    template<typename Compare, typename Allocator>
+    RoaringSet(const Compare &, const Allocator &allocator)
+            : containers(std::less<uint64_t>(), EntryAllocator(allocator.get_segment_manager())),
+              keys(0) {}
+
+    size_t size() const { return keys; }
+
+    bool empty() const { return keys == 0; }
+
+    const_iterator begin() const {
+        if (containers.empty()) return end();
+        return const_iterator(&containers, containers.begin(), containers.begin()->second.First());
+    }
+
+    const_iterator end() const { return const_iterator(&containers, containers.end(), -1); }
+
+    std::pair<const_iterator, bool> insert(const KeyType &key) {
+        uint64_t value = Encode(key);
+        auto container = containers.find(value >> 16);
+        if (container == containers.end()) {
+            container = containers.emplace(value >> 16,
+                                           Container(containers.get_allocator()
+                                                         .get_segment_manager())).first;
+        }
+        bool inserted = container->second.Add(static_cast<uint16_t>(value));
+        if (inserted) ++keys;
+        return std::make_pair(find(key), inserted);
+    }
+
+    size_t erase(const KeyType &key) {
+        uint64_t value = Encode(key);
+        auto container = containers.find(value >> 16);
+        if (container == containers.end() ||
+            !container->second.Remove(static_cast<uint16_t>(value))) {
+            return 0;
+        }
+        if (container->second.cardinality == 0) containers.erase(container);
+        --keys;
+        return 1;
+    }
+
+    const_iterator erase(const_iterator position) {
+        KeyType key = *position;
+        erase(key);
+        return upper_bound(key);
+    }
+
+    size_t count(const KeyType &key) const {
+        uint64_t value = Encode(key);
+        auto container = containers.find(value >> 16);
+        return container != containers.end() &&
+               container->second.Contains(static_cast<uint16_t>(value));
+    }
+
+    const_iterator find(const KeyType &key) const {
+        const_iterator found = lower_bound(key);
+        return found != end() && *found == key ? found : end();
+    }
+
+    const_iterator lower_bound(const KeyType &key) const {
+        uint64_t value = Encode(key);
+        auto container = containers.lower_bound(value >> 16);
+        if (container == containers.end()) return end();
+        int32_t position = container->first == value >> 16
+                           ? container->second.LowerBound(value & 0xFFFF)
+                           : container->second.First();
+        if (position < 0 && ++container != containers.end()) {
+            position = container->second.First();
+        }
+        return const_iterator(&containers, container, position);
+    }
+
+    const_iterator upper_bound(const KeyType &key) const {
+        if (Encode(key) == Encode(std::numeric_limits<KeyType>::max())) return end();
+        return lower_bound(static_cast<KeyType>(key + 1));
+    }
+
+    /**
+     * Number of keys in [first, last], counting whole bitmap words.
+     */
+    size_t count_range(const KeyType &first, const KeyType &last) const {
+        uint64_t low = Encode(first), high = Encode(last);
+        if (high < low) return 0;
+        size_t total = 0;
+        for (auto container = containers.lower_bound(low >> 16);
+             container != containers.end() && container->first <= high >> 16; ++container) {
+            const Container &keys = container->second;
+            uint32_t from = container->first == low >> 16 ? low & 0xFFFF : 0;
+            uint32_t to = container->first == high >> 16 ? high & 0xFFFF : 0xFFFF;
+            if (from == 0 && to == 0xFFFF) {
+                total += keys.cardinality;
+            } else if (!keys.IsBitmap()) {
+                total += std::upper_bound(keys.array.begin(), keys.array.end(), to) -
+                         std::lower_bound(keys.array.begin(), keys.array.end(), from);
+            } else {
+                for (uint32_t word = from >> 6; word <= to >> 6; ++word) {
+                    uint64_t bits = keys.bitmap[word];
+                    if (word == from >> 6) bits &= ~uint64_t(0) << (from & 63);
+                    if (word == to >> 6) bits &= ~uint64_t(0) >> (63 - (to & 63));
+                    total += __builtin_popcountll(bits);
+                }
+            }
+        }
+        return total;
+    }
+};
+
+/**
+ * The container a partition of a set keeps its keys in: a RoaringSet for
+ * integral keys in their natural order, else a tree.
+ */
+template<typename KeyType, typename Compare, typename Allocator>
+using SetContainer = typename std::conditional<
+    std::is_integral<KeyType>::value && !std::is_same<KeyType, bool>::value &&
+    std::is_same<Compare, std::less<KeyType>>::value,
+    RoaringSet<KeyType>,
+    boost::interprocess::set<KeyType, Compare, Allocator>>::type;
+
+/**
+ * Number of keys of a set partition in [first, last]: whole bitmap words for
+ * a RoaringSet, a walk of the range for a tree.
+ */
+template<typename KeyType>
+size_t CountInRange(const RoaringSet<KeyType> &keys, const KeyType &first, const KeyType &last) {
+    return keys.count_range(first, last);
+}
+
+template<typename Set, typename KeyType>
+size_t CountInRange(const Set &keys, const KeyType &first, const KeyType &last) {
+    if (keys.key_comp()(last, first)) return 0;
+    return std::distance(keys.lower_bound(first), keys.upper_bound(last));
+}
+
+}  // namespace basket
+
+#endif  // INCLUDE_BASKET_COMMON_ROARING_SET_H_
@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2019  Hariharan Devarajan, Keith Bateman
+ *
+ * This file is part of Basket
+ *
+ * Basket is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/*-------------------------------------------------------------------------
+ *
+ * Created: serialization.h
+ *
+ * Purpose: Defines the raw byte encoding of trivially copyable keys and
+ * values for the RPC layers.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef INCLUDE_BASKET_COMMON_SERIALIZATION_H_
+#define INCLUDE_BASKET_COMMON_SERIALIZATION_H_
+
+#include <cstring>
+#include <type_traits>
+#include <utility>
+
+#ifdef BASKET_ENABLE_RPCLIB
+#include <rpc/msgpack.hpp>
+#endif
+
+namespace basket {
+
+/**
+ * Whether T may travel as its object representation. This holds for
+ * trivially copyable classes by default; specialize it to false for types
+ * holding pointers, or to true for types whose copy is trivial in effect.
+ * Servers and clients must share the architecture, as bytes are sent as is.
+ */
+template<typename T, typename Enable = void>
+struct is_raw_serializable
+        : std::integral_constant<bool, std::is_trivially_copyable<T>::value &&
+                                       std::is_class<T>::value> {};
+
+#ifdef BASKET_ENABLE_RPCLIB
+/* Only types encoded through MSGPACK_DEFINE take the raw path, so the
+ * adaptors msgpack ships for std types are never shadowed. */
+template<typename T, typename Enable = void>
+struct has_msgpack_define : std::false_type {};
+
+template<typename T>
+struct has_msgpack_define<T, decltype(std::declval<T &>().msgpack_unpack(
+        std::declval<clmdep_msgpack::object const &>()))> : std::true_type {};
+
+template<typename T>
+struct use_raw_msgpack
+        : std::integral_constant<bool, is_raw_serializable<T>::value &&
+                                       has_msgpack_define<T>::value> {};
+#endif
+
+/**
+ * Thallium serialize body for raw types, used as
+ * template<typename A> void serialize(A &ar) { basket::raw_serialize(ar, *this); }
+ * The value is copied in and out of the archive with a single memcpy.
+ */
+template<typename A, typename T>
+auto raw_serialize(A &ar, const T &value)
+        -> decltype(ar.write(&value, 1), void()) {
+    static_assert(is_raw_serializable<T>::value, "type is not raw serializable");
+    ar.write(&value, 1);
+}
+
+template<typename A, typename T>
+auto raw_serialize(A &ar, const T &value)
+        -> decltype(ar.read(const_cast<T *>(&value), 1), void()) {
+    static_assert(is_raw_serializable<T>::value, "type is not raw serializable");
+    ar.read(const_cast<T *>(&value), 1);
+}
+
+}  // namespace basket
+
+#ifdef BASKET_ENABLE_RPCLIB
+namespace clmdep_msgpack {
+MSGPACK_API_VERSION_NAMESPACE(MSGPACK_DEFAULT_API_NS) {
+    namespace adaptor {
+    namespace mv1 = clmdep_msgpack::v1;
+    template<typename T>
+    struct convert<T, typename std::enable_if<basket::use_raw_msgpack<T>::value>::type> {
+        mv1::object const &operator()(mv1::object const &o, T &input) const {
+            if (o.type != clmdep_msgpack::type::BIN || o.via.bin.size != sizeof(T))
+                throw clmdep_msgpack::type_error();
+            std::memcpy(static_cast<void *>(&input), o.via.bin.ptr, sizeof(T));
+            return o;
+        }
+    };
+
+    template<typename T>
+    struct pack<T, typename std::enable_if<basket::use_raw_msgpack<T>::value>::type> {
+        template<typename Stream>
+        packer <Stream> &operator()(mv1::packer <Stream> &o, T const &input) const {
+            o.pack_bin(sizeof(T));
+            o.pack_bin_body(reinterpret_cast<const char *>(&input), sizeof(T));
+            return o;
+        }
+    };
+
+    template<typename T>
+    struct object_with_zone<T, typename std::enable_if<basket::use_raw_msgpack<T>::value>::type> {
+        void operator()(mv1::object::with_zone &o, T const &input) const {
+            o.type = clmdep_msgpack::type::BIN;
+            char *ptr = static_cast<char *>(
+                o.zone.allocate_align(sizeof(T), MSGPACK_ZONE_ALIGNOF(char)));
+            o.via.bin.ptr = ptr;
+            o.via.bin.size = sizeof(T);
+            std::memcpy(ptr, &input, sizeof(T));
+        }
+    };
+    }  // namespace adaptor
+}
+}  // namespace clmdep_msgpack
+#endif
+
+#endif  // INCLUDE_BASKET_COMMON_SERIALIZATION_H_
@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2019  Hariharan Devarajan, Keith Bateman
+ *
+ * This file is part of Basket
+ *
+ * Basket is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/*-------------------------------------------------------------------------
+ *
+ * Created: set_algebra.h
+ *
+ * Purpose: Defines the merge walk servers use to intersect, unite and
+ * subtract the sorted partitions of two sets.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+
+#ifndef INCLUDE_BASKET_COMMON_SET_ALGEBRA_H_
+#define INCLUDE_BASKET_COMMON_SET_ALGEBRA_H_
+
+#include <basket/common/enumerations.h>
+
+namespace basket {
+
+/**
+ * Walk the result of op on two sorted ranges without duplicates in order,
+ * like std::set_intersection and friends, but stopping as soon as visit
+ * asks to. Each range is read once, so the walk is linear in the elements
+ * it passes.
+ * @param compare, the strict weak order both ranges are sorted in
+ * @param visit, callable (element) returning false to stop the walk
+ */
+template<typename Iterator, typename Compare, typename Visit>
+void SetMergeWalk(SetOperation op, Iterator a, Iterator a_end, Iterator b, Iterator b_end,
+                  Compare compare, Visit visit) {
+    while (a != a_end && b != b_end) {
+        if (compare(*a, *b)) {
+            if (op != SET_INTERSECTION && !visit(*a)) return;
+            ++a;
+        } else if (compare(*b, *a)) {
+            if (op == SET_UNION && !visit(*b)) return;
+            ++b;
+        } else {
+            if (op != SET_DIFFERENCE && !visit(*a)) return;
+            ++a;
+            ++b;
+        }
+    }
+    if (op == SET_INTERSECTION) return;
+    for (; a != a_end; ++a) {
+        if (!visit(*a)) return;
+    }
+    if (op != SET_UNION) return;
+    for (; b != b_end; ++b) {
+        if (!visit(*b)) return;
+    }
+}
+
+}  // namespace basket
+
+#endif  // INCLUDE_BASKET_COMMON_SET_ALGEBRA_H_
@@ -0,0 +1,148 @@
+/*
+ * Copyright (C) 2019  Hariharan Devarajan, Keith Bateman
+ *
+ * This file is part of Basket
+ *
+ * Basket is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/*-------------------------------------------------------------------------
+ *
+ * Created: value_list.h
+ *
+ * Purpose: Defines the list the values of a multimap key are kept in.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef INCLUDE_BASKET_COMMON_VALUE_LIST_H_
+#define INCLUDE_BASKET_COMMON_VALUE_LIST_H_
+
+#include <boost/interprocess/containers/vector.hpp>
+#include <cstddef>
+#include <iterator>
+#include <utility>
+
+namespace basket {
+
+/**
+ * The values of one key, oldest first, living in a mapped segment. A list
+ * is never empty: the oldest value is kept inline, so a key with a single
+ * value allocates nothing beyond its map node, and the younger values go
+ * to an overflow vector. Replacing the oldest value moves the next one
+ * inline and advances a head offset into the overflow, which is compacted
+ * once half of it is dead, so each replacement costs O(1) amortized
+ * instead of shifting every value.
+ *
+ * @tparam T, the value type
+ * @tparam Allocator, the segment allocator of T
+ */
+template<typename T, typename Allocator>
+class ValueList {
+  private:
+    typedef boost::interprocess::vector<T, Allocator> Overflow;
+
+    T oldest;
+    Overflow overflow;
+    /* values before head in overflow were already moved out */
+    size_t head;
+
+    void Compact() {
+        if (head == 0 || head < overflow.size() - head) return;
+        overflow.erase(overflow.begin(), overflow.begin() + head);
+        head = 0;
+    }
+
+  public:
+    /**
+     * Forward iterator over the values, oldest first.
+     */
+    class const_iterator {
+      private:
+        friend class ValueList;
+        const ValueList *list;
+        size_t index;
+
+        const_iterator(const ValueList *list_, size_t index_) : list(list_), index(index_) {}
+
+      public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef T value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const T *pointer;
+        typedef const T &reference;
+
+        const_iterator() : list(nullptr), index(0) {}
+
+        const T &operator*() const {
+            return index == 0 ? list->oldest : list->overflow[list->head + index - 1];
+        }
+
+        const T *operator->() const { return &**this; }
+
+        const_iterator &operator++() {
+            ++index;
+            return *this;
+        }
+
+        const_iterator operator++(int) {
+            const_iterator previous = *this;
+            ++index;
+            return previous;
+        }
+
+        bool operator==(const const_iterator &other) const { return index == other.index; }
+
+        bool operator!=(const const_iterator &other) const { return index != other.index; }
+    };
+    typedef const_iterator iterator;
+    typedef T value_type;
+
+    ValueList(const T &value, const Allocator &allocator)
+            : oldest(value), overflow(allocator), head(0) {}
+
+    size_t size() const { return 1 + overflow.size() - head; }
+
+    const T &front() const { return oldest; }
+
+    const_iterator begin() const { return const_iterator(this, 0); }
+
+    const_iterator end() const { return const_iterator(this, size()); }
+
+    void push_back(const T &value) { overflow.push_back(value); }
+
+    template<typename Iterator>
+    void append(Iterator first, Iterator last) {
+        Compact();
+        overflow.insert(overflow.end(), first, last);
+    }
+
+    /**
+     * Drop the oldest value and append value, keeping the size.
+     */
+    void replace_oldest(const T &value) {
+        if (head == overflow.size()) {
+            oldest = value;
+            return;
+        }
+        oldest = std::move(overflow[head++]);
+        overflow.push_back(value);
+        Compact();
+    }
+};
+
+}  // namespace basket
+
+#endif  // INCLUDE_BASKET_COMMON_VALUE_LIST_H_
@@ -36,7 +36,10 @@ map<KeyType, MappedType, Compare>::map(std::string name_)
           comm_size(1), my_rank(0), memory_allocated(BASKET_CONF->MEMORY_ALLOCATED),
           name(name_), segment(), mymap(), func_prefix(name_),
           backed_file(BASKET_CONF->BACKED_FILE_DIR + PATH_SEPARATOR + name_+"_"+std::to_string(my_server)),
-          server_on_node(BASKET_CONF->SERVER_ON_NODE)
+          server_on_node(BASKET_CONF->SERVER_ON_NODE), leases(nullptr),
+          cache(BASKET_CONF->CLIENT_CACHE_SIZE), hot_keys(nullptr), bloom(nullptr),
+          bloom_filters(BASKET_CONF->BLOOM_FILTER_BITS, BASKET_CONF->BLOOM_FILTER_HASHES,
+                        BASKET_CONF->BLOOM_FILTER_REFRESH, BASKET_CONF->NUM_SERVERS)
 {
     AutoTrace trace = AutoTrace("basket::map");
     /* Initialize MPI rank and size of world */
@@ -56,8 +59,24 @@ map<KeyType, MappedType, Compare>::map(std::string name_)
         ShmemAllocator alloc_inst(segment.get_segment_manager());
         /* Construct map in the shared memory space. */
         mymap = segment.construct<MyMap>(name.c_str())(Compare(), alloc_inst);
-        mutex = segment.construct<boost::interprocess::interprocess_mutex>(
+        mutex = segment.construct<boost::interprocess::interprocess_sharable_mutex>(
             "mtx")();
+        /* Construct the lease table if clients may cache our values. */
+        if (BASKET_CONF->CLIENT_CACHE_SIZE > 0 && BASKET_CONF->CLIENT_CACHE_LEASE > 0) {
+            leases = segment.construct<LeaseTable<KeyType>>("leases")(
+                BASKET_CONF->CLIENT_CACHE_LEASE, segment.get_segment_manager());
+        }
+        /* Construct the hot key sketch if access tracking is enabled. */
+        if (BASKET_CONF->HOT_KEY_CAPACITY > 0) {
+            hot_keys = segment.construct<HotKeySketch<KeyType>>("hot_keys")(
+                BASKET_CONF->HOT_KEY_CAPACITY, segment.get_segment_manager());
+        }
+        /* Construct the Bloom filter clients use to skip absent keys. */
+        if (BASKET_CONF->BLOOM_FILTER_BITS > 0) {
+            bloom = segment.construct<CountingBloomFilter>("bloom_filter")(
+                BASKET_CONF->BLOOM_FILTER_BITS, BASKET_CONF->BLOOM_FILTER_HASHES,
+                segment.get_segment_manager());
+        }
         /* Create a RPC server and map the methods to it. */
         switch (BASKET_CONF->RPC_IMPLEMENTATION) {
 #ifdef BASKET_ENABLE_RPCLIB
@@ -65,12 +84,16 @@ map<KeyType, MappedType, Compare>::map(std::string name_)
                 std::function<bool(KeyType &, MappedType &)> putFunc(
                     std::bind(&map<KeyType, MappedType, Compare>::LocalPut, this,
                               std::placeholders::_1, std::placeholders::_2));
-                std::function<std::pair<bool, MappedType>(KeyType &)> getFunc(
+                std::function<Optional<MappedType>(KeyType &)> getFunc(
                     std::bind(&map<KeyType, MappedType, Compare>::LocalGet, this,
                               std::placeholders::_1));
-                std::function<std::pair<bool, MappedType>(KeyType &)> eraseFunc(
+                std::function<bool(KeyType &)> eraseFunc(
                     std::bind(&map<KeyType, MappedType, Compare>::LocalErase, this,
                               std::placeholders::_1));
+                std::function<std::pair<Optional<MappedType>, HTime>(KeyType &)>
+                        getWithLeaseFunc(std::bind(
+                            &map<KeyType, MappedType, Compare>::LocalGetWithLease, this,
+                            std::placeholders::_1));
                 std::function<std::vector<std::pair<KeyType, MappedType>>(void)>
                         getAllDataInServerFunc(std::bind(
                             &map<KeyType, MappedType, Compare>::LocalGetAllDataInServer,
@@ -80,11 +103,37 @@ map<KeyType, MappedType, Compare>::map(std::string name_)
                                                        Compare>::LocalContainsInServer, this,
                                                        std::placeholders::_1, std::placeholders::_2));
 
+                std::function<std::vector<std::pair<KeyType, std::pair<uint64_t, uint64_t>>>(uint32_t)> hotKeysFunc(
+                    std::bind(&map<KeyType, MappedType, Compare>::LocalHotKeys, this,
+                              std::placeholders::_1));
+                std::function<bool(KeyType &, MappedType &)> putIfAbsentFunc(
+                    std::bind(&map<KeyType, MappedType, Compare>::LocalPutIfAbsent, this,
+                              std::placeholders::_1, std::placeholders::_2));
+                std::function<bool(KeyType &, MappedType &, MappedType &)> compareAndSwapFunc(
+                    std::bind(&map<KeyType, MappedType, Compare>::LocalCompareAndSwap, this,
+                              std::placeholders::_1, std::placeholders::_2,
+                              std::placeholders::_3));
+                std::function<std::vector<uint64_t>(void)> bloomFilterFunc(
+                    std::bind(&map<KeyType, MappedType, Compare>::LocalBloomFilter, this));
+                std::function<std::vector<std::pair<KeyType, MappedType>>(uint32_t)> seekFirstNFunc(
+                    std::bind(&map<KeyType, MappedType, Compare>::LocalSeekFirstN, this,
+                              std::placeholders::_1));
+                std::function<std::vector<std::pair<KeyType, MappedType>>(KeyType &, uint32_t)>
+                        seekNextNFunc(std::bind(
+                            &map<KeyType, MappedType, Compare>::LocalSeekNextN, this,
+                            std::placeholders::_1, std::placeholders::_2));
                 rpc->bind(func_prefix+"_Put", putFunc);
+                rpc->bind(func_prefix+"_PutIfAbsent", putIfAbsentFunc);
+                rpc->bind(func_prefix+"_CompareAndSwap", compareAndSwapFunc);
                 rpc->bind(func_prefix+"_Get", getFunc);
                 rpc->bind(func_prefix+"_Erase", eraseFunc);
+                rpc->bind(func_prefix+"_GetWithLease", getWithLeaseFunc);
                 rpc->bind(func_prefix+"_GetAllData", getAllDataInServerFunc);
+                rpc->bind(func_prefix+"_HotKeys", hotKeysFunc);
+                rpc->bind(func_prefix+"_BloomFilter", bloomFilterFunc);
                 rpc->bind(func_prefix+"_Contains", containsInServerFunc);
+                rpc->bind(func_prefix+"_SeekFirstN", seekFirstNFunc);
+                rpc->bind(func_prefix+"_SeekNextN", seekNextNFunc);
                 break;
             }
 #endif
@@ -107,6 +156,9 @@ map<KeyType, MappedType, Compare>::map(std::string name_)
                     std::function<void(const tl::request &, KeyType &)> eraseFunc(
                         std::bind(&map<KeyType, MappedType, Compare>::ThalliumLocalErase, this,
                                   std::placeholders::_1, std::placeholders::_2));
+                    std::function<void(const tl::request &, KeyType &)> getWithLeaseFunc(
+                        std::bind(&map<KeyType, MappedType, Compare>::ThalliumLocalGetWithLease, this,
+                                  std::placeholders::_1, std::placeholders::_2));
                     std::function<void(const tl::request &)>
                             getAllDataInServerFunc(std::bind(
                                 &map<KeyType, MappedType, Compare>::ThalliumLocalGetAllDataInServer,
@@ -118,11 +170,40 @@ map<KeyType, MappedType, Compare>::map(std::string name_)
 							   std::placeholders::_2,
 							   std::placeholders::_3));
 
+                    std::function<void(const tl::request &, uint32_t)> hotKeysFunc(
+                        std::bind(&map<KeyType, MappedType, Compare>::ThalliumLocalHotKeys, this,
+                                  std::placeholders::_1, std::placeholders::_2));
+                    std::function<void(const tl::request &, KeyType &, MappedType &)> putIfAbsentFunc(
+                        std::bind(&map<KeyType, MappedType, Compare>::ThalliumLocalPutIfAbsent, this,
+                                  std::placeholders::_1, std::placeholders::_2,
+                                  std::placeholders::_3));
+                    std::function<void(const tl::request &, KeyType &, MappedType &, MappedType &)>
+                            compareAndSwapFunc(std::bind(
+                                &map<KeyType, MappedType, Compare>::ThalliumLocalCompareAndSwap, this,
+                                std::placeholders::_1, std::placeholders::_2,
+                                std::placeholders::_3, std::placeholders::_4));
+                    std::function<void(const tl::request &)> bloomFilterFunc(
+                        std::bind(&map<KeyType, MappedType, Compare>::ThalliumLocalBloomFilter, this,
+                                  std::placeholders::_1));
+                    std::function<void(const tl::request &, uint32_t)> seekFirstNFunc(
+                        std::bind(&map<KeyType, MappedType, Compare>::ThalliumLocalSeekFirstN, this,
+                                  std::placeholders::_1, std::placeholders::_2));
+                    std::function<void(const tl::request &, KeyType &, uint32_t)> seekNextNFunc(
+                        std::bind(&map<KeyType, MappedType, Compare>::ThalliumLocalSeekNextN, this,
+                                  std::placeholders::_1, std::placeholders::_2,
+                                  std::placeholders::_3));
                     rpc->bind(func_prefix+"_Put", putFunc);
+                    rpc->bind(func_prefix+"_PutIfAbsent", putIfAbsentFunc);
+                    rpc->bind(func_prefix+"_CompareAndSwap", compareAndSwapFunc);
                     rpc->bind(func_prefix+"_Get", getFunc);
                     rpc->bind(func_prefix+"_Erase", eraseFunc);
+                    rpc->bind(func_prefix+"_GetWithLease", getWithLeaseFunc);
                     rpc->bind(func_prefix+"_GetAllData", getAllDataInServerFunc);
+                    rpc->bind(func_prefix+"_HotKeys", hotKeysFunc);
+                    rpc->bind(func_prefix+"_BloomFilter", bloomFilterFunc);
                     rpc->bind(func_prefix+"_Contains", containsInServerFunc);
+                    rpc->bind(func_prefix+"_SeekFirstN", seekFirstNFunc);
+                    rpc->bind(func_prefix+"_SeekNextN", seekNextNFunc);
                     break;
                 }
 #endif
@@ -135,10 +216,13 @@ map<KeyType, MappedType, Compare>::map(std::string name_)
                   boost::interprocess::managed_mapped_file::size_type> res;
         res = segment.find<MyMap> (name.c_str());
         mymap = res.first;
-        std::pair<boost::interprocess::interprocess_mutex *,
+        std::pair<boost::interprocess::interprocess_sharable_mutex *,
                   boost::interprocess::managed_mapped_file::size_type> res2;
-        res2 = segment.find<boost::interprocess::interprocess_mutex>("mtx");
+        res2 = segment.find<boost::interprocess::interprocess_sharable_mutex>("mtx");
         mutex = res2.first;
+        hot_keys = segment.find<HotKeySketch<KeyType>>("hot_keys").first;
+        leases = segment.find<LeaseTable<KeyType>>("leases").first;
+        bloom = segment.find<CountingBloomFilter>("bloom_filter").first;
     }
 }
 
@@ -152,8 +236,11 @@ template<typename KeyType, typename MappedType, typename Compare>
 bool map<KeyType, MappedType, Compare>::LocalPut(KeyType &key,
                                                  MappedType &data) {
     AutoTrace trace = AutoTrace("basket::map::Put(local)", key, data);
-    boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex> lock(*mutex);
-    mymap->insert_or_assign(key, data);
+    if (hot_keys != nullptr) hot_keys->Record(key, PayloadSize(key) + PayloadSize(data));
+    boost::interprocess::scoped_lock<boost::interprocess::interprocess_sharable_mutex> lock(*mutex);
+    if (leases != nullptr) leases->WaitForWrite(lock, key);
+    if (mymap->insert_or_assign(key, data).second && bloom != nullptr)
+        bloom->Add(keyHash(key));
     /*typename MyMap::iterator iterator = mymap->find(key);
       if (iterator != mymap->end()) {
       mymap->erase(iterator);
@@ -164,6 +251,8 @@ bool map<KeyType, MappedType, Compare>::LocalPut(KeyType &key,
 
 /**
  * Put the data into the map. Uses key to decide the server to hash it to,
+ * A remote Put waits on the server until all leases on key expired, including
+ * the one held by this client.
  * @param key, the key for put
  * @param data, the value for put
  * @return bool, true if Put was successful else false.
@@ -177,64 +266,207 @@ bool map<KeyType, MappedType, Compare>::Put(KeyType &key,
         return LocalPut(key, data);
     } else {
         AutoTrace trace = AutoTrace("basket::map::Put(remote)", key, data);
+        if (cache.Enabled()) cache.Erase(key);
+        if (bloom_filters.Enabled()) bloom_filters.Add(key_int, key_hash);
         return RPC_CALL_WRAPPER("_Put", key_int, bool,
                                 key, data);
     }
 }
 
+/**
+ * Put the data into the local map unless key is already present.
+ * @param key, the key for put
+ * @param data, the value for put
+ * @return bool, true if data was inserted, false if key was present.
+ */
+template<typename KeyType, typename MappedType, typename Compare>
+bool map<KeyType, MappedType, Compare>::LocalPutIfAbsent(KeyType &key, MappedType &data) {
+    AutoTrace trace = AutoTrace("basket::map::PutIfAbsent(local)", key, data);
+    if (hot_keys != nullptr) hot_keys->Record(key, PayloadSize(key) + PayloadSize(data));
+    boost::interprocess::scoped_lock<boost::interprocess::interprocess_sharable_mutex>
+            lock(*mutex);
+    /* an existing value is never overwritten, so leases need not expire */
+    bool inserted = mymap->try_emplace(key, data).second;
+    if (inserted && bloom != nullptr) bloom->Add(keyHash(key));
+    return inserted;
+}
+
+/**
+ * Put the data into the map unless key is already present. Uses key to
+ * decide the server to hash it to, the check and the insert run on the
+ * server in a single request.
+ * @param key, the key for put
+ * @param data, the value for put
+ * @return bool, true if data was inserted, false if key was present.
+ */
+template<typename KeyType, typename MappedType, typename Compare>
+bool map<KeyType, MappedType, Compare>::PutIfAbsent(KeyType &key, MappedType &data) {
+    uint16_t key_int = static_cast<uint16_t>(keyHash(key) % num_servers);
+    if (key_int == my_server && server_on_node) {
+        return LocalPutIfAbsent(key, data);
+    } else {
+        AutoTrace trace = AutoTrace("basket::map::PutIfAbsent(remote)", key, data);
+        if (cache.Enabled()) cache.Erase(key);
+        if (bloom_filters.Enabled()) bloom_filters.Add(key_int, keyHash(key));
+        return RPC_CALL_WRAPPER("_PutIfAbsent", key_int, bool, key, data);
+    }
+}
+
+/**
+ * Replace the value of key in the local map by desired if it equals
+ * expected. MappedType has to provide operator==.
+ * @param key, the key to swap
+ * @param expected, the value key must hold
+ * @param desired, the new value
+ * @return bool, true if the value was replaced, false if key was missing or
+ * held another value.
+ */
+template<typename KeyType, typename MappedType, typename Compare>
+bool map<KeyType, MappedType, Compare>::LocalCompareAndSwap(KeyType &key, MappedType &expected,
+                                                  MappedType &desired) {
+    AutoTrace trace = AutoTrace("basket::map::CompareAndSwap(local)", key);
+    if (hot_keys != nullptr) hot_keys->Record(key, PayloadSize(key) + PayloadSize(expected) + PayloadSize(desired));
+    boost::interprocess::scoped_lock<boost::interprocess::interprocess_sharable_mutex>
+            lock(*mutex);
+    if (leases != nullptr) leases->WaitForWrite(lock, key);
+    auto iterator = mymap->find(key);
+    if (iterator == mymap->end() || !(iterator->second == expected)) {
+        return false;
+    }
+    iterator->second = desired;
+    return true;
+}
+
+/**
+ * Replace the value of key by desired if it equals expected. Uses key to
+ * decide the server to hash it to, the compare and the swap run on the
+ * server in a single request.
+ * @param key, the key to swap
+ * @param expected, the value key must hold
+ * @param desired, the new value
+ * @return bool, true if the value was replaced, false if key was missing or
+ * held another value.
+ */
+template<typename KeyType, typename MappedType, typename Compare>
+bool map<KeyType, MappedType, Compare>::CompareAndSwap(KeyType &key, MappedType &expected,
+                                             MappedType &desired) {
+    uint16_t key_int = static_cast<uint16_t>(keyHash(key) % num_servers);
+    if (key_int == my_server && server_on_node) {
+        return LocalCompareAndSwap(key, expected, desired);
+    } else {
+        AutoTrace trace = AutoTrace("basket::map::CompareAndSwap(remote)", key);
+        if (cache.Enabled()) cache.Erase(key);
+        return RPC_CALL_WRAPPER("_CompareAndSwap", key_int, bool,
+                                key, expected, desired);
+    }
+}
+
 /**
  * Get the data in the local map.
  * @param key, key to get
- * @return return a pair of bool and Value. If bool is true then
- * data was found and is present in value part else bool is set to false
+ * @return an Optional holding the value if the key was found, empty
+ * otherwise
  */
 template<typename KeyType, typename MappedType, typename Compare>
-std::pair<bool, MappedType>
+Optional<MappedType>
 map<KeyType, MappedType, Compare>::LocalGet(KeyType &key) {
     AutoTrace trace = AutoTrace("basket::map::Get(local)", key);
-    boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex>
+    boost::interprocess::sharable_lock<boost::interprocess::interprocess_sharable_mutex>
             lock(*mutex);
     typename MyMap::iterator iterator = mymap->find(key);
+    if (hot_keys != nullptr) {
+        hot_keys->Record(key, PayloadSize(key) + (iterator != mymap->end()
+                                                  ? PayloadSize(iterator->second) : 0));
+    }
     if (iterator != mymap->end()) {
-        return std::pair<bool, MappedType>(true, iterator->second);
+        return Optional<MappedType>(iterator->second);
     } else {
-        return std::pair<bool, MappedType>(false, MappedType());
+        return Optional<MappedType>();
+    }
+}
+
+/**
+ * Get the data in the local map and grant a lease on it, so that the caller
+ * may cache the value until the lease runs out.
+ * @param key, key to get
+ * @return return a pair of the LocalGet result and the granted lease in
+ * microseconds. A lease of 0 means the value must not be cached.
+ */
+template<typename KeyType, typename MappedType, typename Compare>
+std::pair<Optional<MappedType>, HTime>
+map<KeyType, MappedType, Compare>::LocalGetWithLease(KeyType &key) {
+    AutoTrace trace = AutoTrace("basket::map::GetWithLease(local)", key);
+    boost::interprocess::sharable_lock<boost::interprocess::interprocess_sharable_mutex>
+            lock(*mutex);
+    typename MyMap::iterator iterator = mymap->find(key);
+    if (hot_keys != nullptr) {
+        hot_keys->Record(key, PayloadSize(key) + (iterator != mymap->end()
+                                                  ? PayloadSize(iterator->second) : 0));
+    }
+    if (iterator != mymap->end()) {
+        HTime lease = leases != nullptr ? leases->Grant(key) : 0;
+        return std::make_pair(Optional<MappedType>(iterator->second), lease);
+    } else {
+        return std::make_pair(Optional<MappedType>(), HTime(0));
     }
 }
 
 /**
  * Get the data in the map. Uses key to decide the server to hash it to,
+ * Remote values are served from the client cache while their lease lasts.
+ * With BLOOM_FILTER_BITS set, a remote Get is only eventually consistent: a
+ * key another process inserted after this client last fetched the filter
+ * of its server may read as absent for up to BLOOM_FILTER_REFRESH
+ * microseconds. Keys this client put itself are seen at once, and
+ * BLOOM_FILTER_REFRESH 0 makes every remote Get ask the server.
  * @param key, key to get
- * @return return a pair of bool and Value. If bool is true then
- * data was found and is present in value part else bool is set to false
+ * @return an Optional holding the value if the key was found, empty
+ * otherwise
  */
 template<typename KeyType, typename MappedType, typename Compare>
-std::pair<bool, MappedType>
+Optional<MappedType>
 map<KeyType, MappedType, Compare>::Get(KeyType &key) {
     size_t key_hash = keyHash(key);
     uint16_t key_int = key_hash % num_servers;
     if (key_int == my_server && server_on_node) {
         return LocalGet(key);
+    } else if (!MayContain(key_int, key_hash)) {
+        return Optional<MappedType>();
+    } else if (cache.Enabled()) {
+        AutoTrace trace = AutoTrace("basket::map::Get(cached)", key);
+        Optional<MappedType> cached = cache.Get(key);
+        if (cached) return cached;
+        /* the lease is counted from before the request to stay conservative */
+        HTime start = LeaseClock();
+        typedef std::pair<Optional<MappedType>, HTime> ret_type;
+        auto result = RPC_CALL_WRAPPER("_GetWithLease", key_int, ret_type, key);
+        if (result.first && result.second > 0) {
+            cache.Put(key, *result.first, start + result.second);
+        }
+        return result.first;
     } else {
         AutoTrace trace = AutoTrace("basket::map::Get(remote)", key);
-        typedef std::pair<bool, MappedType> ret_type;
+        typedef Optional<MappedType> ret_type;
         return RPC_CALL_WRAPPER("_Get", key_int, ret_type,
                                 key);
     }
 }
 
 template<typename KeyType, typename MappedType, typename Compare>
-std::pair<bool, MappedType>
+bool
 map<KeyType, MappedType, Compare>::LocalErase(KeyType &key) {
     AutoTrace trace = AutoTrace("basket::map::Erase(local)", key);
-    boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex>
+    if (hot_keys != nullptr) hot_keys->Record(key, PayloadSize(key));
+    boost::interprocess::scoped_lock<boost::interprocess::interprocess_sharable_mutex>
             lock(*mutex);
+    if (leases != nullptr) leases->WaitForWrite(lock, key);
     size_t s = mymap->erase(key);
-    return std::pair<bool, MappedType>(s > 0, MappedType());
+    if (s > 0 && bloom != nullptr) bloom->Remove(keyHash(key));
+    return s > 0;
 }
 
 template<typename KeyType, typename MappedType, typename Compare>
-std::pair<bool, MappedType>
+bool
 map<KeyType, MappedType, Compare>::Erase(KeyType &key) {
     size_t key_hash = keyHash(key);
     uint16_t key_int = key_hash % num_servers;
@@ -242,7 +474,8 @@ map<KeyType, MappedType, Compare>::Erase(KeyType &key) {
         return LocalErase(key);
     } else {
         AutoTrace trace = AutoTrace("basket::map::Erase(remote)", key);
-        typedef std::pair<bool, MappedType> ret_type;
+        if (cache.Enabled()) cache.Erase(key);
+        typedef bool ret_type;
         return RPC_CALL_WRAPPER("_Erase", key_int, ret_type, key);
     }
 }
@@ -293,7 +526,7 @@ map<KeyType, MappedType, Compare>::LocalContainsInServer(KeyType &key_start,KeyT
     AutoTrace trace = AutoTrace("basket::map::ContainsInServer", key_start,key_end);
     auto final_values = std::vector<std::pair<KeyType, MappedType>>();
     {
-        boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex> lock(*mutex);
+        boost::interprocess::sharable_lock<boost::interprocess::interprocess_sharable_mutex> lock(*mutex);
         typename MyMap::iterator lower_bound;
         size_t size = mymap->size();
         if (size == 0) {
@@ -338,7 +571,7 @@ map<KeyType, MappedType, Compare>::LocalGetAllDataInServer() {
     AutoTrace trace = AutoTrace("basket::map::GetAllDataInServer", NULL);
     auto final_values = std::vector<std::pair<KeyType, MappedType>>();
     {
-        boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex> lock(*mutex);
+        boost::interprocess::sharable_lock<boost::interprocess::interprocess_sharable_mutex> lock(*mutex);
         typename MyMap::iterator lower_bound;
         lower_bound = mymap->begin();
         while (lower_bound != mymap->end()) {
@@ -362,4 +595,536 @@ map<KeyType, MappedType, Compare>::GetAllDataInServer() {
         return RPC_CALL_WRAPPER1("_GetAllData", my_server_i, ret_type);
    }
 }
+
+/**
+ * Get the first n entries of the local map, smallest key first.
+ * @param n, the most entries to return
+ */
+template<typename KeyType, typename MappedType, typename Compare>
+std::vector<std::pair<KeyType, MappedType>>
+map<KeyType, MappedType, Compare>::LocalSeekFirstN(uint32_t n) {
+    AutoTrace trace = AutoTrace("basket::map::SeekFirstN(local)", n);
+    boost::interprocess::sharable_lock<boost::interprocess::interprocess_sharable_mutex> lock(*mutex);
+    std::vector<std::pair<KeyType, MappedType>> entries;
+    for (auto iterator = mymap->begin();
+         iterator != mymap->end() && entries.size() < n; ++iterator) {
+        entries.emplace_back(iterator->first, iterator->second);
+    }
+    return entries;
+}
+
+/**
+ * Get up to n entries of the local map whose keys follow key, smallest
+ * key first.
+ * @param key, the key to continue after, it need not be in the map
+ * @param n, the most entries to return
+ */
+template<typename KeyType, typename MappedType, typename Compare>
+std::vector<std::pair<KeyType, MappedType>>
+map<KeyType, MappedType, Compare>::LocalSeekNextN(KeyType &key, uint32_t n) {
+    AutoTrace trace = AutoTrace("basket::map::SeekNextN(local)", key, n);
+    boost::interprocess::sharable_lock<boost::interprocess::interprocess_sharable_mutex> lock(*mutex);
+    std::vector<std::pair<KeyType, MappedType>> entries;
+    for (auto iterator = mymap->upper_bound(key);
+         iterator != mymap->end() && entries.size() < n; ++iterator) {
+        entries.emplace_back(iterator->first, iterator->second);
+    }
+    return entries;
+}
+
+/**
+ * Get the first n entries of the map on key_int, smallest key first.
+ * @param n, the most entries to return
+ * @param key_int, key_int to know which server
+ */
+template<typename KeyType, typename MappedType, typename Compare>
+std::vector<std::pair<KeyType, MappedType>>
+map<KeyType, MappedType, Compare>::SeekFirstN(uint32_t n, uint16_t &key_int) {
+    if (key_int == my_server && server_on_node) {
+        return LocalSeekFirstN(n);
+    } else {
+        AutoTrace trace = AutoTrace("basket::map::SeekFirstN(remote)", n, key_int);
+        typedef std::vector<std::pair<KeyType, MappedType>> ret_type;
+        return RPC_CALL_WRAPPER("_SeekFirstN", key_int, ret_type, n);
+    }
+}
+
+/**
+ * Get up to n entries of the map on key_int whose keys follow key.
+ * @param key, the key to continue after, it need not be in the map
+ * @param n, the most entries to return
+ * @param key_int, key_int to know which server
+ */
+template<typename KeyType, typename MappedType, typename Compare>
+std::vector<std::pair<KeyType, MappedType>>
+map<KeyType, MappedType, Compare>::SeekNextN(KeyType &key, uint32_t n, uint16_t &key_int) {
+    if (key_int == my_server && server_on_node) {
+        return LocalSeekNextN(key, n);
+    } else {
+        AutoTrace trace = AutoTrace("basket::map::SeekNextN(remote)", key, n, key_int);
+        typedef std::vector<std::pair<KeyType, MappedType>> ret_type;
+        return RPC_CALL_WRAPPER("_SeekNextN", key_int, ret_type, key, n);
+    }
+}
+
+/**
+ * Get one page of a scan of the map on key_int: its first n entries, or
+ * the n entries following after.
+ */
+template<typename KeyType, typename MappedType, typename Compare>
+std::vector<std::pair<KeyType, MappedType>>
+map<KeyType, MappedType, Compare>::SeekPage(uint16_t key_int,
+                                            const Optional<std::pair<KeyType, MappedType>> &after,
+                                            uint32_t n) {
+    if (!after) return SeekFirstN(n, key_int);
+    KeyType key = after->first;
+    return SeekNextN(key, n, key_int);
+}
+
+/**
+ * Get the n entries with the smallest keys across all servers. Each server
+ * sends at most SCAN_PAGE_SIZE entries at a time.
+ * @param n, the most entries to return
+ * @return a vector of the entries, smallest key first
+ */
+template<typename KeyType, typename MappedType, typename Compare>
+std::vector<std::pair<KeyType, MappedType>>
+map<KeyType, MappedType, Compare>::GlobalSeekFirstN(uint32_t n) {
+    AutoTrace trace = AutoTrace("basket::map::GlobalSeekFirstN", n);
+    OrderedScan scan(num_servers, std::min(n, BASKET_CONF->SCAN_PAGE_SIZE), KeyLess(),
+                     [this](uint16_t key_int, const Optional<std::pair<KeyType, MappedType>> &after,
+                            uint32_t page) { return SeekPage(key_int, after, page); });
+    return scan.NextN(n);
+}
+
+/**
+ * Iterate over all entries of the map in key order, unlike GetAllData
+ * which concatenates the partitions. The scan pulls SCAN_PAGE_SIZE entries
+ * from a server whenever it ran out of entries of it.
+ * @return the scan, call Next or NextN on it
+ */
+template<typename KeyType, typename MappedType, typename Compare>
+typename map<KeyType, MappedType, Compare>::OrderedScan
+map<KeyType, MappedType, Compare>::Scan() {
+    return OrderedScan(num_servers, BASKET_CONF->SCAN_PAGE_SIZE, KeyLess(),
+                       [this](uint16_t key_int, const Optional<std::pair<KeyType, MappedType>> &after,
+                              uint32_t page) { return SeekPage(key_int, after, page); });
+}
+
+/**
+ * Get the hottest keys of the local partition.
+ * @param k, number of keys to return
+ * @return a vector of key and (estimated hits, estimated bytes) pairs, the
+ * hottest first. Empty if HOT_KEY_CAPACITY is 0.
+ */
+template<typename KeyType, typename MappedType, typename Compare>
+std::vector<std::pair<KeyType, std::pair<uint64_t, uint64_t>>>
+map<KeyType, MappedType, Compare>::LocalHotKeys(uint32_t k) {
+    AutoTrace trace = AutoTrace("basket::map::HotKeys(local)", k);
+    if (hot_keys == nullptr) return std::vector<std::pair<KeyType, std::pair<uint64_t, uint64_t>>>();
+    return hot_keys->Top(k);
+}
+
+/**
+ * Get the hottest keys of a server partition.
+ * @param server, the server to query
+ * @param k, number of keys to return
+ * @return a vector of key and (estimated hits, estimated bytes) pairs, the
+ * hottest first.
+ */
+template<typename KeyType, typename MappedType, typename Compare>
+std::vector<std::pair<KeyType, std::pair<uint64_t, uint64_t>>>
+map<KeyType, MappedType, Compare>::HotKeys(uint16_t server, uint32_t k) {
+    if (server == my_server && server_on_node) {
+        return LocalHotKeys(k);
+    } else {
+        AutoTrace trace = AutoTrace("basket::map::HotKeys(remote)", server, k);
+        typedef std::vector<std::pair<KeyType, std::pair<uint64_t, uint64_t>>> ret_type;
+        return RPC_CALL_WRAPPER("_HotKeys", server, ret_type, k);
+    }
+}
+
+/**
+ * Get the Bloom filter of the local partition as a bit array.
+ * @return the words of the bit array, empty if the filter is disabled
+ */
+template<typename KeyType, typename MappedType, typename Compare>
+std::vector<uint64_t> map<KeyType, MappedType, Compare>::LocalBloomFilter() {
+    AutoTrace trace = AutoTrace("basket::map::BloomFilter(local)");
+    if (bloom == nullptr) return std::vector<uint64_t>();
+    boost::interprocess::sharable_lock<boost::interprocess::interprocess_sharable_mutex>
+            lock(*mutex);
+    return bloom->Snapshot();
+}
+
+/**
+ * Check the snapshot of the Bloom filter of server for a key, refreshing the
+ * snapshot every BLOOM_FILTER_REFRESH.
+ * @return false if the key is absent from the snapshot, true otherwise
+ */
+template<typename KeyType, typename MappedType, typename Compare>
+bool map<KeyType, MappedType, Compare>::MayContain(uint16_t server, size_t key_hash) {
+    if (!bloom_filters.Enabled()) return true;
+    return bloom_filters.MayContain(server, key_hash, [&]() {
+        AutoTrace trace = AutoTrace("basket::map::BloomFilter(remote)", server);
+        typedef std::vector<uint64_t> ret_type;
+        return RPC_CALL_WRAPPER1("_BloomFilter", server, ret_type);
+    });
+}
+
+/**
+ * Run visitor on the value of key in place in the local map, without
+ * copying it out of shared memory. The partition is read locked while
+ * visitor runs, so visitor must not call back into this map nor keep
+ * references to the value.
+ * @param key, key to visit
+ * @param visitor, callable taking a const MappedType &
+ * @return bool, true if key was found and visited
+ */
+template<typename KeyType, typename MappedType, typename Compare>
+template<typename Visitor>
+bool map<KeyType, MappedType, Compare>::LocalVisit(KeyType &key, Visitor visitor) {
+    AutoTrace trace = AutoTrace("basket::map::Visit(local)", key);
+    boost::interprocess::sharable_lock<boost::interprocess::interprocess_sharable_mutex>
+            lock(*mutex);
+    typename MyMap::iterator iterator = mymap->find(key);
+    if (hot_keys != nullptr) {
+        hot_keys->Record(key, PayloadSize(key) + (iterator != mymap->end()
+                                                  ? PayloadSize(iterator->second) : 0));
+    }
+    if (iterator == mymap->end()) return false;
+    visitor(static_cast<const MappedType &>(iterator->second));
+    return true;
+}
+
+/**
+ * Run visitor on the value of key. Uses key to decide the server to hash it
+ * to, on-node values are visited in place and remote values are fetched
+ * with Get and visited on the copy.
+ * @param key, key to visit
+ * @param visitor, callable taking a const MappedType &
+ * @return bool, true if key was found and visited
+ */
+template<typename KeyType, typename MappedType, typename Compare>
+template<typename Visitor>
+bool map<KeyType, MappedType, Compare>::Visit(KeyType &key, Visitor visitor) {
+    uint16_t key_int = static_cast<uint16_t>(keyHash(key) % num_servers);
+    if (key_int == my_server && server_on_node) {
+        return LocalVisit(key, visitor);
+    } else {
+        AutoTrace trace = AutoTrace("basket::map::Visit(remote)", key);
+        Optional<MappedType> result = Get(key);
+        if (!result) return false;
+        visitor(static_cast<const MappedType &>(*result));
+        return true;
+    }
+}
+
+/**
+ * Register op under op_name in this process and, on servers, bind the RPC
+ * running it. op edits the stored value in place and gets true, or for a
+ * missing key a value initialized MappedType and false, in which case the
+ * value is inserted only if op returns true. Every process that may run the
+ * update on-node has to register it. Args are value types and Update must be
+ * called with exactly these types.
+ * @param op_name, name of the update
+ * @param op, the update
+ */
+template<typename KeyType, typename MappedType, typename Compare>
+template<typename... Args>
+void map<KeyType, MappedType, Compare>::RegisterUpdate(
+        std::string op_name, std::function<bool(MappedType &, bool, Args...)> op) {
+    static_assert(std::conjunction<std::is_same<Args, std::decay_t<Args>>...>::value,
+                  "update arguments must be passed by value");
+    updates.Register(op_name, op);
+    if (!is_server) return;
+    std::string update_name = std::string("_Update_") + op_name;
+    switch (BASKET_CONF->RPC_IMPLEMENTATION) {
+#ifdef BASKET_ENABLE_RPCLIB
+        case RPCLIB: {
+            std::function<bool(KeyType &, Args...)> updateFunc(
+                [this, op_name](KeyType &key, Args... args) {
+                    return LocalUpdate<Args...>(key, op_name, args...);
+                });
+            rpc->bind(func_prefix + update_name, updateFunc);
+            break;
+        }
+#endif
+#ifdef BASKET_ENABLE_THALLIUM_TCP
+        case THALLIUM_TCP:
+#endif
+#ifdef BASKET_ENABLE_THALLIUM_ROCE
+        case THALLIUM_ROCE:
+#endif
+#if defined(BASKET_ENABLE_THALLIUM_TCP) || defined(BASKET_ENABLE_THALLIUM_ROCE)
+        {
+            std::function<void(const tl::request &, KeyType &, Args...)> updateFunc(
+                [this, op_name](const tl::request &thallium_req, KeyType &key,
+                                Args... args) {
+                    thallium_req.respond(LocalUpdate<Args...>(key, op_name, args...));
+                });
+            rpc->bind(func_prefix + update_name, updateFunc);
+            break;
+        }
+#endif
+    }
+}
+
+/**
+ * Run the update registered as op_name on key in the local map. The
+ * partition is write locked while the update runs.
+ * @param key, key to update
+ * @param op_name, name of the registered update
+ * @param args, arguments passed to the update
+ * @return bool, the result of the update, false if op_name is not registered
+ * with these argument types
+ */
+template<typename KeyType, typename MappedType, typename Compare>
+template<typename... Args>
+bool map<KeyType, MappedType, Compare>::LocalUpdate(KeyType &key, std::string op_name,
+                                  Args... args) {
+    AutoTrace trace = AutoTrace("basket::map::Update(local)", key);
+    auto op = updates.Find<std::function<bool(MappedType &, bool, Args...)>>(
+        op_name);
+    if (op == nullptr) return false;
+    if (hot_keys != nullptr) hot_keys->Record(key, PayloadSize(key));
+    boost::interprocess::scoped_lock<boost::interprocess::interprocess_sharable_mutex>
+            lock(*mutex);
+    if (leases != nullptr) leases->WaitForWrite(lock, key);
+    typename MyMap::iterator iterator = mymap->find(key);
+    if (iterator != mymap->end()) {
+        return (*op)(iterator->second, true, args...);
+    }
+    MappedType value = MappedType();
+    if (!(*op)(value, false, args...)) return false;
+    mymap->insert_or_assign(key, value);
+    if (bloom != nullptr) bloom->Add(keyHash(key));
+    return true;
+}
+
+/**
+ * Run the update registered as op_name on key. Uses key to decide the server
+ * to hash it to, the value is changed on the server in a single request.
+ * @param key, key to update
+ * @param op_name, name of the registered update
+ * @param args, arguments passed to the update
+ * @return bool, the result of the update
+ */
+template<typename KeyType, typename MappedType, typename Compare>
+template<typename... Args>
+bool map<KeyType, MappedType, Compare>::Update(KeyType &key, std::string op_name, Args... args) {
+    uint16_t key_int = static_cast<uint16_t>(keyHash(key) % num_servers);
+    if (key_int == my_server && server_on_node) {
+        return LocalUpdate(key, op_name, args...);
+    } else {
+        AutoTrace trace = AutoTrace("basket::map::Update(remote)", key);
+        if (cache.Enabled()) cache.Erase(key);
+        if (bloom_filters.Enabled()) bloom_filters.Add(key_int, keyHash(key));
+        std::string update_name = std::string("_Update_") + op_name;
+        return RPC_CALL_WRAPPER(update_name, key_int, bool, key, args...);
+    }
+}
+
+/**
+ * Register a filter under name whose scans return the matching entries.
+ * @param name, name of the filter
+ * @param filter, predicate evaluated on every scanned entry
+ */
+template<typename KeyType, typename MappedType, typename Compare>
+template<typename... Args>
+void map<KeyType, MappedType, Compare>::RegisterFilter(
+        std::string name, std::function<bool(const KeyType &, const MappedType &, Args...)> filter) {
+    std::function<MappedType(const KeyType &, const MappedType &)> projection(
+        [](const KeyType &key, const MappedType &value) { return value; });
+    RegisterFilter<MappedType, Args...>(name, filter, projection);
+}
+
+/**
+ * Register a filter under name in this process and, on servers, bind the RPCs
+ * running it, "_Filter_<name>" for whole scans and "_FilterRange_<name>" for
+ * range scans. Scans evaluate filter with their arguments on the server and
+ * return projection of the matching entries only. Both functions must not
+ * call back into this map, and Args are value types that scans have to pass
+ * exactly.
+ * @param name, name of the filter
+ * @param filter, predicate evaluated on every scanned entry
+ * @param projection, part of a matching entry to return
+ */
+template<typename KeyType, typename MappedType, typename Compare>
+template<typename ProjectedType, typename... Args>
+void map<KeyType, MappedType, Compare>::RegisterFilter(
+        std::string name, std::function<bool(const KeyType &, const MappedType &, Args...)> filter,
+        std::function<ProjectedType(const KeyType &, const MappedType &)> projection) {
+    static_assert(std::conjunction<std::is_same<Args, std::decay_t<Args>>...>::value,
+                  "filter arguments must be passed by value");
+    filters.Register(name, filter);
+    projections.Register(name, projection);
+    if (!is_server) return;
+    std::string filter_name = std::string("_Filter_") + name;
+    switch (BASKET_CONF->RPC_IMPLEMENTATION) {
+#ifdef BASKET_ENABLE_RPCLIB
+        case RPCLIB: {
+            std::function<std::vector<std::pair<KeyType, ProjectedType>>(Args...)> filterFunc(
+                [this, name](Args... args) {
+                    return LocalFilter<ProjectedType, Args...>(name, args...);
+                });
+            rpc->bind(func_prefix + filter_name, filterFunc);
+            std::function<std::vector<std::pair<KeyType, ProjectedType>>(KeyType &, KeyType &, Args...)>
+                    filterRangeFunc([this, name](KeyType &key_start, KeyType &key_end, Args... args) {
+                        return LocalFilterRange<ProjectedType, Args...>(key_start, key_end, name, args...);
+                    });
+            rpc->bind(func_prefix + "_FilterRange_" + name, filterRangeFunc);
+            break;
+        }
+#endif
+#ifdef BASKET_ENABLE_THALLIUM_TCP
+        case THALLIUM_TCP:
+#endif
+#ifdef BASKET_ENABLE_THALLIUM_ROCE
+        case THALLIUM_ROCE:
+#endif
+#if defined(BASKET_ENABLE_THALLIUM_TCP) || defined(BASKET_ENABLE_THALLIUM_ROCE)
+        {
+            std::function<void(const tl::request &, Args...)> filterFunc(
+                [this, name](const tl::request &thallium_req, Args... args) {
+                    thallium_req.respond(LocalFilter<ProjectedType, Args...>(name, args...));
+                });
+            rpc->bind(func_prefix + filter_name, filterFunc);
+            std::function<void(const tl::request &, KeyType &, KeyType &, Args...)> filterRangeFunc(
+                [this, name](const tl::request &thallium_req, KeyType &key_start,
+                             KeyType &key_end, Args... args) {
+                    thallium_req.respond(LocalFilterRange<ProjectedType, Args...>(
+                        key_start, key_end, name, args...));
+                });
+            rpc->bind(func_prefix + "_FilterRange_" + name, filterRangeFunc);
+            break;
+        }
+#endif
+    }
+}
+
+/**
+ * Scan the local partition with the filter registered as name.
+ * @param name, name of the registered filter
+ * @param args, arguments passed to the filter
+ * @return the projected matching entries, empty if name is not registered
+ * with these types
+ */
+template<typename KeyType, typename MappedType, typename Compare>
+template<typename ProjectedType, typename... Args>
+std::vector<std::pair<KeyType, ProjectedType>>
+map<KeyType, MappedType, Compare>::LocalFilter(std::string name, Args... args) {
+    AutoTrace trace = AutoTrace("basket::map::Filter(local)", name);
+    typedef std::function<bool(const KeyType &, const MappedType &, Args...)> FilterFunction;
+    typedef std::function<ProjectedType(const KeyType &, const MappedType &)> ProjectFunction;
+    std::vector<std::pair<KeyType, ProjectedType>> final_values;
+    std::shared_ptr<FilterFunction> filter = filters.Find<FilterFunction>(name);
+    std::shared_ptr<ProjectFunction> projection = projections.Find<ProjectFunction>(name);
+    if (filter == nullptr || projection == nullptr) return final_values;
+    boost::interprocess::sharable_lock<boost::interprocess::interprocess_sharable_mutex>
+            lock(*mutex);
+    for (auto iterator = mymap->begin(); iterator != mymap->end(); ++iterator) {
+        if ((*filter)(iterator->first, iterator->second, args...)) {
+            final_values.emplace_back(iterator->first,
+                                      (*projection)(iterator->first, iterator->second));
+        }
+    }
+    return final_values;
+}
+
+/**
+ * Scan the keys of the local partition within [key_start, key_end] with the
+ * filter registered as name.
+ * @param key_start, first key of the range
+ * @param key_end, last key of the range
+ * @param name, name of the registered filter
+ * @param args, arguments passed to the filter
+ * @return the projected matching entries in key order, empty if name is not
+ * registered with these types
+ */
+template<typename KeyType, typename MappedType, typename Compare>
+template<typename ProjectedType, typename... Args>
+std::vector<std::pair<KeyType, ProjectedType>>
+map<KeyType, MappedType, Compare>::LocalFilterRange(KeyType &key_start, KeyType &key_end,
+                                                   std::string name, Args... args) {
+    AutoTrace trace = AutoTrace("basket::map::FilterRange(local)", key_start, key_end, name);
+    typedef std::function<bool(const KeyType &, const MappedType &, Args...)> FilterFunction;
+    typedef std::function<ProjectedType(const KeyType &, const MappedType &)> ProjectFunction;
+    std::vector<std::pair<KeyType, ProjectedType>> final_values;
+    std::shared_ptr<FilterFunction> filter = filters.Find<FilterFunction>(name);
+    std::shared_ptr<ProjectFunction> projection = projections.Find<ProjectFunction>(name);
+    if (filter == nullptr || projection == nullptr) return final_values;
+    boost::interprocess::sharable_lock<boost::interprocess::interprocess_sharable_mutex>
+            lock(*mutex);
+    Compare compare = mymap->key_comp();
+    for (auto iterator = mymap->lower_bound(key_start);
+         iterator != mymap->end() && !compare(key_end, iterator->first); ++iterator) {
+        if ((*filter)(iterator->first, iterator->second, args...)) {
+            final_values.emplace_back(iterator->first,
+                                      (*projection)(iterator->first, iterator->second));
+        }
+    }
+    return final_values;
+}
+
+/**
+ * Scan every server with the filter registered as name. Only the projected
+ * matching entries are sent back.
+ * @param name, name of the registered filter
+ * @param args, arguments passed to the filter
+ * @return the projected matching entries of all servers
+ */
+template<typename KeyType, typename MappedType, typename Compare>
+template<typename ProjectedType, typename... Args>
+std::vector<std::pair<KeyType, ProjectedType>>
+map<KeyType, MappedType, Compare>::Filter(std::string name, Args... args) {
+    AutoTrace trace = AutoTrace("basket::map::Filter", name);
+    std::vector<std::pair<KeyType, ProjectedType>> final_values;
+    std::string filter_name = std::string("_Filter_") + name;
+    for (uint16_t server = 0; server < num_servers; ++server) {
+        std::vector<std::pair<KeyType, ProjectedType>> server_values;
+        if (server == my_server && server_on_node) {
+            server_values = LocalFilter<ProjectedType, Args...>(name, args...);
+        } else {
+            typedef std::vector<std::pair<KeyType, ProjectedType>> ret_type;
+            server_values = RPC_CALL_WRAPPER(filter_name, server, ret_type, args...);
+        }
+        final_values.insert(final_values.end(), server_values.begin(),
+                            server_values.end());
+    }
+    return final_values;
+}
+
+/**
+ * Scan the keys within [key_start, key_end] on every server with the filter
+ * registered as name. Only the projected matching entries are sent back.
+ * @param key_start, first key of the range
+ * @param key_end, last key of the range
+ * @param name, name of the registered filter
+ * @param args, arguments passed to the filter
+ * @return the projected matching entries, in key order per server
+ */
+template<typename KeyType, typename MappedType, typename Compare>
+template<typename ProjectedType, typename... Args>
+std::vector<std::pair<KeyType, ProjectedType>>
+map<KeyType, MappedType, Compare>::FilterRange(KeyType &key_start, KeyType &key_end,
+                                              std::string name, Args... args) {
+    AutoTrace trace = AutoTrace("basket::map::FilterRange", key_start, key_end, name);
+    std::vector<std::pair<KeyType, ProjectedType>> final_values;
+    std::string filter_name = std::string("_FilterRange_") + name;
+    for (uint16_t server = 0; server < num_servers; ++server) {
+        std::vector<std::pair<KeyType, ProjectedType>> server_values;
+        if (server == my_server && server_on_node) {
+            server_values = LocalFilterRange<ProjectedType, Args...>(key_start, key_end,
+                                                                     name, args...);
+        } else {
+            typedef std::vector<std::pair<KeyType, ProjectedType>> ret_type;
+            server_values = RPC_CALL_WRAPPER(filter_name, server, ret_type,
+                                             key_start, key_end, args...);
+        }
+        final_values.insert(final_values.end(), server_values.begin(),
+                            server_values.end());
+    }
+    return final_values;
+}
 #endif  // INCLUDE_BASKET_MAP_MAP_CPP_
@@ -29,6 +29,11 @@
 #include <basket/communication/rpc_factory.h>
 #include <basket/common/singleton.h>
 #include <basket/common/debug.h>
+#include <basket/common/client_cache.h>
+#include <basket/common/hot_key_sketch.h>
+#include <basket/common/function_registry.h>
+#include <basket/common/bloom_filter.h>
+#include <basket/common/kway_merge.h>
 /** MPI Headers**/
 #include <mpi.h>
 /** RPC Lib Headers**/
@@ -46,8 +51,9 @@
 #include <boost/interprocess/managed_mapped_file.hpp>
 #include <boost/interprocess/containers/map.hpp>
 #include <boost/interprocess/allocators/allocator.hpp>
-#include <boost/interprocess/sync/interprocess_mutex.hpp>
+#include <boost/interprocess/sync/interprocess_sharable_mutex.hpp>
 #include <boost/interprocess/sync/scoped_lock.hpp>
+#include <boost/interprocess/sync/sharable_lock.hpp>
 #include <boost/algorithm/string.hpp>
 /** Standard C++ Headers**/
 #include <iostream>
@@ -70,7 +76,7 @@ template<typename KeyType, typename MappedType, typename Compare =
          std::less<KeyType>>
 class map {
   private:
-    std::hash<KeyType> keyHash;
+    basket::hash<KeyType> keyHash;
     /** Class Typedefs for ease of use **/
     typedef std::pair<const KeyType, MappedType> ValueType;
     typedef boost::interprocess::allocator<
@@ -87,39 +93,110 @@ class map {
     boost::interprocess::managed_mapped_file segment;
     std::string name, func_prefix;
     MyMap *mymap;
-    boost::interprocess::interprocess_mutex* mutex;
+    boost::interprocess::interprocess_sharable_mutex* mutex;
     bool server_on_node;
     CharStruct backed_file;
+    LeaseTable<KeyType> *leases;
+    ClientCache<KeyType, MappedType> cache;
+    HotKeySketch<KeyType> *hot_keys;
+    FunctionRegistry updates, filters, projections;
+    CountingBloomFilter *bloom;
+    BloomFilterCache bloom_filters;
+
+    bool MayContain(uint16_t server, size_t key_hash);
+    std::vector<std::pair<KeyType, MappedType>> SeekPage(
+        uint16_t key_int, const Optional<std::pair<KeyType, MappedType>> &after, uint32_t n);
 
   public:
+    /* orders entries by key, for merging the partitions */
+    struct KeyLess {
+        Compare compare;
+        bool operator()(const std::pair<KeyType, MappedType> &a,
+                        const std::pair<KeyType, MappedType> &b) const {
+            return compare(a.first, b.first);
+        }
+    };
+    typedef KWayMerge<std::pair<KeyType, MappedType>, KeyLess> OrderedScan;
+
     ~map();
 
     explicit map(std::string name_ = "TEST_MAP");
 
     bool LocalPut(KeyType &key, MappedType &data);
-    std::pair<bool, MappedType> LocalGet(KeyType &key);
-    std::pair<bool, MappedType> LocalErase(KeyType &key);
+    bool LocalPutIfAbsent(KeyType &key, MappedType &data);
+    bool LocalCompareAndSwap(KeyType &key, MappedType &expected, MappedType &desired);
+    Optional<MappedType> LocalGet(KeyType &key);
+    bool LocalErase(KeyType &key);
+    std::pair<Optional<MappedType>, HTime> LocalGetWithLease(KeyType &key);
     std::vector<std::pair<KeyType, MappedType>> LocalGetAllDataInServer();
+    template<typename Visitor>
+    bool LocalVisit(KeyType &key, Visitor visitor);
+    template<typename... Args>
+    bool LocalUpdate(KeyType &key, std::string op_name, Args... args);
+    template<typename ProjectedType, typename... Args>
+    std::vector<std::pair<KeyType, ProjectedType>> LocalFilter(std::string name, Args... args);
+    template<typename ProjectedType, typename... Args>
+    std::vector<std::pair<KeyType, ProjectedType>> LocalFilterRange(KeyType &key_start, KeyType &key_end,
+                                                                    std::string name, Args... args);
+    std::vector<std::pair<KeyType, std::pair<uint64_t, uint64_t>>> LocalHotKeys(uint32_t k);
+    std::vector<uint64_t> LocalBloomFilter();
     std::vector<std::pair<KeyType, MappedType>> LocalContainsInServer(KeyType &key_start,KeyType &key_end);
+    std::vector<std::pair<KeyType, MappedType>> LocalSeekFirstN(uint32_t n);
+    std::vector<std::pair<KeyType, MappedType>> LocalSeekNextN(KeyType &key, uint32_t n);
 
 #if defined(BASKET_ENABLE_THALLIUM_TCP) || defined(BASKET_ENABLE_THALLIUM_ROCE)
     THALLIUM_DEFINE(LocalPut, (key,data), KeyType &key, MappedType &data)
+    THALLIUM_DEFINE(LocalPutIfAbsent, (key,data), KeyType &key, MappedType &data)
+    THALLIUM_DEFINE(LocalCompareAndSwap, (key,expected,desired), KeyType &key,
+                    MappedType &expected, MappedType &desired)
     THALLIUM_DEFINE(LocalGet, (key), KeyType &key)
     THALLIUM_DEFINE(LocalErase, (key), KeyType &key)
+    THALLIUM_DEFINE(LocalGetWithLease, (key), KeyType &key)
     THALLIUM_DEFINE(LocalContainsInServer, (key_start, key_end), KeyType &key_start, KeyType &key_end)
     THALLIUM_DEFINE1(LocalGetAllDataInServer)
+    THALLIUM_DEFINE(LocalHotKeys, (k), uint32_t k)
+    THALLIUM_DEFINE1(LocalBloomFilter)
+    THALLIUM_DEFINE(LocalSeekFirstN, (n), uint32_t n)
+    THALLIUM_DEFINE(LocalSeekNextN, (key, n), KeyType &key, uint32_t n)
 #endif
     
     bool Put(KeyType &key, MappedType &data);
-    std::pair<bool, MappedType> Get(KeyType &key);
+    bool PutIfAbsent(KeyType &key, MappedType &data);
+    bool CompareAndSwap(KeyType &key, MappedType &expected, MappedType &desired);
+    Optional<MappedType> Get(KeyType &key);
 
-    std::pair<bool, MappedType> Erase(KeyType &key);
+    bool Erase(KeyType &key);
     std::vector<std::pair<KeyType, MappedType>> Contains(KeyType &key_start,KeyType &key_end);
 
     std::vector<std::pair<KeyType, MappedType>> GetAllData();
 
     std::vector<std::pair<KeyType, MappedType>> ContainsInServer(KeyType &key_start,KeyType &key_end);
     std::vector<std::pair<KeyType, MappedType>> GetAllDataInServer();
+    std::vector<std::pair<KeyType, MappedType>> SeekFirstN(uint32_t n, uint16_t &key_int);
+    std::vector<std::pair<KeyType, MappedType>> SeekNextN(KeyType &key, uint32_t n,
+                                                          uint16_t &key_int);
+    std::vector<std::pair<KeyType, MappedType>> GlobalSeekFirstN(uint32_t n);
+    OrderedScan Scan();
+    template<typename Visitor>
+    bool Visit(KeyType &key, Visitor visitor);
+    template<typename... Args>
+    void RegisterUpdate(std::string op_name,
+                        std::function<bool(MappedType &, bool, Args...)> op);
+    template<typename... Args>
+    bool Update(KeyType &key, std::string op_name, Args... args);
+    template<typename... Args>
+    void RegisterFilter(std::string name,
+                        std::function<bool(const KeyType &, const MappedType &, Args...)> filter);
+    template<typename ProjectedType, typename... Args>
+    void RegisterFilter(std::string name,
+                        std::function<bool(const KeyType &, const MappedType &, Args...)> filter,
+                        std::function<ProjectedType(const KeyType &, const MappedType &)> projection);
+    template<typename ProjectedType = MappedType, typename... Args>
+    std::vector<std::pair<KeyType, ProjectedType>> Filter(std::string name, Args... args);
+    template<typename ProjectedType = MappedType, typename... Args>
+    std::vector<std::pair<KeyType, ProjectedType>> FilterRange(KeyType &key_start, KeyType &key_end,
+                                                               std::string name, Args... args);
+    std::vector<std::pair<KeyType, std::pair<uint64_t, uint64_t>>> HotKeys(uint16_t server, uint32_t k);
 };
 
 #include "map.cpp"
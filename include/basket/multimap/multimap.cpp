@@ -36,7 +36,7 @@ multimap<KeyType, MappedType,
                    comm_size(1), my_rank(0), memory_allocated(BASKET_CONF->MEMORY_ALLOCATED),
                    name(name_), segment(), mymap(), func_prefix(name_),
                    backed_file(BASKET_CONF->BACKED_FILE_DIR + PATH_SEPARATOR + name_+"_"+std::to_string(my_server)),
-                   server_on_node(BASKET_CONF->SERVER_ON_NODE) {
+                   server_on_node(BASKET_CONF->SERVER_ON_NODE), hot_keys(nullptr) {
     AutoTrace trace = AutoTrace("basket::multimap");
     /* Initialize MPI rank and size of world */
     MPI_Comm_size(MPI_COMM_WORLD, &comm_size);
@@ -55,8 +55,13 @@ multimap<KeyType, MappedType,
         ShmemAllocator alloc_inst(segment.get_segment_manager());
         /* Construct Multimap in the shared memory space. */
         mymap = segment.construct<MyMap>(name.c_str())(Compare(), alloc_inst);
-        mutex = segment.construct<boost::interprocess::interprocess_mutex>(
+        mutex = segment.construct<boost::interprocess::interprocess_sharable_mutex>(
             "mtx")();
+        /* Construct the hot key sketch if access tracking is enabled. */
+        if (BASKET_CONF->HOT_KEY_CAPACITY > 0) {
+            hot_keys = segment.construct<HotKeySketch<KeyType>>("hot_keys")(
+                BASKET_CONF->HOT_KEY_CAPACITY, segment.get_segment_manager());
+        }
         /* Create a RPC server and map the methods to it. */
                 switch (BASKET_CONF->RPC_IMPLEMENTATION) {
 #ifdef BASKET_ENABLE_RPCLIB
@@ -64,10 +69,10 @@ multimap<KeyType, MappedType,
                 std::function<bool(KeyType &, MappedType &)> putFunc(
                     std::bind(&multimap<KeyType, MappedType, Compare>::LocalPut, this,
                               std::placeholders::_1, std::placeholders::_2));
-                std::function<std::pair<bool, MappedType>(KeyType &)> getFunc(
+                std::function<Optional<MappedType>(KeyType &)> getFunc(
                     std::bind(&multimap<KeyType, MappedType, Compare>::LocalGet, this,
                               std::placeholders::_1));
-                std::function<std::pair<bool, MappedType>(KeyType &)> eraseFunc(
+                std::function<bool(KeyType &)> eraseFunc(
                     std::bind(&multimap<KeyType, MappedType, Compare>::LocalErase, this,
                               std::placeholders::_1));
                 std::function<std::vector<std::pair<KeyType, MappedType>>(void)>
@@ -79,11 +84,23 @@ multimap<KeyType, MappedType,
                                                        Compare>::LocalContainsInServer, this,
                                                        std::placeholders::_1));
 
+                std::function<std::vector<std::pair<KeyType, std::pair<uint64_t, uint64_t>>>(uint32_t)> hotKeysFunc(
+                    std::bind(&multimap<KeyType, MappedType, Compare>::LocalHotKeys, this,
+                              std::placeholders::_1));
+                std::function<bool(KeyType &, std::vector<MappedType> &)> appendFunc(
+                    std::bind(&multimap<KeyType, MappedType, Compare>::LocalAppend, this,
+                              std::placeholders::_1, std::placeholders::_2));
+                std::function<std::vector<MappedType>(KeyType &)> getValuesFunc(
+                    std::bind(&multimap<KeyType, MappedType, Compare>::LocalGetValues, this,
+                              std::placeholders::_1));
                 rpc->bind(func_prefix+"_Put", putFunc);
                 rpc->bind(func_prefix+"_Get", getFunc);
                 rpc->bind(func_prefix+"_Erase", eraseFunc);
                 rpc->bind(func_prefix+"_GetAllData", getAllDataInServerFunc);
+                rpc->bind(func_prefix+"_HotKeys", hotKeysFunc);
                 rpc->bind(func_prefix+"_Contains", containsInServerFunc);
+                rpc->bind(func_prefix+"_Append", appendFunc);
+                rpc->bind(func_prefix+"_GetValues", getValuesFunc);
                 break;
             }
 #endif
@@ -116,11 +133,25 @@ multimap<KeyType, MappedType,
                                                            std::placeholders::_1,
 							   std::placeholders::_2));
 
+                    std::function<void(const tl::request &, uint32_t)> hotKeysFunc(
+                        std::bind(&multimap<KeyType, MappedType, Compare>::ThalliumLocalHotKeys, this,
+                                  std::placeholders::_1, std::placeholders::_2));
+                    std::function<void(const tl::request &, KeyType &, std::vector<MappedType> &)>
+                            appendFunc(std::bind(
+                                &multimap<KeyType, MappedType, Compare>::ThalliumLocalAppend, this,
+                                std::placeholders::_1, std::placeholders::_2,
+                                std::placeholders::_3));
+                    std::function<void(const tl::request &, KeyType &)> getValuesFunc(
+                        std::bind(&multimap<KeyType, MappedType, Compare>::ThalliumLocalGetValues, this,
+                                  std::placeholders::_1, std::placeholders::_2));
                     rpc->bind(func_prefix+"_Put", putFunc);
                     rpc->bind(func_prefix+"_Get", getFunc);
                     rpc->bind(func_prefix+"_Erase", eraseFunc);
                     rpc->bind(func_prefix+"_GetAllData", getAllDataInServerFunc);
+                    rpc->bind(func_prefix+"_HotKeys", hotKeysFunc);
                     rpc->bind(func_prefix+"_Contains", containsInServerFunc);
+                    rpc->bind(func_prefix+"_Append", appendFunc);
+                    rpc->bind(func_prefix+"_GetValues", getValuesFunc);
                     break;
                 }
 #endif
@@ -133,10 +164,11 @@ multimap<KeyType, MappedType,
                 res;
         res = segment.find<MyMap>(name.c_str());
         mymap = res.first;
-        std::pair<boost::interprocess::interprocess_mutex *,
+        std::pair<boost::interprocess::interprocess_sharable_mutex *,
                   boost::interprocess::managed_mapped_file::size_type> res2;
-        res2 = segment.find<boost::interprocess::interprocess_mutex>("mtx");
+        res2 = segment.find<boost::interprocess::interprocess_sharable_mutex>("mtx");
         mutex = res2.first;
+        hot_keys = segment.find<HotKeySketch<KeyType>>("hot_keys").first;
     }
 }
 
@@ -150,13 +182,17 @@ template<typename KeyType, typename MappedType, typename Compare>
 bool multimap<KeyType, MappedType, Compare>::LocalPut(KeyType &key,
                                                       MappedType &data) {
     AutoTrace trace = AutoTrace("basket::multimap::Put(local)", key, data);
-    boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex>
+    if (hot_keys != nullptr) hot_keys->Record(key, PayloadSize(key) + PayloadSize(data));
+    boost::interprocess::scoped_lock<boost::interprocess::interprocess_sharable_mutex>
             lock(*mutex);
     typename MyMap::iterator iterator = mymap->find(key);
-    if (iterator != mymap->end()) {
-        mymap->erase(iterator);
+    if (iterator == mymap->end()) {
+        mymap->emplace(key, Values(data, ValueAllocator(
+            mymap->get_allocator().get_segment_manager())));
+    } else {
+        /* replace the oldest value, as the node per value layout did */
+        iterator->second.replace_oldest(data);
     }
-    mymap->insert(std::pair<KeyType, MappedType>(key, data));
     return true;
 }
 
@@ -185,20 +221,24 @@ bool multimap<KeyType, MappedType, Compare>::Put(KeyType &key,
 /**
  * Get the data in the local multimap.
  * @param key, key to get
- * @return return a pair of bool and Value. If bool is true then data was
- * found and is present in value part else bool is set to false
+ * @return an Optional holding the value if the key was found, empty
+ * otherwise
  */
 template<typename KeyType, typename MappedType, typename Compare>
-std::pair<bool, MappedType>
+Optional<MappedType>
 multimap<KeyType, MappedType, Compare>::LocalGet(KeyType &key) {
     AutoTrace trace = AutoTrace("basket::multimap::Get(local)", key);
-    boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex>
+    boost::interprocess::sharable_lock<boost::interprocess::interprocess_sharable_mutex>
             lock(*mutex);
     typename MyMap::iterator iterator = mymap->find(key);
+    if (hot_keys != nullptr) {
+        hot_keys->Record(key, PayloadSize(key) + (iterator != mymap->end()
+                                                  ? PayloadSize(iterator->second.front()) : 0));
+    }
     if (iterator != mymap->end()) {
-        return std::pair<bool, MappedType>(true, iterator->second);
+        return Optional<MappedType>(iterator->second.front());
     } else {
-        return std::pair<bool, MappedType>(false, MappedType());
+        return Optional<MappedType>();
     }
 }
 
@@ -206,11 +246,11 @@ multimap<KeyType, MappedType, Compare>::LocalGet(KeyType &key) {
  * Get the data into the multimap. Uses key to decide the server to hash it
  * to,
  * @param key, key to get
- * @return return a pair of bool and Value. If bool is true then data was
- * found and is present in value part else bool is set to false
+ * @return an Optional holding the value if the key was found, empty
+ * otherwise
  */
 template<typename KeyType, typename MappedType, typename Compare>
-std::pair<bool, MappedType>
+Optional<MappedType>
 multimap<KeyType, MappedType, Compare>::Get(KeyType &key) {
     size_t key_hash = keyHash(key);
     uint16_t key_int = key_hash % num_servers;
@@ -218,24 +258,25 @@ multimap<KeyType, MappedType, Compare>::Get(KeyType &key) {
         return LocalGet(key);
     } else {
         AutoTrace trace = AutoTrace("basket::multimap::Get(remote)", key);
-        typedef std::pair<bool, MappedType> ret_type;
+        typedef Optional<MappedType> ret_type;
         return RPC_CALL_WRAPPER("_Get", key_int, ret_type,
                                 key);
     }
 }
 
 template<typename KeyType, typename MappedType, typename Compare>
-std::pair<bool, MappedType>
+bool
 multimap<KeyType, MappedType, Compare>::LocalErase(KeyType &key) {
     AutoTrace trace = AutoTrace("basket::multimap::Erase(local)", key);
-    boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex>
+    if (hot_keys != nullptr) hot_keys->Record(key, PayloadSize(key));
+    boost::interprocess::scoped_lock<boost::interprocess::interprocess_sharable_mutex>
             lock(*mutex);
     size_t s = mymap->erase(key);
-    return std::pair<bool, MappedType>(s > 0, MappedType());
+    return s > 0;
 }
 
 template<typename KeyType, typename MappedType, typename Compare>
-std::pair<bool, MappedType>
+bool
 multimap<KeyType, MappedType, Compare>::Erase(KeyType &key) {
     size_t key_hash = keyHash(key);
     uint16_t key_int = key_hash % num_servers;
@@ -243,7 +284,7 @@ multimap<KeyType, MappedType, Compare>::Erase(KeyType &key) {
         return LocalErase(key);
     } else {
         AutoTrace trace = AutoTrace("basket::multimap::Erase(remote)", key);
-        typedef std::pair<bool, MappedType> ret_type;
+        typedef bool ret_type;
         return RPC_CALL_WRAPPER("_Erase", key_int, ret_type, key);
     }
 }
@@ -302,15 +343,16 @@ multimap<KeyType, MappedType,
     std::vector<std::pair<KeyType, MappedType>> final_values =
             std::vector<std::pair<KeyType, MappedType>>();
     {
-        boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex>
+        boost::interprocess::sharable_lock<boost::interprocess::interprocess_sharable_mutex>
                 lock(*mutex);
         typename MyMap::iterator lower_bound;
         size_t size = mymap->size();
         if (size == 0) {
         } else if (size == 1) {
             lower_bound = mymap->begin();
-            final_values.insert(final_values.end(), std::pair<KeyType, MappedType>(
-                lower_bound->first, lower_bound->second));
+            for (const auto &value : lower_bound->second) {
+                final_values.emplace_back(lower_bound->first, value);
+            }
         } else {
             lower_bound = mymap->lower_bound(key);
             if (lower_bound == mymap->end()) return final_values;
@@ -321,9 +363,9 @@ multimap<KeyType, MappedType,
             while (lower_bound != mymap->end()) {
                 if (!(key.Contains(lower_bound->first) ||
                       lower_bound->first.Contains(key))) break;
-                final_values.insert(final_values.end(), std::pair<KeyType,
-                                    MappedType>(lower_bound->first,
-                                                lower_bound->second));
+                for (const auto &value : lower_bound->second) {
+                    final_values.emplace_back(lower_bound->first, value);
+                }
                 lower_bound++;
             }
         }
@@ -353,13 +395,14 @@ multimap<KeyType, MappedType, Compare>::LocalGetAllDataInServer() {
     std::vector<std::pair<KeyType, MappedType>> final_values =
             std::vector<std::pair<KeyType, MappedType>>();
     {
-        boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex>
+        boost::interprocess::sharable_lock<boost::interprocess::interprocess_sharable_mutex>
                 lock(*mutex);
         typename MyMap::iterator lower_bound;
         lower_bound = mymap->begin();
         while (lower_bound != mymap->end()) {
-            final_values.insert(final_values.end(), std::pair<KeyType, MappedType>(
-                lower_bound->first, lower_bound->second));
+            for (const auto &value : lower_bound->second) {
+                final_values.emplace_back(lower_bound->first, value);
+            }
             lower_bound++;
         }
     }
@@ -379,4 +422,168 @@ multimap<KeyType, MappedType, Compare>::GetAllDataInServer() {
     }
 }
 
+/**
+ * Get the hottest keys of the local partition.
+ * @param k, number of keys to return
+ * @return a vector of key and (estimated hits, estimated bytes) pairs, the
+ * hottest first. Empty if HOT_KEY_CAPACITY is 0.
+ */
+template<typename KeyType, typename MappedType, typename Compare>
+std::vector<std::pair<KeyType, std::pair<uint64_t, uint64_t>>>
+multimap<KeyType, MappedType, Compare>::LocalHotKeys(uint32_t k) {
+    AutoTrace trace = AutoTrace("basket::multimap::HotKeys(local)", k);
+    if (hot_keys == nullptr) return std::vector<std::pair<KeyType, std::pair<uint64_t, uint64_t>>>();
+    return hot_keys->Top(k);
+}
+
+/**
+ * Get the hottest keys of a server partition.
+ * @param server, the server to query
+ * @param k, number of keys to return
+ * @return a vector of key and (estimated hits, estimated bytes) pairs, the
+ * hottest first.
+ */
+template<typename KeyType, typename MappedType, typename Compare>
+std::vector<std::pair<KeyType, std::pair<uint64_t, uint64_t>>>
+multimap<KeyType, MappedType, Compare>::HotKeys(uint16_t server, uint32_t k) {
+    if (server == my_server && server_on_node) {
+        return LocalHotKeys(k);
+    } else {
+        AutoTrace trace = AutoTrace("basket::multimap::HotKeys(remote)", server, k);
+        typedef std::vector<std::pair<KeyType, std::pair<uint64_t, uint64_t>>> ret_type;
+        return RPC_CALL_WRAPPER("_HotKeys", server, ret_type, k);
+    }
+}
+
+/**
+ * Run visitor on the value of key in place in the local multimap, without
+ * copying it out of shared memory. The partition is read locked while
+ * visitor runs, so visitor must not call back into this multimap nor keep
+ * references to the value.
+ * @param key, key to visit
+ * @param visitor, callable taking a const MappedType &
+ * @return bool, true if key was found and visited
+ */
+template<typename KeyType, typename MappedType, typename Compare>
+template<typename Visitor>
+bool multimap<KeyType, MappedType, Compare>::LocalVisit(KeyType &key, Visitor visitor) {
+    AutoTrace trace = AutoTrace("basket::multimap::Visit(local)", key);
+    boost::interprocess::sharable_lock<boost::interprocess::interprocess_sharable_mutex>
+            lock(*mutex);
+    typename MyMap::iterator iterator = mymap->find(key);
+    if (hot_keys != nullptr) {
+        hot_keys->Record(key, PayloadSize(key) + (iterator != mymap->end()
+                                                  ? PayloadSize(iterator->second.front()) : 0));
+    }
+    if (iterator == mymap->end()) return false;
+    visitor(static_cast<const MappedType &>(iterator->second.front()));
+    return true;
+}
+
+/**
+ * Run visitor on the value of key. Uses key to decide the server to hash it
+ * to, on-node values are visited in place and remote values are fetched
+ * with Get and visited on the copy.
+ * @param key, key to visit
+ * @param visitor, callable taking a const MappedType &
+ * @return bool, true if key was found and visited
+ */
+template<typename KeyType, typename MappedType, typename Compare>
+template<typename Visitor>
+bool multimap<KeyType, MappedType, Compare>::Visit(KeyType &key, Visitor visitor) {
+    uint16_t key_int = static_cast<uint16_t>(keyHash(key) % num_servers);
+    if (key_int == my_server && server_on_node) {
+        return LocalVisit(key, visitor);
+    } else {
+        AutoTrace trace = AutoTrace("basket::multimap::Visit(remote)", key);
+        Optional<MappedType> result = Get(key);
+        if (!result) return false;
+        visitor(static_cast<const MappedType &>(*result));
+        return true;
+    }
+}
+
+/**
+ * Append values to the values of key in the local multimap, keeping the
+ * ones it has. The values after the oldest are stored next to each other,
+ * so the whole block is copied in at once.
+ * @param key, the key to append to
+ * @param values, the values to append, in order
+ * @return bool, true if the values were appended
+ */
+template<typename KeyType, typename MappedType, typename Compare>
+bool multimap<KeyType, MappedType, Compare>::LocalAppend(KeyType &key,
+                                                         std::vector<MappedType> &values) {
+    AutoTrace trace = AutoTrace("basket::multimap::Append(local)", key, values.size());
+    if (values.empty()) return true;
+    if (hot_keys != nullptr) hot_keys->Record(key, PayloadSize(key) + PayloadSize(values));
+    boost::interprocess::scoped_lock<boost::interprocess::interprocess_sharable_mutex>
+            lock(*mutex);
+    typename MyMap::iterator iterator = mymap->find(key);
+    if (iterator == mymap->end()) {
+        iterator = mymap->emplace(key, Values(values.front(), ValueAllocator(
+            mymap->get_allocator().get_segment_manager()))).first;
+        iterator->second.append(values.begin() + 1, values.end());
+    } else {
+        iterator->second.append(values.begin(), values.end());
+    }
+    return true;
+}
+
+/**
+ * Append values to the values of key. Uses key to decide the server to hash
+ * it to, all values travel in one request.
+ * @param key, the key to append to
+ * @param values, the values to append, in order
+ * @return bool, true if the values were appended
+ */
+template<typename KeyType, typename MappedType, typename Compare>
+bool multimap<KeyType, MappedType, Compare>::Append(KeyType &key,
+                                                    std::vector<MappedType> &values) {
+    uint16_t key_int = static_cast<uint16_t>(keyHash(key) % num_servers);
+    if (key_int == my_server && server_on_node) {
+        return LocalAppend(key, values);
+    } else {
+        AutoTrace trace = AutoTrace("basket::multimap::Append(remote)", key, values.size());
+        return RPC_CALL_WRAPPER("_Append", key_int, bool, key, values);
+    }
+}
+
+/**
+ * Get all values of key in the local multimap, oldest first.
+ * @param key, key to get
+ * @return a vector of the values, empty if the key was not found
+ */
+template<typename KeyType, typename MappedType, typename Compare>
+std::vector<MappedType> multimap<KeyType, MappedType, Compare>::LocalGetValues(KeyType &key) {
+    AutoTrace trace = AutoTrace("basket::multimap::GetValues(local)", key);
+    boost::interprocess::sharable_lock<boost::interprocess::interprocess_sharable_mutex>
+            lock(*mutex);
+    typename MyMap::iterator iterator = mymap->find(key);
+    if (iterator == mymap->end()) {
+        if (hot_keys != nullptr) hot_keys->Record(key, PayloadSize(key));
+        return std::vector<MappedType>();
+    }
+    std::vector<MappedType> values(iterator->second.begin(), iterator->second.end());
+    if (hot_keys != nullptr) hot_keys->Record(key, PayloadSize(key) + PayloadSize(values));
+    return values;
+}
+
+/**
+ * Get all values of key, oldest first. Uses key to decide the server to
+ * hash it to.
+ * @param key, key to get
+ * @return a vector of the values, empty if the key was not found
+ */
+template<typename KeyType, typename MappedType, typename Compare>
+std::vector<MappedType> multimap<KeyType, MappedType, Compare>::GetValues(KeyType &key) {
+    uint16_t key_int = static_cast<uint16_t>(keyHash(key) % num_servers);
+    if (key_int == my_server && server_on_node) {
+        return LocalGetValues(key);
+    } else {
+        AutoTrace trace = AutoTrace("basket::multimap::GetValues(remote)", key);
+        typedef std::vector<MappedType> ret_type;
+        return RPC_CALL_WRAPPER("_GetValues", key_int, ret_type, key);
+    }
+}
 #endif  // INCLUDE_BASKET_MULTIMAP_MULTIMAP_CPP_
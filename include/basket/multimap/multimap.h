@@ -28,6 +28,8 @@
 #include <basket/communication/rpc_factory.h>
 #include <basket/common/singleton.h>
 #include <basket/common/debug.h>
+#include <basket/common/hot_key_sketch.h>
+#include <basket/common/value_list.h>
 /** MPI Headers**/
 #include <mpi.h>
 /** RPC Lib Headers**/
@@ -44,9 +46,11 @@
 /** Boost Headers **/
 #include <boost/interprocess/managed_mapped_file.hpp>
 #include <boost/interprocess/containers/map.hpp>
+#include <boost/interprocess/containers/vector.hpp>
 #include <boost/interprocess/allocators/allocator.hpp>
-#include <boost/interprocess/sync/interprocess_mutex.hpp>
+#include <boost/interprocess/sync/interprocess_sharable_mutex.hpp>
 #include <boost/interprocess/sync/scoped_lock.hpp>
+#include <boost/interprocess/sync/sharable_lock.hpp>
 #include <boost/algorithm/string.hpp>
 /** Standard C++ Headers**/
 #include <iostream>
@@ -67,14 +71,18 @@ template<typename KeyType, typename MappedType, typename Compare =
          std::less<KeyType>>
 class multimap {
   private:
-    std::hash<KeyType> keyHash;
+    basket::hash<KeyType> keyHash;
     /** Class Typedefs for ease of use **/
-    typedef std::pair<const KeyType, MappedType> ValueType;
+    typedef boost::interprocess::allocator<
+        MappedType, boost::interprocess::managed_mapped_file::segment_manager>
+    ValueAllocator;
+    /* all values of a key, stored once per key, the oldest inline */
+    typedef ValueList<MappedType, ValueAllocator> Values;
+    typedef std::pair<const KeyType, Values> ValueType;
     typedef boost::interprocess::allocator<
         ValueType, boost::interprocess::managed_mapped_file::segment_manager>
     ShmemAllocator;
-    typedef boost::interprocess::multimap<KeyType, MappedType, Compare,
-                                          ShmemAllocator> MyMap;
+    typedef boost::interprocess::map<KeyType, Values, Compare, ShmemAllocator> MyMap;
     /** Class attributes**/
     int comm_size, my_rank, num_servers;
     uint16_t  my_server;
@@ -84,9 +92,10 @@ class multimap {
     boost::interprocess::managed_mapped_file segment;
     std::string name, func_prefix;
     MyMap *mymap;
-    boost::interprocess::interprocess_mutex* mutex;
+    boost::interprocess::interprocess_sharable_mutex* mutex;
     bool server_on_node;
     CharStruct backed_file;
+    HotKeySketch<KeyType> *hot_keys;
 
   public:
     /* Constructor to deallocate the shared memory*/
@@ -95,10 +104,15 @@ class multimap {
     explicit multimap(std::string name_ = "TEST_MULTIMAP");
 
     bool LocalPut(KeyType &key, MappedType &data);
-    std::pair<bool, MappedType> LocalGet(KeyType &key);
-    std::pair<bool, MappedType> LocalErase(KeyType &key);
+    Optional<MappedType> LocalGet(KeyType &key);
+    bool LocalErase(KeyType &key);
     std::vector<std::pair<KeyType, MappedType>> LocalContainsInServer(KeyType &key);
     std::vector<std::pair<KeyType, MappedType>> LocalGetAllDataInServer();
+    template<typename Visitor>
+    bool LocalVisit(KeyType &key, Visitor visitor);
+    std::vector<std::pair<KeyType, std::pair<uint64_t, uint64_t>>> LocalHotKeys(uint32_t k);
+    bool LocalAppend(KeyType &key, std::vector<MappedType> &values);
+    std::vector<MappedType> LocalGetValues(KeyType &key);
 
 #if defined(BASKET_ENABLE_THALLIUM_TCP) || defined(BASKET_ENABLE_THALLIUM_ROCE)
     THALLIUM_DEFINE(LocalPut, (key, data), KeyType &key, MappedType &data)
@@ -106,19 +120,27 @@ class multimap {
     THALLIUM_DEFINE(LocalErase, (key), KeyType &key)
     THALLIUM_DEFINE(LocalContainsInServer, (key), KeyType &key)
     THALLIUM_DEFINE1(LocalGetAllDataInServer)
+    THALLIUM_DEFINE(LocalHotKeys, (k), uint32_t k)
+    THALLIUM_DEFINE(LocalAppend, (key, values), KeyType &key, std::vector<MappedType> &values)
+    THALLIUM_DEFINE(LocalGetValues, (key), KeyType &key)
 
 #endif
 
     bool Put(KeyType &key, MappedType &data);
-    std::pair<bool, MappedType> Get(KeyType &key);
+    Optional<MappedType> Get(KeyType &key);
 
-    std::pair<bool, MappedType> Erase(KeyType &key);
+    bool Erase(KeyType &key);
     std::vector<std::pair<KeyType, MappedType>> Contains(KeyType &key);
 
     std::vector<std::pair<KeyType, MappedType>> GetAllData();
 
     std::vector<std::pair<KeyType, MappedType>> ContainsInServer(KeyType &key);
     std::vector<std::pair<KeyType, MappedType>> GetAllDataInServer();
+    template<typename Visitor>
+    bool Visit(KeyType &key, Visitor visitor);
+    std::vector<std::pair<KeyType, std::pair<uint64_t, uint64_t>>> HotKeys(uint16_t server, uint32_t k);
+    bool Append(KeyType &key, std::vector<MappedType> &values);
+    std::vector<MappedType> GetValues(KeyType &key);
 };
 
 #include "multimap.cpp"
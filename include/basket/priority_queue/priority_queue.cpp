@@ -35,7 +35,12 @@ priority_queue<MappedType,
                          comm_size(1), my_rank(0), memory_allocated(BASKET_CONF->MEMORY_ALLOCATED),
                          name(name_), segment(), queue(), func_prefix(name_),
                          backed_file(BASKET_CONF->BACKED_FILE_DIR + PATH_SEPARATOR + name_+"_"+std::to_string(my_server)),
-                         server_on_node(BASKET_CONF->SERVER_ON_NODE) {
+                         server_on_node(BASKET_CONF->SERVER_ON_NODE),
+                         credits(BASKET_CONF->QUEUE_CAPACITY, BASKET_CONF->QUEUE_FULL_POLICY,
+                                 BASKET_CONF->LONG_POLL_TIMEOUT, BASKET_CONF->NUM_SERVERS),
+                         polls(BASKET_CONF->RPC_THREADS),
+                         compare(), tops(BASKET_CONF->NUM_SERVERS, CachedTop{Optional<MappedType>(), false, 0}),
+                         random(BASKET_CONF->MPI_RANK + 1), tops_mutex() {
     AutoTrace trace = AutoTrace("basket::priority_queue");
     /* Initialize MPI rank and size of world */
     MPI_Comm_size(MPI_COMM_WORLD, &comm_size);
@@ -51,10 +56,10 @@ priority_queue<MappedType,
         /* allocate new shared memory space */
         segment = bip::managed_mapped_file(bip::create_only, backed_file.c_str(),
                                              memory_allocated);
-        ShmemAllocator alloc_inst(segment.get_segment_manager());
         /* Construct priority queue in the shared memory space. */
-        queue = segment.construct<Queue>("Queue")(Compare(), alloc_inst);
+        queue = segment.construct<Queue>("Queue")(Compare(), segment.get_segment_manager());
         mutex = segment.construct<bip::interprocess_mutex>("mtx")();
+        not_full = segment.construct<bip::interprocess_condition>("not_full")();
         /* Create a RPC server and map the methods to it. */
         switch (BASKET_CONF->RPC_IMPLEMENTATION) {
 #ifdef BASKET_ENABLE_RPCLIB
@@ -63,18 +68,48 @@ priority_queue<MappedType,
                     std::bind(&basket::priority_queue<MappedType,
                               Compare>::LocalPush, this,
                               std::placeholders::_1));
-                std::function<std::pair<bool, MappedType>(void)> popFunc(std::bind(
+                std::function<Optional<MappedType>(void)> popFunc(std::bind(
                     &basket::priority_queue<MappedType,
                     Compare>::LocalPop, this));
                 std::function<size_t(void)> sizeFunc(std::bind(
                     &basket::priority_queue<MappedType,
                     Compare>::LocalSize, this));
-                std::function<std::pair<bool, MappedType>(void)> topFunc(std::bind(
+                std::function<Optional<MappedType>(void)> topFunc(std::bind(
                     &basket::priority_queue<MappedType,
                     Compare>::LocalTop, this));
+                std::function<bool(std::vector<MappedType> &)> pushNFunc(
+                    std::bind(&basket::priority_queue<MappedType,
+                              Compare>::LocalPushN, this,
+                              std::placeholders::_1));
+                std::function<std::vector<MappedType>(uint32_t)> popNFunc(
+                    std::bind(&basket::priority_queue<MappedType,
+                              Compare>::LocalPopN, this,
+                              std::placeholders::_1));
+                std::function<std::pair<Optional<MappedType>, Optional<MappedType>>(
+                    MappedType &)> popIfFunc(
+                    std::bind(&basket::priority_queue<MappedType,
+                              Compare>::LocalPopIf, this,
+                              std::placeholders::_1));
+                std::function<std::pair<Optional<MappedType>, Optional<MappedType>>(void)>
+                popWithTopFunc(std::bind(&basket::priority_queue<MappedType,
+                                         Compare>::LocalPopWithTop, this));
+                std::function<std::vector<MappedType>(uint32_t)> topNFunc(
+                    std::bind(&basket::priority_queue<MappedType,
+                              Compare>::LocalTopN, this,
+                              std::placeholders::_1));
+                std::function<size_t(uint32_t, HTime)> creditsFunc(
+                    std::bind(&basket::priority_queue<MappedType,
+                              Compare>::LocalPollCredits, this,
+                              std::placeholders::_1, std::placeholders::_2));
                 rpc->bind(func_prefix+"_Push", pushFunc);
                 rpc->bind(func_prefix+"_Pop", popFunc);
+                rpc->bind(func_prefix+"_PushN", pushNFunc);
+                rpc->bind(func_prefix+"_PopN", popNFunc);
+                rpc->bind(func_prefix+"_PopIf", popIfFunc);
+                rpc->bind(func_prefix+"_PopWithTop", popWithTopFunc);
                 rpc->bind(func_prefix+"_Top", topFunc);
+                rpc->bind(func_prefix+"_TopN", topNFunc);
+                rpc->bind(func_prefix+"_Credits", creditsFunc);
                 rpc->bind(func_prefix+"_Size", sizeFunc);
                 break;
             }
@@ -101,9 +136,39 @@ priority_queue<MappedType,
                         &basket::priority_queue<MappedType,
                         Compare>::ThalliumLocalTop, this,
                         std::placeholders::_1));
+                    std::function<void(const tl::request &, std::vector<MappedType> &)> pushNFunc(
+                        std::bind(&basket::priority_queue<MappedType,
+                                  Compare>::ThalliumLocalPushN, this,
+                                  std::placeholders::_1, std::placeholders::_2));
+                    std::function<void(const tl::request &, uint32_t)> popNFunc(
+                        std::bind(&basket::priority_queue<MappedType,
+                                  Compare>::ThalliumLocalPopN, this,
+                                  std::placeholders::_1, std::placeholders::_2));
+                    std::function<void(const tl::request &, MappedType &)> popIfFunc(
+                        std::bind(&basket::priority_queue<MappedType,
+                                  Compare>::ThalliumLocalPopIf, this,
+                                  std::placeholders::_1, std::placeholders::_2));
+                    std::function<void(const tl::request &)> popWithTopFunc(std::bind(
+                        &basket::priority_queue<MappedType,
+                        Compare>::ThalliumLocalPopWithTop, this, std::placeholders::_1));
+                    std::function<void(const tl::request &, uint32_t)> topNFunc(
+                        std::bind(&basket::priority_queue<MappedType,
+                                  Compare>::ThalliumLocalTopN, this,
+                                  std::placeholders::_1, std::placeholders::_2));
+                    std::function<void(const tl::request &, uint32_t, HTime)> creditsFunc(
+                        std::bind(&basket::priority_queue<MappedType,
+                                  Compare>::ThalliumLocalPollCredits, this,
+                                  std::placeholders::_1, std::placeholders::_2,
+                                  std::placeholders::_3));
                     rpc->bind(func_prefix+"_Push", pushFunc);
                     rpc->bind(func_prefix+"_Pop", popFunc);
+                    rpc->bind(func_prefix+"_PushN", pushNFunc);
+                    rpc->bind(func_prefix+"_PopN", popNFunc);
+                    rpc->bind(func_prefix+"_PopIf", popIfFunc);
+                    rpc->bind(func_prefix+"_PopWithTop", popWithTopFunc);
                     rpc->bind(func_prefix+"_Top", topFunc);
+                    rpc->bind(func_prefix+"_TopN", topNFunc);
+                    rpc->bind(func_prefix+"_Credits", creditsFunc);
                     rpc->bind(func_prefix+"_Size", sizeFunc);
                     break;
                 }
@@ -119,11 +184,13 @@ priority_queue<MappedType,
                   bip::managed_mapped_file::size_type> res2;
         res2 = segment.find<bip::interprocess_mutex>("mtx");
         mutex = res2.first;
+        not_full = segment.find<bip::interprocess_condition>("not_full").first;
     }
 }
 
 /**
- * Push the data into the local priority queue.
+ * Push the data into the local priority queue. The push never waits: it
+ * fails when the partition holds QUEUE_CAPACITY elements.
  * @param key, the key for put
  * @param data, the value for put
  * @return bool, true if Put was successful else false.
@@ -133,13 +200,77 @@ bool priority_queue<MappedType, Compare>::LocalPush(MappedType &data) {
     AutoTrace trace = AutoTrace("basket::priority_queue::Push(local)",
                                 data);
     bip::scoped_lock<bip::interprocess_mutex> lock(*mutex);
-    queue->push(data);
+    if (FreeSlots() == 0) return false;
+    queue->push(std::move(data));
+    return true;
+}
+
+/**
+ * Push a batch of data into the local priority queue under a single lock
+ * hold. The elements are moved out of data. The batch is pushed as a whole
+ * or, if it does not fit the capacity, not at all.
+ * @param data, the values for push
+ * @return bool, true if Push was successful else false.
+ */
+template<typename MappedType, typename Compare>
+bool priority_queue<MappedType, Compare>::LocalPushN(std::vector<MappedType> &data) {
+    AutoTrace trace = AutoTrace("basket::priority_queue::PushN(local)",
+                                data.size());
+    bip::scoped_lock<bip::interprocess_mutex> lock(*mutex);
+    if (FreeSlots() < data.size()) return false;
+    queue->push_n(data.begin(), data.end());
     return true;
 }
 
+/**
+ * Push a batch of data into the priority queue in a single request. Uses
+ * key_int to decide the server to send it to. A full partition is handled
+ * as in Push; a batch larger than the capacity always fails.
+ * @param data, the values for push
+ * @param key_int, key_int to know which server
+ * @return bool, true if Push was successful else false.
+ */
+template<typename MappedType, typename Compare>
+bool priority_queue<MappedType, Compare>::PushN(std::vector<MappedType> &data,
+                                                uint16_t &key_int) {
+    if (!data.empty()) {
+        RaiseCachedTop(key_int, *std::max_element(data.begin(), data.end(), compare));
+    }
+    if (key_int == my_server && server_on_node) {
+        while (!LocalPushN(data)) {
+            if (!credits.Blocking() || !credits.Fits(data.size())) return false;
+            LocalCredits(data.size(), BASKET_CONF->LONG_POLL_TIMEOUT);
+        }
+        return true;
+    } else {
+        AutoTrace trace = AutoTrace("basket::priority_queue::PushN(remote)",
+                                    data.size(), key_int);
+        auto fetch = [this, key_int](uint32_t n, HTime timeout) {
+            return RequestCredits(key_int, n, timeout);
+        };
+        while (credits.Acquire(key_int, data.size(), fetch)) {
+            if (RemotePushN(data, key_int)) return true;
+            credits.Revoke(key_int);
+            if (!credits.Blocking()) return false;
+        }
+        return false;
+    }
+}
+
+/**
+ * Send one batch push to the priority queue on key_int.
+ */
+template<typename MappedType, typename Compare>
+bool priority_queue<MappedType, Compare>::RemotePushN(std::vector<MappedType> &data,
+                                                      uint16_t key_int) {
+    return RPC_CALL_WRAPPER("_PushN", key_int, bool, data);
+}
+
 /**
  * Push the data into the priority queue. Uses key to decide the
- * server to hash it to,
+ * server to hash it to. On a full partition the push fails, or with
+ * QUEUE_FULL_BLOCK waits for room. Remote pushes are sent against credits,
+ * see CreditTable.
  * @param key, the key for put
  * @param data, the value for put
  * @return bool, true if Put was successful else false.
@@ -147,51 +278,112 @@ bool priority_queue<MappedType, Compare>::LocalPush(MappedType &data) {
 template<typename MappedType, typename Compare>
 bool priority_queue<MappedType, Compare>::Push(MappedType &data,
                                                uint16_t &key_int) {
+    RaiseCachedTop(key_int, data);
     if (key_int == my_server && server_on_node) {
-        return LocalPush(data);
+        while (!LocalPush(data)) {
+            if (!credits.Blocking()) return false;
+            LocalCredits(1, BASKET_CONF->LONG_POLL_TIMEOUT);
+        }
+        return true;
     } else {
         AutoTrace trace = AutoTrace("basket::priority_queue::Push(remote)",
                                     data, key_int);
-        return RPC_CALL_WRAPPER("_Push", key_int, bool,
-                                data);
+        auto fetch = [this, key_int](uint32_t n, HTime timeout) {
+            return RequestCredits(key_int, n, timeout);
+        };
+        while (credits.Acquire(key_int, 1, fetch)) {
+            if (RemotePush(data, key_int)) return true;
+            credits.Revoke(key_int);
+            if (!credits.Blocking()) return false;
+        }
+        return false;
     }
 }
 
+/**
+ * Send one push to the priority queue on key_int.
+ */
+template<typename MappedType, typename Compare>
+bool priority_queue<MappedType, Compare>::RemotePush(MappedType &data, uint16_t key_int) {
+    return RPC_CALL_WRAPPER("_Push", key_int, bool, data);
+}
+
 /**
  * Get the data from the local priority queue.
  * @param key_int, key_int to know which server
- * @return return a pair of bool and Value. If bool is true then data was
- * found and is present in value part else bool is set to false
+ * @return an Optional holding the value, empty if the queue was empty
  */
 template<typename MappedType, typename Compare>
-std::pair<bool, MappedType>
+Optional<MappedType>
 priority_queue<MappedType, Compare>::LocalPop() {
     AutoTrace trace = AutoTrace("basket::priority_queue::Pop(local)");
     bip::scoped_lock<bip::interprocess_mutex> lock(*mutex);
     if (queue->size() > 0) {
-        MappedType value = queue->top();
-        queue->pop();
-        return std::pair<bool, MappedType>(true, value);
+        Optional<MappedType> value(queue->pop_top());
+        if (BASKET_CONF->QUEUE_CAPACITY > 0) not_full->notify_all();
+        return value;
+    }
+    return Optional<MappedType>();
+}
+
+/**
+ * Get up to n elements with the highest priority from the local priority
+ * queue under a single lock hold. The elements are moved out of the queue.
+ * @param n, the most elements to pop
+ * @return a vector of the popped values, highest priority first, empty if
+ * the queue was empty
+ */
+template<typename MappedType, typename Compare>
+std::vector<MappedType>
+priority_queue<MappedType, Compare>::LocalPopN(uint32_t n) {
+    AutoTrace trace = AutoTrace("basket::priority_queue::PopN(local)", n);
+    bip::scoped_lock<bip::interprocess_mutex> lock(*mutex);
+    size_t count = std::min(static_cast<size_t>(n), queue->size());
+    std::vector<MappedType> values;
+    values.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        values.push_back(queue->pop_top());
+    }
+    if (count > 0 && BASKET_CONF->QUEUE_CAPACITY > 0) not_full->notify_all();
+    return values;
+}
+
+/**
+ * Get up to n elements with the highest priority from the priority queue in
+ * a single request. Uses key_int to decide the server to hash it to.
+ * @param n, the most elements to pop
+ * @param key_int, key_int to know which server
+ * @return a vector of the popped values, highest priority first, empty if
+ * the queue was empty
+ */
+template<typename MappedType, typename Compare>
+std::vector<MappedType>
+priority_queue<MappedType, Compare>::PopN(uint32_t n, uint16_t &key_int) {
+    if (key_int == my_server && server_on_node) {
+        return LocalPopN(n);
+    } else {
+        AutoTrace trace = AutoTrace("basket::priority_queue::PopN(remote)",
+                                    n, key_int);
+        typedef std::vector<MappedType> ret_type;
+        return RPC_CALL_WRAPPER("_PopN", key_int, ret_type, n);
     }
-    return std::pair<bool, MappedType>(false, MappedType());
 }
 
 /**
  * Get the data from the priority queue. Uses key_int to decide the
  * server to hash it to,
  * @param key_int, key_int to know which server
- * @return return a pair of bool and Value. If bool is true then data was
- * found and is present in value part else bool is set to false
+ * @return an Optional holding the value, empty if the queue was empty
  */
 template<typename MappedType, typename Compare>
-std::pair<bool, MappedType>
+Optional<MappedType>
 priority_queue<MappedType, Compare>::Pop(uint16_t &key_int) {
     if (key_int == my_server && server_on_node) {
         return LocalPop();
     } else {
         AutoTrace trace = AutoTrace("basket::priority_queue::Pop(remote)",
                                     key_int);
-        typedef std::pair<bool, MappedType> ret_type;
+        typedef Optional<MappedType> ret_type;
         return RPC_CALL_WRAPPER1("_Pop", key_int, ret_type); 
     }
 }
@@ -199,41 +391,383 @@ priority_queue<MappedType, Compare>::Pop(uint16_t &key_int) {
 /**
  * Get the data from the local priority queue.
  * @param key_int, key_int to know which server
- * @return return a pair of bool and Value. If bool is true then data was
- * found and is present in value part else bool is set to false
+ * @return an Optional holding the value, empty if the queue was empty
  */
 template<typename MappedType, typename Compare>
-std::pair<bool, MappedType>
+Optional<MappedType>
 priority_queue<MappedType, Compare>::LocalTop() {
     AutoTrace trace = AutoTrace("basket::priority_queue::Top(local)");
     bip::scoped_lock<bip::interprocess_mutex> lock(*mutex);
     if (queue->size() > 0) {
-        MappedType value = queue->top();
-        return std::pair<bool, MappedType>(true, value);
+        return Optional<MappedType>(queue->top());
     }
-    return std::pair<bool, MappedType>(false, MappedType());;
+    return Optional<MappedType>();
 }
 
 /**
  * Get the data from the priority queue. Uses key_int to decide the
  * server to hash it to,
  * @param key_int, key_int to know which server
- * @return return a pair of bool and Value. If bool is true then data was
- * found and is present in value part else bool is set to false
+ * @return an Optional holding the value, empty if the queue was empty
  */
 template<typename MappedType, typename Compare>
-std::pair<bool, MappedType>
+Optional<MappedType>
 priority_queue<MappedType, Compare>::Top(uint16_t &key_int) {
     if (key_int == my_server && server_on_node) {
         return LocalTop();
     } else {
         AutoTrace trace = AutoTrace("basket::priority_queue::Top(remote)",
                                     key_int);
-        typedef std::pair<bool, MappedType> ret_type;
+        typedef Optional<MappedType> ret_type;
         return RPC_CALL_WRAPPER1("_Top", key_int, ret_type);
     }
 }
 
+/**
+ * Get up to k elements with the highest priority from the local priority
+ * queue without removing them.
+ * @param k, the most elements to return
+ * @return a vector of copies of the values, highest priority first
+ */
+template<typename MappedType, typename Compare>
+std::vector<MappedType>
+priority_queue<MappedType, Compare>::LocalTopN(uint32_t k) {
+    AutoTrace trace = AutoTrace("basket::priority_queue::TopN(local)", k);
+    bip::scoped_lock<bip::interprocess_mutex> lock(*mutex);
+    return queue->top_n(k);
+}
+
+/**
+ * Get up to k elements with the highest priority from the priority queue
+ * without removing them. Uses key_int to decide the server to hash it to.
+ * @param k, the most elements to return
+ * @param key_int, key_int to know which server
+ * @return a vector of copies of the values, highest priority first
+ */
+template<typename MappedType, typename Compare>
+std::vector<MappedType>
+priority_queue<MappedType, Compare>::TopN(uint32_t k, uint16_t &key_int) {
+    if (key_int == my_server && server_on_node) {
+        return LocalTopN(k);
+    } else {
+        AutoTrace trace = AutoTrace("basket::priority_queue::TopN(remote)",
+                                    k, key_int);
+        typedef std::vector<MappedType> ret_type;
+        return RPC_CALL_WRAPPER("_TopN", key_int, ret_type, k);
+    }
+}
+
+/**
+ * Pop the top of the local priority queue if it is still as good as
+ * expected, the top a client saw before. Elements of equal priority count
+ * as the same, so any of them may be popped.
+ * @param expected, the top the caller wants to pop
+ * @return a pair of the popped value, empty if the top changed, and the
+ * top left behind
+ */
+template<typename MappedType, typename Compare>
+std::pair<Optional<MappedType>, Optional<MappedType>>
+priority_queue<MappedType, Compare>::LocalPopIf(MappedType &expected) {
+    AutoTrace trace = AutoTrace("basket::priority_queue::PopIf(local)");
+    bip::scoped_lock<bip::interprocess_mutex> lock(*mutex);
+    std::pair<Optional<MappedType>, Optional<MappedType>> result;
+    if (queue->size() > 0 && !compare(queue->top(), expected) &&
+        !compare(expected, queue->top())) {
+        result.first.emplace(queue->pop_top());
+        if (BASKET_CONF->QUEUE_CAPACITY > 0) not_full->notify_all();
+    }
+    if (queue->size() > 0) result.second.emplace(queue->top());
+    return result;
+}
+
+/**
+ * Pop the top of the priority queue on key_int if it is still as good as
+ * expected.
+ * @return a pair of the popped value and the top left behind
+ */
+template<typename MappedType, typename Compare>
+std::pair<Optional<MappedType>, Optional<MappedType>>
+priority_queue<MappedType, Compare>::PopIf(MappedType &expected, uint16_t key_int) {
+    if (key_int == my_server && server_on_node) {
+        return LocalPopIf(expected);
+    } else {
+        AutoTrace trace = AutoTrace("basket::priority_queue::PopIf(remote)",
+                                    key_int);
+        typedef std::pair<Optional<MappedType>, Optional<MappedType>> ret_type;
+        return RPC_CALL_WRAPPER("_PopIf", key_int, ret_type, expected);
+    }
+}
+
+/**
+ * Pop the top of the local priority queue and report the top left behind.
+ * @return a pair of the popped value, empty if the queue was empty, and the
+ * new top
+ */
+template<typename MappedType, typename Compare>
+std::pair<Optional<MappedType>, Optional<MappedType>>
+priority_queue<MappedType, Compare>::LocalPopWithTop() {
+    AutoTrace trace = AutoTrace("basket::priority_queue::PopWithTop(local)");
+    bip::scoped_lock<bip::interprocess_mutex> lock(*mutex);
+    std::pair<Optional<MappedType>, Optional<MappedType>> result;
+    if (queue->size() > 0) {
+        result.first.emplace(queue->pop_top());
+        if (BASKET_CONF->QUEUE_CAPACITY > 0) not_full->notify_all();
+    }
+    if (queue->size() > 0) result.second.emplace(queue->top());
+    return result;
+}
+
+/**
+ * Pop the top of the priority queue on key_int and report the new top.
+ * @return a pair of the popped value and the top left behind
+ */
+template<typename MappedType, typename Compare>
+std::pair<Optional<MappedType>, Optional<MappedType>>
+priority_queue<MappedType, Compare>::PopWithTop(uint16_t key_int) {
+    if (key_int == my_server && server_on_node) {
+        return LocalPopWithTop();
+    } else {
+        AutoTrace trace = AutoTrace("basket::priority_queue::PopWithTop(remote)",
+                                    key_int);
+        typedef std::pair<Optional<MappedType>, Optional<MappedType>> ret_type;
+        return RPC_CALL_WRAPPER1("_PopWithTop", key_int, ret_type);
+    }
+}
+
+/**
+ * Push the data for a relaxed priority order: to the server of the node if
+ * there is one, else to a random server. Elements pushed this way should be
+ * popped with RelaxedPop.
+ * @param data, the value for push
+ * @return bool, true if Push was successful else false.
+ */
+template<typename MappedType, typename Compare>
+bool priority_queue<MappedType, Compare>::RelaxedPush(MappedType &data) {
+    uint16_t key_int = my_server;
+    if (!server_on_node) {
+        std::lock_guard<std::mutex> guard(tops_mutex);
+        key_int = std::uniform_int_distribution<uint16_t>(0, num_servers - 1)(random);
+    }
+    return Push(data, key_int);
+}
+
+/**
+ * Pop an element of high, but not necessarily the highest, priority. Two
+ * random servers are compared by their cached tops and the better one is
+ * popped, as in a MultiQueue: consumers spread over all servers instead of
+ * contending for the one holding the best element, and the popped element
+ * stays close to the global order. Falls back to GlobalPop if both servers
+ * look empty.
+ * @return an Optional holding the value, empty if every server was found
+ * empty
+ */
+template<typename MappedType, typename Compare>
+Optional<MappedType> priority_queue<MappedType, Compare>::RelaxedPop() {
+    AutoTrace trace = AutoTrace("basket::priority_queue::RelaxedPop");
+    uint16_t first, second;
+    {
+        std::lock_guard<std::mutex> guard(tops_mutex);
+        std::uniform_int_distribution<uint16_t> pick(0, num_servers - 1);
+        first = pick(random);
+        second = pick(random);
+    }
+    Optional<MappedType> first_top = CachedTopOf(first);
+    Optional<MappedType> second_top = CachedTopOf(second);
+    if (!first_top && !second_top) return GlobalPop();
+    uint16_t server = !first_top || (second_top && compare(*first_top, *second_top))
+                      ? second : first;
+    std::pair<Optional<MappedType>, Optional<MappedType>> result = PopWithTop(server);
+    CacheTop(server, std::move(result.second));
+    if (result.first) return std::move(result.first);
+    return GlobalPop();
+}
+
+/**
+ * Get the cached top of server, fetching it first if it is not known yet or
+ * expired.
+ */
+template<typename MappedType, typename Compare>
+Optional<MappedType> priority_queue<MappedType, Compare>::CachedTopOf(uint16_t server) {
+    {
+        std::lock_guard<std::mutex> guard(tops_mutex);
+        if (Fresh(tops[server], LeaseClock())) return tops[server].value;
+    }
+    Optional<MappedType> top = Top(server);
+    CacheTop(server, top);
+    return top;
+}
+
+/**
+ * Get the k elements with the highest priority across all servers without
+ * removing them. Every server is asked for its k best; the answers also
+ * refresh the cached tops GlobalPop works from.
+ * @param k, the most elements to return
+ * @return a vector of copies of the values, highest priority first
+ */
+template<typename MappedType, typename Compare>
+std::vector<MappedType> priority_queue<MappedType, Compare>::GlobalTop(uint32_t k) {
+    AutoTrace trace = AutoTrace("basket::priority_queue::GlobalTop", k);
+    std::vector<MappedType> values;
+    for (uint16_t server = 0; server < num_servers; ++server) {
+        std::vector<MappedType> best = TopN(k, server);
+        CacheTop(server, best.empty() ? Optional<MappedType>()
+                                      : Optional<MappedType>(best.front()));
+        std::move(best.begin(), best.end(), std::back_inserter(values));
+    }
+    auto higher = [this](const MappedType &a, const MappedType &b) { return compare(b, a); };
+    size_t count = std::min(static_cast<size_t>(k), values.size());
+    std::partial_sort(values.begin(), values.begin() + count, values.end(), higher);
+    values.erase(values.begin() + count, values.end());
+    return values;
+}
+
+/**
+ * Pop the element with the highest priority across all servers. The
+ * client picks the best of the server tops it cached and pops it with one
+ * conditional request; only if another consumer took that top meanwhile it
+ * retries, with the new top the server returned. A cached top changes only
+ * with the pops and pushes of this client on that server, or once it is
+ * TOP_CACHE_REFRESH microseconds old if that is set, so an element another
+ * client pushed may be passed over until then. The cache is fetched anew
+ * when it looks empty.
+ * @return an Optional holding the value, empty if every server was found
+ * empty
+ */
+template<typename MappedType, typename Compare>
+Optional<MappedType> priority_queue<MappedType, Compare>::GlobalPop() {
+    AutoTrace trace = AutoTrace("basket::priority_queue::GlobalPop");
+    bool force = false;
+    while (true) {
+        uint16_t server = 0;
+        Optional<MappedType> candidate = BestCachedTop(force, server);
+        if (!candidate) {
+            /* the cache may miss pushes, ask every server before giving up */
+            if (force) return candidate;
+            force = true;
+            continue;
+        }
+        force = false;
+        std::pair<Optional<MappedType>, Optional<MappedType>> result =
+                PopIf(*candidate, server);
+        CacheTop(server, std::move(result.second));
+        if (result.first) return std::move(result.first);
+    }
+}
+
+/**
+ * Find the best of the cached server tops, fetching the unknown and expired
+ * ones, or all of them if force is set, first.
+ * @param server, set to the server holding the best top
+ * @return an Optional holding a copy of the best top, empty if all cached
+ * tops are empty
+ */
+template<typename MappedType, typename Compare>
+Optional<MappedType>
+priority_queue<MappedType, Compare>::BestCachedTop(bool force, uint16_t &server) {
+    HTime now = LeaseClock();
+    for (uint16_t key_int = 0; key_int < num_servers; ++key_int) {
+        {
+            std::lock_guard<std::mutex> guard(tops_mutex);
+            if (!force && Fresh(tops[key_int], now)) continue;
+        }
+        CacheTop(key_int, Top(key_int));
+    }
+    std::lock_guard<std::mutex> guard(tops_mutex);
+    Optional<MappedType> best;
+    for (uint16_t key_int = 0; key_int < num_servers; ++key_int) {
+        const Optional<MappedType> &top = tops[key_int].value;
+        if (top && (!best || compare(*best, *top))) {
+            best = top;
+            server = key_int;
+        }
+    }
+    return best;
+}
+
+/**
+ * Remember value as the current top of server.
+ */
+template<typename MappedType, typename Compare>
+void priority_queue<MappedType, Compare>::CacheTop(uint16_t server, Optional<MappedType> value) {
+    HTime refresh = BASKET_CONF->TOP_CACHE_REFRESH;
+    std::lock_guard<std::mutex> guard(tops_mutex);
+    tops[server] = CachedTop{std::move(value), true, refresh > 0 ? LeaseClock() + refresh : 0};
+}
+
+/**
+ * Make value the cached top of server if it beats the known top, ahead of a
+ * push of value to server. Should the push fail, the next PopIf on server
+ * fails as well and returns the real top.
+ */
+template<typename MappedType, typename Compare>
+void priority_queue<MappedType, Compare>::RaiseCachedTop(uint16_t server,
+                                                         const MappedType &value) {
+    std::lock_guard<std::mutex> guard(tops_mutex);
+    CachedTop &top = tops[server];
+    if (top.known && (!top.value || compare(*top.value, value))) top.value.emplace(value);
+}
+
+/**
+ * Check whether a cached top may be used without fetching it. Needs
+ * tops_mutex held.
+ */
+template<typename MappedType, typename Compare>
+bool priority_queue<MappedType, Compare>::Fresh(const CachedTop &top, HTime now) const {
+    return top.known && (top.expiry == 0 || top.expiry > now);
+}
+
+/**
+ * Count the elements that still fit in the local priority queue, unbounded
+ * if QUEUE_CAPACITY is not set. Needs the mutex held.
+ */
+template<typename MappedType, typename Compare>
+size_t priority_queue<MappedType, Compare>::FreeSlots() {
+    size_t capacity = BASKET_CONF->QUEUE_CAPACITY;
+    if (capacity == 0) return std::numeric_limits<size_t>::max();
+    return capacity - std::min(queue->size(), capacity);
+}
+
+/**
+ * Wait until the local priority queue has room for n elements or timeout
+ * passed, and grant credits for the room found. Producers split the free
+ * slots, see CreditGrant.
+ * @param n, the slots the producer needs
+ * @param timeout, the longest wait in microseconds
+ * @return the granted slots, 0 if fewer than n slots were free
+ */
+template<typename MappedType, typename Compare>
+size_t priority_queue<MappedType, Compare>::LocalCredits(uint32_t n, HTime timeout) {
+    AutoTrace trace = AutoTrace("basket::priority_queue::Credits(local)", n, timeout);
+    boost::posix_time::ptime deadline =
+            boost::posix_time::microsec_clock::universal_time() +
+            boost::posix_time::microseconds(timeout);
+    bip::scoped_lock<bip::interprocess_mutex> lock(*mutex);
+    not_full->timed_wait(lock, deadline, [this, n]() { return FreeSlots() >= n; });
+    return CreditGrant(FreeSlots(), n, comm_size);
+}
+
+/**
+ * Serve a remote credit request, held for up to timeout only while an RPC
+ * thread can be spared for it, see LongPollLimit.
+ * @return the granted slots, 0 if fewer than n slots were free
+ */
+template<typename MappedType, typename Compare>
+size_t priority_queue<MappedType, Compare>::LocalPollCredits(uint32_t n, HTime timeout) {
+    LongPollSlot slot(polls);
+    return LocalCredits(n, slot.Timeout(timeout));
+}
+
+/**
+ * Ask the priority queue on key_int for credits, held by the server for at
+ * most timeout if it has no room.
+ * @return the granted slots, 0 if fewer than n slots were free
+ */
+template<typename MappedType, typename Compare>
+size_t priority_queue<MappedType, Compare>::RequestCredits(uint16_t key_int, uint32_t n,
+                                                           HTime timeout) {
+    return RPC_CALL_WRAPPER("_Credits", key_int, size_t, n, timeout);
+}
+
 /**
  * Get the size of the local priority queue.
  * @param key_int, key_int to know which server
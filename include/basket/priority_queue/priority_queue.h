@@ -29,6 +29,9 @@
 #include <basket/common/singleton.h>
 #include <basket/common/debug.h>
 #include <basket/common/typedefs.h>
+#include <basket/common/flow_control.h>
+#include <basket/common/dary_heap.h>
+#include <basket/common/client_cache.h>
 /** MPI Headers**/
 #include <mpi.h>
 /** RPC Lib Headers**/
@@ -46,16 +49,22 @@
 #include <boost/interprocess/managed_shared_memory.hpp>
 #include <boost/interprocess/allocators/allocator.hpp>
 #include <boost/interprocess/sync/interprocess_mutex.hpp>
+#include <boost/interprocess/sync/interprocess_condition.hpp>
 #include <boost/interprocess/sync/scoped_lock.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
 #include <boost/algorithm/string.hpp>
 /** Standard C++ Headers**/
 #include <iostream>
 #include <functional>
 #include <utility>
-#include <queue>
 #include <string>
 #include <memory>
 #include <vector>
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <mutex>
+#include <random>
 
 /** Namespaces Uses **/
 namespace bip = boost::interprocess;
@@ -73,12 +82,13 @@ template<typename MappedType, typename Compare = std::less<MappedType>>
 class priority_queue {
   private:
     /** Class Typedefs for ease of use **/
-    typedef bip::allocator<MappedType,
-                           bip::managed_mapped_file::segment_manager>
-    ShmemAllocator;
-    typedef std::priority_queue<MappedType,
-                                std::vector<MappedType, ShmemAllocator>, Compare>
-    Queue;
+    typedef DaryHeap<MappedType, Compare> Queue;
+    /* top of a server as last seen by this client, expiry 0 never expires */
+    struct CachedTop {
+        Optional<MappedType> value;
+        bool known;
+        HTime expiry;
+    };
 
     /** Class attributes**/
     int comm_size, my_rank, num_servers;
@@ -90,8 +100,28 @@ class priority_queue {
     std::string name, func_prefix;
     Queue *queue;
     boost::interprocess::interprocess_mutex* mutex;
+    boost::interprocess::interprocess_condition* not_full;
     bool server_on_node;
     CharStruct backed_file;
+    CreditTable credits;
+    LongPollLimit polls;
+    Compare compare;
+    std::vector<CachedTop> tops;
+    std::minstd_rand random;
+    std::mutex tops_mutex;
+
+    bool RemotePush(MappedType &data, uint16_t key_int);
+    bool RemotePushN(std::vector<MappedType> &data, uint16_t key_int);
+    size_t RequestCredits(uint16_t key_int, uint32_t n, HTime timeout);
+    size_t FreeSlots();
+    Optional<MappedType> BestCachedTop(bool force, uint16_t &server);
+    void CacheTop(uint16_t server, Optional<MappedType> value);
+    void RaiseCachedTop(uint16_t server, const MappedType &value);
+    bool Fresh(const CachedTop &top, HTime now) const;
+    std::pair<Optional<MappedType>, Optional<MappedType>>
+    PopIf(MappedType &expected, uint16_t key_int);
+    std::pair<Optional<MappedType>, Optional<MappedType>> PopWithTop(uint16_t key_int);
+    Optional<MappedType> CachedTopOf(uint16_t server);
 
   public:
     ~priority_queue();
@@ -99,20 +129,40 @@ class priority_queue {
     explicit priority_queue(std::string name_ = "TEST_PRIORITY_QUEUE");
 
     bool LocalPush(MappedType &data);
-    std::pair<bool, MappedType> LocalPop();
-    std::pair<bool, MappedType> LocalTop();
+    bool LocalPushN(std::vector<MappedType> &data);
+    Optional<MappedType> LocalPop();
+    std::vector<MappedType> LocalPopN(uint32_t n);
+    std::pair<Optional<MappedType>, Optional<MappedType>> LocalPopIf(MappedType &expected);
+    std::pair<Optional<MappedType>, Optional<MappedType>> LocalPopWithTop();
+    Optional<MappedType> LocalTop();
+    std::vector<MappedType> LocalTopN(uint32_t k);
+    size_t LocalCredits(uint32_t n, HTime timeout);
+    size_t LocalPollCredits(uint32_t n, HTime timeout);
     size_t LocalSize();
 
 #if defined(BASKET_ENABLE_THALLIUM_TCP) || defined(BASKET_ENABLE_THALLIUM_ROCE)
     THALLIUM_DEFINE(LocalPush, (data), MappedType &data)
+    THALLIUM_DEFINE(LocalPushN, (data), std::vector<MappedType> &data)
     THALLIUM_DEFINE1(LocalPop)
+    THALLIUM_DEFINE(LocalPopN, (n), uint32_t n)
+    THALLIUM_DEFINE(LocalPopIf, (expected), MappedType &expected)
+    THALLIUM_DEFINE1(LocalPopWithTop)
     THALLIUM_DEFINE1(LocalTop)
+    THALLIUM_DEFINE(LocalTopN, (k), uint32_t k)
+    THALLIUM_DEFINE(LocalPollCredits, (n, timeout), uint32_t n, HTime timeout)
     THALLIUM_DEFINE1(LocalSize)
 #endif
 
     bool Push(MappedType &data, uint16_t &key_int);
-    std::pair<bool, MappedType> Pop(uint16_t &key_int);
-    std::pair<bool, MappedType> Top(uint16_t &key_int);
+    bool PushN(std::vector<MappedType> &data, uint16_t &key_int);
+    Optional<MappedType> Pop(uint16_t &key_int);
+    std::vector<MappedType> PopN(uint32_t n, uint16_t &key_int);
+    Optional<MappedType> Top(uint16_t &key_int);
+    std::vector<MappedType> TopN(uint32_t k, uint16_t &key_int);
+    std::vector<MappedType> GlobalTop(uint32_t k);
+    Optional<MappedType> GlobalPop();
+    bool RelaxedPush(MappedType &data);
+    Optional<MappedType> RelaxedPop();
     size_t Size(uint16_t &key_int);
 };
 
@@ -29,7 +29,14 @@ queue<MappedType>::queue(std::string name_)
           comm_size(1), my_rank(0), memory_allocated(BASKET_CONF->MEMORY_ALLOCATED),
           backed_file(BASKET_CONF->BACKED_FILE_DIR + PATH_SEPARATOR + name_+"_"+std::to_string(my_server)),
           name(name_), segment(), my_queue(), func_prefix(name_),
-          server_on_node(BASKET_CONF->SERVER_ON_NODE) {
+          server_on_node(BASKET_CONF->SERVER_ON_NODE), ring(nullptr), waiters(nullptr),
+          space_waiters(nullptr), size_hints(BASKET_CONF->NUM_SERVERS, 0),
+          random(BASKET_CONF->MPI_RANK + 1), hints_mutex(), leftovers(), leftovers_mutex(),
+          credits(BASKET_CONF->QUEUE_RING_CAPACITY > 0 ? BASKET_CONF->QUEUE_RING_CAPACITY
+                                                       : BASKET_CONF->QUEUE_CAPACITY,
+                  BASKET_CONF->QUEUE_FULL_POLICY, BASKET_CONF->LONG_POLL_TIMEOUT,
+                  BASKET_CONF->NUM_SERVERS),
+          polls(BASKET_CONF->RPC_THREADS) {
     AutoTrace trace = AutoTrace("basket::queue(local)");
     /* Initialize MPI rank and size of world */
     MPI_Comm_size(MPI_COMM_WORLD, &comm_size);
@@ -48,6 +55,15 @@ queue<MappedType>::queue(std::string name_)
         /* Construct queue in the shared memory space. */
         my_queue = segment.construct<Queue>("Queue")(alloc_inst);
         mutex = segment.construct<bip::interprocess_mutex>("mtx")();
+        not_empty = segment.construct<bip::interprocess_condition>("not_empty")();
+        not_full = segment.construct<bip::interprocess_condition>("not_full")();
+        /* Construct the lock free ring if it replaces the deque. */
+        if (BASKET_CONF->QUEUE_RING_CAPACITY > 0) {
+            ring = segment.construct<RingBuffer<MappedType>>("ring")(
+                BASKET_CONF->QUEUE_RING_CAPACITY, segment.get_segment_manager());
+            waiters = segment.construct<std::atomic<uint32_t>>("waiters")(0);
+            space_waiters = segment.construct<std::atomic<uint32_t>>("space_waiters")(0);
+        }
         /* Create a RPC server and map the methods to it. */
         switch (BASKET_CONF->RPC_IMPLEMENTATION) {
 #ifdef BASKET_ENABLE_RPCLIB
@@ -55,15 +71,32 @@ queue<MappedType>::queue(std::string name_)
                 std::function<bool(MappedType &)> pushFunc(
                     std::bind(&basket::queue<MappedType>::LocalPush, this,
                               std::placeholders::_1));
-                std::function<std::pair<bool, MappedType>(void)> popFunc(std::bind(
+                std::function<Optional<MappedType>(void)> popFunc(std::bind(
                     &basket::queue<MappedType>::LocalPop, this));
+                std::function<bool(std::vector<MappedType> &)> pushNFunc(
+                    std::bind(&basket::queue<MappedType>::LocalPushN, this,
+                              std::placeholders::_1));
+                std::function<std::vector<MappedType>(uint32_t)> popNFunc(
+                    std::bind(&basket::queue<MappedType>::LocalPopN, this,
+                              std::placeholders::_1));
+                std::function<std::pair<std::vector<MappedType>, size_t>(uint32_t)> stealFunc(
+                    std::bind(&basket::queue<MappedType>::LocalSteal, this,
+                              std::placeholders::_1));
                 std::function<size_t(void)> sizeFunc(std::bind(
                     &basket::queue<MappedType>::LocalSize, this));
-                std::function<bool(void)> waitForElementFunc(std::bind(
-                    &basket::queue<MappedType>::LocalWaitForElement, this));
+                std::function<bool(HTime)> waitForElementFunc(std::bind(
+                    &basket::queue<MappedType>::LocalPollForElement, this,
+                    std::placeholders::_1));
+                std::function<size_t(uint32_t, HTime)> creditsFunc(std::bind(
+                    &basket::queue<MappedType>::LocalPollCredits, this,
+                    std::placeholders::_1, std::placeholders::_2));
                 rpc->bind(func_prefix+"_Push", pushFunc);
                 rpc->bind(func_prefix+"_Pop", popFunc);
+                rpc->bind(func_prefix+"_PushN", pushNFunc);
+                rpc->bind(func_prefix+"_PopN", popNFunc);
+                rpc->bind(func_prefix+"_Steal", stealFunc);
                 rpc->bind(func_prefix+"_WaitForElement", waitForElementFunc);
+                rpc->bind(func_prefix+"_Credits", creditsFunc);
                 rpc->bind(func_prefix+"_Size", sizeFunc);
                 break;
             }
@@ -81,14 +114,31 @@ queue<MappedType>::queue(std::string name_)
                                   std::placeholders::_1, std::placeholders::_2));
                     std::function<void(const tl::request &)> popFunc(std::bind(
                         &basket::queue<MappedType>::ThalliumLocalPop, this, std::placeholders::_1));
+                    std::function<void(const tl::request &, std::vector<MappedType> &)> pushNFunc(
+                        std::bind(&basket::queue<MappedType>::ThalliumLocalPushN, this,
+                                  std::placeholders::_1, std::placeholders::_2));
+                    std::function<void(const tl::request &, uint32_t)> popNFunc(
+                        std::bind(&basket::queue<MappedType>::ThalliumLocalPopN, this,
+                                  std::placeholders::_1, std::placeholders::_2));
+                    std::function<void(const tl::request &, uint32_t)> stealFunc(
+                        std::bind(&basket::queue<MappedType>::ThalliumLocalSteal, this,
+                                  std::placeholders::_1, std::placeholders::_2));
                     std::function<void(const tl::request &)> sizeFunc(std::bind(
                         &basket::queue<MappedType>::ThalliumLocalSize, this, std::placeholders::_1));
-                    std::function<void(const tl::request &)> waitForElementFunc(std::bind(
-                        &basket::queue<MappedType>::ThalliumLocalWaitForElement, this,
-                        std::placeholders::_1));
+                    std::function<void(const tl::request &, HTime)> waitForElementFunc(std::bind(
+                        &basket::queue<MappedType>::ThalliumLocalPollForElement, this,
+                        std::placeholders::_1, std::placeholders::_2));
+                    std::function<void(const tl::request &, uint32_t, HTime)> creditsFunc(
+                        std::bind(&basket::queue<MappedType>::ThalliumLocalPollCredits, this,
+                                  std::placeholders::_1, std::placeholders::_2,
+                                  std::placeholders::_3));
                     rpc->bind(func_prefix+"_Push", pushFunc);
                     rpc->bind(func_prefix+"_Pop", popFunc);
+                    rpc->bind(func_prefix+"_PushN", pushNFunc);
+                    rpc->bind(func_prefix+"_PopN", popNFunc);
+                    rpc->bind(func_prefix+"_Steal", stealFunc);
                     rpc->bind(func_prefix+"_WaitForElement", waitForElementFunc);
+                    rpc->bind(func_prefix+"_Credits", creditsFunc);
                     rpc->bind(func_prefix+"_Size", sizeFunc);
                     break;
                 }
@@ -104,11 +154,18 @@ queue<MappedType>::queue(std::string name_)
                   bip::managed_mapped_file::size_type> res2;
         res2 = segment.find<bip::interprocess_mutex>("mtx");
         mutex = res2.first;
+        not_empty = segment.find<bip::interprocess_condition>("not_empty").first;
+        not_full = segment.find<bip::interprocess_condition>("not_full").first;
+        ring = segment.find<RingBuffer<MappedType>>("ring").first;
+        waiters = segment.find<std::atomic<uint32_t>>("waiters").first;
+        space_waiters = segment.find<std::atomic<uint32_t>>("space_waiters").first;
     }
 }
 
 /**
- * Push the data into the local queue.
+ * Push the data into the local queue. The push never waits: it fails when
+ * the partition holds QUEUE_CAPACITY elements, or with the ring backend
+ * when the ring is full. The ring push takes no lock.
  * @param key, the key for put
  * @param data, the value for put
  * @return bool, true if Put was successful else false.
@@ -116,13 +173,22 @@ queue<MappedType>::queue(std::string name_)
 template<typename MappedType>
 bool queue<MappedType>::LocalPush(MappedType &data) {
     AutoTrace trace = AutoTrace("basket::queue::Push(local)", data);
+    if (ring != nullptr) {
+        if (!ring->TryPush(data)) return false;
+        NotifyWaiters(waiters, not_empty);
+        return true;
+    }
     bip::scoped_lock<bip::interprocess_mutex> lock(*mutex);
+    if (FreeSlots() == 0) return false;
     my_queue->push_back(std::move(data));
+    not_empty->notify_all();
     return true;
 }
 
 /**
- * Push the data into the queue. Uses key to decide the server to hash it to,
+ * Push the data into the queue. Uses key to decide the server to hash it to.
+ * On a full partition the push fails, or with QUEUE_FULL_BLOCK waits for
+ * room. Remote pushes are sent against credits, see CreditTable.
  * @param key, the key for put
  * @param data, the value for put
  * @return bool, true if Put was successful else false.
@@ -131,66 +197,464 @@ template<typename MappedType>
 bool queue<MappedType>::Push(MappedType &data,
                              uint16_t &key_int) {
     if (key_int == my_server && server_on_node) {
-        return LocalPush(data);
+        while (!LocalPush(data)) {
+            if (!credits.Blocking()) return false;
+            LocalCredits(1, BASKET_CONF->LONG_POLL_TIMEOUT);
+        }
+        return true;
     } else {
         AutoTrace trace = AutoTrace("basket::queue::Push(remote)", data,
                                     key_int);
-        return RPC_CALL_WRAPPER("_Push", key_int, bool,
-                                data);
+        auto fetch = [this, key_int](uint32_t n, HTime timeout) {
+            return RequestCredits(key_int, n, timeout);
+        };
+        while (credits.Acquire(key_int, 1, fetch)) {
+            if (RemotePush(data, key_int)) return true;
+            credits.Revoke(key_int);
+            if (!credits.Blocking()) return false;
+        }
+        return false;
     }
 }
 
+/**
+ * Send one push to the queue on key_int.
+ */
+template<typename MappedType>
+bool queue<MappedType>::RemotePush(MappedType &data, uint16_t key_int) {
+    return RPC_CALL_WRAPPER("_Push", key_int, bool, data);
+}
+
+/**
+ * Push a batch of data into the local queue under a single lock hold. The
+ * elements are moved out of data. The batch is pushed as a whole or, if it
+ * does not fit the capacity or the ring, not at all.
+ * @param data, the values for push, in order
+ * @return bool, true if Push was successful else false.
+ */
+template<typename MappedType>
+bool queue<MappedType>::LocalPushN(std::vector<MappedType> &data) {
+    AutoTrace trace = AutoTrace("basket::queue::PushN(local)", data.size());
+    if (ring != nullptr) {
+        if (!ring->TryPushN(data.data(), data.size())) return false;
+        if (!data.empty()) NotifyWaiters(waiters, not_empty);
+        return true;
+    }
+    bip::scoped_lock<bip::interprocess_mutex> lock(*mutex);
+    if (FreeSlots() < data.size()) return false;
+    for (MappedType &element : data) {
+        my_queue->push_back(std::move(element));
+    }
+    if (!data.empty()) not_empty->notify_all();
+    return true;
+}
+
+/**
+ * Push a batch of data into the queue in a single request. Uses key_int to
+ * decide the server to send it to. A full partition is handled as in Push;
+ * a batch larger than the capacity always fails.
+ * @param data, the values for push, in order
+ * @param key_int, key_int to know which server
+ * @return bool, true if Push was successful else false.
+ */
+template<typename MappedType>
+bool queue<MappedType>::PushN(std::vector<MappedType> &data,
+                              uint16_t &key_int) {
+    if (key_int == my_server && server_on_node) {
+        while (!LocalPushN(data)) {
+            if (!credits.Blocking() || !credits.Fits(data.size())) return false;
+            LocalCredits(data.size(), BASKET_CONF->LONG_POLL_TIMEOUT);
+        }
+        return true;
+    } else {
+        AutoTrace trace = AutoTrace("basket::queue::PushN(remote)",
+                                    data.size(), key_int);
+        auto fetch = [this, key_int](uint32_t n, HTime timeout) {
+            return RequestCredits(key_int, n, timeout);
+        };
+        while (credits.Acquire(key_int, data.size(), fetch)) {
+            if (RemotePushN(data, key_int)) return true;
+            credits.Revoke(key_int);
+            if (!credits.Blocking()) return false;
+        }
+        return false;
+    }
+}
+
+/**
+ * Send one batch push to the queue on key_int.
+ */
+template<typename MappedType>
+bool queue<MappedType>::RemotePushN(std::vector<MappedType> &data, uint16_t key_int) {
+    return RPC_CALL_WRAPPER("_PushN", key_int, bool, data);
+}
+
 /**
  * Get the local data from the queue.
  * @param key_int, key_int to know which server
- * @return return a pair of bool and Value. If bool is true then data was
- * found and is present in value part else bool is set to false
+ * @return an Optional holding the value, empty if the queue was empty
  */
 template<typename MappedType>
-std::pair<bool, MappedType>
+Optional<MappedType>
 queue<MappedType>::LocalPop() {
     AutoTrace trace = AutoTrace("basket::queue::Pop(local)");
+    if (ring != nullptr) {
+        Optional<MappedType> value;
+        if (ring->TryPopInto([&value](MappedType &&data) {
+                value.emplace(std::move(data));
+            })) {
+            NotifyWaiters(space_waiters, not_full);
+        }
+        return value;
+    }
     bip::scoped_lock<bip::interprocess_mutex> lock(*mutex);
     if (my_queue->size() > 0) {
-        MappedType value = my_queue->front();
+        Optional<MappedType> value(std::move(my_queue->front()));
         my_queue->pop_front();
-        return std::pair<bool, MappedType>(true, value);
+        if (BASKET_CONF->QUEUE_CAPACITY > 0) not_full->notify_all();
+        return value;
     }
-    return std::pair<bool, MappedType>(false, MappedType());
+    return Optional<MappedType>();
 }
 
 /**
  * Get the data from the queue. Uses key_int to decide the server to hash it
  * to,
  * @param key_int, key_int to know which server
- * @return return a pair of bool and Value. If bool is true then data was
- * found and is present in value part else bool is set to false
+ * @return an Optional holding the value, empty if the queue was empty
  */
 template<typename MappedType>
-std::pair<bool, MappedType>
+Optional<MappedType>
 queue<MappedType>::Pop(uint16_t &key_int) {
     if (key_int == my_server && server_on_node) {
         return LocalPop();
     } else {
         AutoTrace trace = AutoTrace("basket::queue::Pop(remote)",
                                     key_int);
-        typedef std::pair<bool, MappedType> ret_type;
+        typedef Optional<MappedType> ret_type;
         return RPC_CALL_WRAPPER1("_Pop", key_int, ret_type);
     }
 }
 
+/**
+ * Get up to n elements from the front of the local queue under a single
+ * lock hold. The elements are moved out of the queue.
+ * @param n, the most elements to pop
+ * @return a vector of the popped values in queue order, empty if the queue
+ * was empty
+ */
+template<typename MappedType>
+std::vector<MappedType>
+queue<MappedType>::LocalPopN(uint32_t n) {
+    AutoTrace trace = AutoTrace("basket::queue::PopN(local)", n);
+    if (ring != nullptr) {
+        std::vector<MappedType> values;
+        values.reserve(std::min(static_cast<size_t>(n), ring->Size()));
+        auto append = [&values](MappedType &&data) {
+            values.push_back(std::move(data));
+        };
+        while (values.size() < n && ring->TryPopInto(append)) {}
+        if (!values.empty()) NotifyWaiters(space_waiters, not_full);
+        return values;
+    }
+    bip::scoped_lock<bip::interprocess_mutex> lock(*mutex);
+    size_t count = std::min(static_cast<size_t>(n), my_queue->size());
+    std::vector<MappedType> values;
+    values.reserve(count);
+    auto last = my_queue->begin() + count;
+    for (auto iterator = my_queue->begin(); iterator != last; ++iterator) {
+        values.push_back(std::move(*iterator));
+    }
+    my_queue->erase(my_queue->begin(), last);
+    if (count > 0 && BASKET_CONF->QUEUE_CAPACITY > 0) not_full->notify_all();
+    return values;
+}
+
+/**
+ * Get up to n elements from the queue in a single request. Uses key_int to
+ * decide the server to hash it to.
+ * @param n, the most elements to pop
+ * @param key_int, key_int to know which server
+ * @return a vector of the popped values in queue order, empty if the queue
+ * was empty
+ */
+template<typename MappedType>
+std::vector<MappedType>
+queue<MappedType>::PopN(uint32_t n, uint16_t &key_int) {
+    if (key_int == my_server && server_on_node) {
+        return LocalPopN(n);
+    } else {
+        AutoTrace trace = AutoTrace("basket::queue::PopN(remote)", n, key_int);
+        typedef std::vector<MappedType> ret_type;
+        return RPC_CALL_WRAPPER("_PopN", key_int, ret_type, n);
+    }
+}
+
+/**
+ * Take work from the local queue for another server: half of the elements,
+ * but at most n, from the front.
+ * @param n, the most elements to take
+ * @return a pair of the taken values in queue order and the number of
+ * elements left behind
+ */
+template<typename MappedType>
+std::pair<std::vector<MappedType>, size_t>
+queue<MappedType>::LocalSteal(uint32_t n) {
+    AutoTrace trace = AutoTrace("basket::queue::Steal(local)", n);
+    if (ring != nullptr) {
+        size_t count = std::min(static_cast<size_t>(n), (ring->Size() + 1) / 2);
+        std::vector<MappedType> values;
+        values.reserve(count);
+        auto append = [&values](MappedType &&data) {
+            values.push_back(std::move(data));
+        };
+        while (values.size() < count && ring->TryPopInto(append)) {}
+        if (!values.empty()) NotifyWaiters(space_waiters, not_full);
+        return std::make_pair(std::move(values), ring->Size());
+    }
+    bip::scoped_lock<bip::interprocess_mutex> lock(*mutex);
+    size_t count = std::min(static_cast<size_t>(n), (my_queue->size() + 1) / 2);
+    std::vector<MappedType> values;
+    values.reserve(count);
+    auto last = my_queue->begin() + count;
+    for (auto iterator = my_queue->begin(); iterator != last; ++iterator) {
+        values.push_back(std::move(*iterator));
+    }
+    my_queue->erase(my_queue->begin(), last);
+    if (count > 0 && BASKET_CONF->QUEUE_CAPACITY > 0) not_full->notify_all();
+    return std::make_pair(std::move(values), my_queue->size());
+}
+
+/**
+ * Pop from the home partition of this process, or steal from another server
+ * if it is empty. Victims are tried by the backlog they reported last, the
+ * largest first, and the others in random order. A steal takes up to
+ * STEAL_BATCH elements; the first is returned and the rest is pushed to the
+ * home partition, where it stays visible to all consumers, or back to the
+ * victim if the home partition is full. Pushes follow QUEUE_FULL_POLICY, so
+ * if both partitions are full and pushes fail fast, the rest is kept by
+ * this process and returned by its next PopAny calls before anything else.
+ * @return an Optional holding the value, empty if every server was found
+ * empty
+ */
+template<typename MappedType>
+Optional<MappedType> queue<MappedType>::PopAny() {
+    {
+        std::lock_guard<std::mutex> guard(leftovers_mutex);
+        if (!leftovers.empty()) {
+            Optional<MappedType> value(std::move(leftovers.front()));
+            leftovers.pop_front();
+            return value;
+        }
+    }
+    uint16_t home = my_server;
+    Optional<MappedType> value = Pop(home);
+    if (value) return value;
+    for (uint16_t victim : StealOrder()) {
+        std::pair<std::vector<MappedType>, size_t> stolen =
+                StealFrom(victim, BASKET_CONF->STEAL_BATCH);
+        {
+            std::lock_guard<std::mutex> guard(hints_mutex);
+            size_hints[victim] = stolen.second;
+        }
+        if (stolen.first.empty()) continue;
+        value.emplace(std::move(stolen.first.front()));
+        if (stolen.first.size() > 1) {
+            std::vector<MappedType> rest(std::make_move_iterator(stolen.first.begin() + 1),
+                                         std::make_move_iterator(stolen.first.end()));
+            /* a bounded home partition may have filled up meanwhile */
+            if (!PushN(rest, home) && !PushN(rest, victim)) {
+                std::lock_guard<std::mutex> guard(leftovers_mutex);
+                leftovers.insert(leftovers.end(), std::make_move_iterator(rest.begin()),
+                                 std::make_move_iterator(rest.end()));
+            }
+        }
+        return value;
+    }
+    return value;
+}
+
+/**
+ * Order the servers other than the home one for stealing: those with a
+ * known backlog by size, then the rest shuffled.
+ */
+template<typename MappedType>
+std::vector<uint16_t> queue<MappedType>::StealOrder() {
+    std::vector<uint16_t> victims;
+    victims.reserve(num_servers);
+    for (uint16_t server = 0; server < num_servers; ++server) {
+        if (server != my_server) victims.push_back(server);
+    }
+    std::lock_guard<std::mutex> guard(hints_mutex);
+    std::shuffle(victims.begin(), victims.end(), random);
+    std::stable_sort(victims.begin(), victims.end(),
+                     [this](uint16_t a, uint16_t b) {
+                         return size_hints[a] > size_hints[b];
+                     });
+    return victims;
+}
+
+/**
+ * Steal up to n elements from the queue on key_int.
+ * @return a pair of the taken values and the backlog left on key_int
+ */
+template<typename MappedType>
+std::pair<std::vector<MappedType>, size_t>
+queue<MappedType>::StealFrom(uint16_t key_int, uint32_t n) {
+    if (key_int == my_server && server_on_node) {
+        return LocalSteal(n);
+    } else {
+        AutoTrace trace = AutoTrace("basket::queue::Steal(remote)", n, key_int);
+        typedef std::pair<std::vector<MappedType>, size_t> ret_type;
+        return RPC_CALL_WRAPPER("_Steal", key_int, ret_type, n);
+    }
+}
+
+/**
+ * Block until the local queue holds an element. The caller sleeps on a
+ * condition signalled by LocalPush instead of polling.
+ * @return bool, true once an element is present
+ */
 template<typename MappedType>
 bool queue<MappedType>::LocalWaitForElement() {
     AutoTrace trace = AutoTrace("basket::queue::WaitForElement(local)");
-    int count = 0;
-    while (my_queue->size() == 0) {
-        usleep(10);
-        if (count == 0) printf("Server %d, No Events in Queue\n", my_rank);
-        count++;
+    bip::scoped_lock<bip::interprocess_mutex> lock(*mutex);
+    if (ring != nullptr) {
+        waiters->fetch_add(1);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
     }
+    not_empty->wait(lock, [this]() { return !Empty(); });
+    if (ring != nullptr) waiters->fetch_sub(1);
     return true;
 }
 
+/**
+ * Block until the local queue holds an element or timeout passed.
+ * @param timeout, the longest wait in microseconds
+ * @return bool, true if an element is present, false on timeout
+ */
+template<typename MappedType>
+bool queue<MappedType>::LocalWaitForElementFor(HTime timeout) {
+    AutoTrace trace = AutoTrace("basket::queue::WaitForElementFor(local)", timeout);
+    boost::posix_time::ptime deadline =
+            boost::posix_time::microsec_clock::universal_time() +
+            boost::posix_time::microseconds(timeout);
+    bip::scoped_lock<bip::interprocess_mutex> lock(*mutex);
+    if (ring != nullptr) {
+        waiters->fetch_add(1);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+    bool found = not_empty->timed_wait(lock, deadline, [this]() { return !Empty(); });
+    if (ring != nullptr) waiters->fetch_sub(1);
+    return found;
+}
+
+/**
+ * Serve a remote wait. The request is held for up to timeout only while an
+ * RPC thread can be spared for it, see LongPollLimit; otherwise the queue
+ * is checked once and the answer sent right away.
+ * @param timeout, the longest wait in microseconds
+ * @return bool, true if an element is present, false otherwise
+ */
+template<typename MappedType>
+bool queue<MappedType>::LocalPollForElement(HTime timeout) {
+    LongPollSlot slot(polls);
+    return LocalWaitForElementFor(slot.Timeout(timeout));
+}
+
+/**
+ * Check whether the local queue is empty. The deque needs the mutex held.
+ */
+template<typename MappedType>
+bool queue<MappedType>::Empty() {
+    return ring != nullptr ? ring->Size() == 0 : my_queue->empty();
+}
+
+/**
+ * Count the elements that still fit in the local queue, unbounded if
+ * QUEUE_CAPACITY is not set. The deque needs the mutex held.
+ */
+template<typename MappedType>
+size_t queue<MappedType>::FreeSlots() {
+    if (ring != nullptr) {
+        return ring->Capacity() - std::min(ring->Size(), ring->Capacity());
+    }
+    size_t capacity = BASKET_CONF->QUEUE_CAPACITY;
+    if (capacity == 0) return std::numeric_limits<size_t>::max();
+    return capacity - std::min(my_queue->size(), capacity);
+}
+
+/**
+ * Wake the waiters on condition after a push or pop on the ring backend.
+ * Ring operations skip the mutex unless a waiter registered itself in
+ * count; the fences on both sides make sure either the operation sees the
+ * waiter or the waiter sees the operation.
+ */
+template<typename MappedType>
+void queue<MappedType>::NotifyWaiters(std::atomic<uint32_t> *count,
+                                      bip::interprocess_condition *condition) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (count->load(std::memory_order_relaxed) > 0) {
+        bip::scoped_lock<bip::interprocess_mutex> lock(*mutex);
+        condition->notify_all();
+    }
+}
+
+/**
+ * Wait until the local queue has room for n elements or timeout passed,
+ * and grant credits for the room found. Producers split the free slots, see
+ * CreditGrant.
+ * @param n, the slots the producer needs
+ * @param timeout, the longest wait in microseconds
+ * @return the granted slots, 0 if fewer than n slots were free
+ */
+template<typename MappedType>
+size_t queue<MappedType>::LocalCredits(uint32_t n, HTime timeout) {
+    AutoTrace trace = AutoTrace("basket::queue::Credits(local)", n, timeout);
+    boost::posix_time::ptime deadline =
+            boost::posix_time::microsec_clock::universal_time() +
+            boost::posix_time::microseconds(timeout);
+    bip::scoped_lock<bip::interprocess_mutex> lock(*mutex);
+    if (ring != nullptr) {
+        space_waiters->fetch_add(1);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+    not_full->timed_wait(lock, deadline, [this, n]() { return FreeSlots() >= n; });
+    if (ring != nullptr) space_waiters->fetch_sub(1);
+    return CreditGrant(FreeSlots(), n, comm_size);
+}
+
+/**
+ * Serve a remote credit request, held for up to timeout only while an RPC
+ * thread can be spared for it as in LocalPollForElement.
+ * @return the granted slots, 0 if fewer than n slots were free
+ */
+template<typename MappedType>
+size_t queue<MappedType>::LocalPollCredits(uint32_t n, HTime timeout) {
+    LongPollSlot slot(polls);
+    return LocalCredits(n, slot.Timeout(timeout));
+}
+
+/**
+ * Ask the queue on key_int for credits, held by the server for at most
+ * timeout if it has no room.
+ * @return the granted slots, 0 if fewer than n slots were free
+ */
+template<typename MappedType>
+size_t queue<MappedType>::RequestCredits(uint16_t key_int, uint32_t n, HTime timeout) {
+    return RPC_CALL_WRAPPER("_Credits", key_int, size_t, n, timeout);
+}
+
+/**
+ * Block until the queue on key_int holds an element. Remote waits are long
+ * polls: each request is held by the server for at most LONG_POLL_TIMEOUT
+ * and reissued. A held poll takes up an RPC thread of the server, so at
+ * most RPC_THREADS - 1 are held at once; further waits are answered at once
+ * and retried after a pause, which with a single RPC thread turns every
+ * remote wait into periodic checks.
+ * @param key_int, key_int to know which server
+ * @return bool, true once an element is present
+ */
 template<typename MappedType>
 bool queue<MappedType>::WaitForElement(uint16_t &key_int) {
     if (key_int == my_server && server_on_node) {
@@ -198,10 +662,52 @@ bool queue<MappedType>::WaitForElement(uint16_t &key_int) {
     } else {
         AutoTrace trace = AutoTrace(
             "basket::queue::WaitForElement(remote)", key_int);
-        return RPC_CALL_WRAPPER1("_WaitForElement", key_int, bool);
+        while (!PollForElement(key_int, BASKET_CONF->LONG_POLL_TIMEOUT)) {}
+        return true;
+    }
+}
+
+/**
+ * Block until the queue on key_int holds an element or timeout passed.
+ * Remote waits are split into long polls as in WaitForElement.
+ * @param key_int, key_int to know which server
+ * @param timeout, the longest wait in microseconds
+ * @return bool, true if an element is present, false on timeout
+ */
+template<typename MappedType>
+bool queue<MappedType>::WaitForElementFor(uint16_t &key_int, HTime timeout) {
+    if (key_int == my_server && server_on_node) {
+        return LocalWaitForElementFor(timeout);
+    } else {
+        AutoTrace trace = AutoTrace(
+            "basket::queue::WaitForElementFor(remote)", key_int, timeout);
+        std::chrono::steady_clock::time_point deadline =
+                std::chrono::steady_clock::now() + std::chrono::microseconds(timeout);
+        while (true) {
+            int64_t left = std::chrono::duration_cast<std::chrono::microseconds>(
+                    deadline - std::chrono::steady_clock::now()).count();
+            HTime poll = std::min(static_cast<HTime>(std::max<int64_t>(left, 0)),
+                                  BASKET_CONF->LONG_POLL_TIMEOUT);
+            if (PollForElement(key_int, poll)) return true;
+            if (poll < BASKET_CONF->LONG_POLL_TIMEOUT) return false;
+        }
     }
 }
 
+/**
+ * Issue one remote wait, held by the server for at most timeout. If the
+ * server could not hold it, pause before returning so that the caller does
+ * not retry in a tight loop.
+ * @return bool, true if an element is present, false on timeout
+ */
+template<typename MappedType>
+bool queue<MappedType>::PollForElement(uint16_t key_int, HTime timeout) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    bool found = RPC_CALL_WRAPPER("_WaitForElement", key_int, bool, timeout);
+    if (!found) LongPollBackoff(timeout, start);
+    return found;
+}
+
 /**
  * Get the size of the local queue.
  * @param key_int, key_int to know which server
@@ -210,6 +716,7 @@ bool queue<MappedType>::WaitForElement(uint16_t &key_int) {
 template<typename MappedType>
 size_t queue<MappedType>::LocalSize() {
     AutoTrace trace = AutoTrace("basket::queue::Size(local)");
+    if (ring != nullptr) return ring->Size();
     bip::scoped_lock<bip::interprocess_mutex> lock(*mutex);
     size_t value = my_queue->size();
     return value;
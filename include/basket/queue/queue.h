@@ -28,6 +28,8 @@
 #include <basket/communication/rpc_factory.h>
 #include <basket/common/singleton.h>
 #include <basket/common/debug.h>
+#include <basket/common/ring_buffer.h>
+#include <basket/common/flow_control.h>
 /** MPI Headers**/
 #include <mpi.h>
 /** RPC Lib Headers**/
@@ -46,7 +48,9 @@
 #include <boost/interprocess/containers/deque.hpp>
 #include <boost/interprocess/allocators/allocator.hpp>
 #include <boost/interprocess/sync/interprocess_mutex.hpp>
+#include <boost/interprocess/sync/interprocess_condition.hpp>
 #include <boost/interprocess/sync/scoped_lock.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
 #include <boost/algorithm/string.hpp>
 /** Standard C++ Headers**/
 #include <iostream>
@@ -54,6 +58,14 @@
 #include <utility>
 #include <memory>
 #include <string>
+#include <vector>
+#include <chrono>
+#include <deque>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <random>
+#include <limits>
 #include <boost/interprocess/managed_mapped_file.hpp>
 
 /** Namespaces Uses **/
@@ -86,8 +98,31 @@ class queue {
     std::string name, func_prefix;
     Queue *my_queue;
     boost::interprocess::interprocess_mutex* mutex;
+    boost::interprocess::interprocess_condition* not_empty;
+    boost::interprocess::interprocess_condition* not_full;
+    RingBuffer<MappedType> *ring;
+    std::atomic<uint32_t> *waiters;
+    std::atomic<uint32_t> *space_waiters;
     bool server_on_node;
     CharStruct backed_file;
+    std::vector<size_t> size_hints;
+    std::minstd_rand random;
+    std::mutex hints_mutex;
+    std::deque<MappedType> leftovers;
+    std::mutex leftovers_mutex;
+    CreditTable credits;
+    LongPollLimit polls;
+
+    bool PollForElement(uint16_t key_int, HTime timeout);
+    bool RemotePush(MappedType &data, uint16_t key_int);
+    bool RemotePushN(std::vector<MappedType> &data, uint16_t key_int);
+    size_t RequestCredits(uint16_t key_int, uint32_t n, HTime timeout);
+    bool Empty();
+    size_t FreeSlots();
+    void NotifyWaiters(std::atomic<uint32_t> *count,
+                       boost::interprocess::interprocess_condition *condition);
+    std::pair<std::vector<MappedType>, size_t> StealFrom(uint16_t key_int, uint32_t n);
+    std::vector<uint16_t> StealOrder();
 
   public:
     ~queue();
@@ -95,20 +130,35 @@ class queue {
     explicit queue(std::string name_ = "TEST_QUEUE");
 
     bool LocalPush(MappedType &data);
-    std::pair<bool, MappedType> LocalPop();
+    bool LocalPushN(std::vector<MappedType> &data);
+    Optional<MappedType> LocalPop();
+    std::vector<MappedType> LocalPopN(uint32_t n);
+    std::pair<std::vector<MappedType>, size_t> LocalSteal(uint32_t n);
     bool LocalWaitForElement();
+    bool LocalWaitForElementFor(HTime timeout);
+    bool LocalPollForElement(HTime timeout);
+    size_t LocalCredits(uint32_t n, HTime timeout);
+    size_t LocalPollCredits(uint32_t n, HTime timeout);
     size_t LocalSize();
 
 #if defined(BASKET_ENABLE_THALLIUM_TCP) || defined(BASKET_ENABLE_THALLIUM_ROCE)
     THALLIUM_DEFINE(LocalPush, (data), MappedType &data)
+    THALLIUM_DEFINE(LocalPushN, (data), std::vector<MappedType> &data)
     THALLIUM_DEFINE1(LocalPop)
-    THALLIUM_DEFINE1(LocalWaitForElement)
+    THALLIUM_DEFINE(LocalPopN, (n), uint32_t n)
+    THALLIUM_DEFINE(LocalSteal, (n), uint32_t n)
+    THALLIUM_DEFINE(LocalPollForElement, (timeout), HTime timeout)
+    THALLIUM_DEFINE(LocalPollCredits, (n, timeout), uint32_t n, HTime timeout)
     THALLIUM_DEFINE1(LocalSize)
 #endif    
 
     bool Push(MappedType &data, uint16_t &key_int);
-    std::pair<bool, MappedType> Pop(uint16_t &key_int);
+    bool PushN(std::vector<MappedType> &data, uint16_t &key_int);
+    Optional<MappedType> Pop(uint16_t &key_int);
+    std::vector<MappedType> PopN(uint32_t n, uint16_t &key_int);
+    Optional<MappedType> PopAny();
     bool WaitForElement(uint16_t &key_int);
+    bool WaitForElementFor(uint16_t &key_int, HTime timeout);
     size_t Size(uint16_t &key_int);
 };
 
@@ -24,8 +24,13 @@
 /* Constructor to deallocate the shared memory*/
 template<typename KeyType, typename Compare>
 set<KeyType, Compare>::~set() {
-    if (is_server)
+    if (is_server) {
+        {
+            std::lock_guard<std::mutex> lock(Servers().mutex);
+            Servers().sets.erase(func_prefix.string());
+        }
         boost::interprocess::file_mapping::remove(backed_file.c_str());
+    }
 }
 
 template<typename KeyType, typename Compare>
@@ -35,7 +40,9 @@ set<KeyType, Compare>::set(CharStruct name_)
           comm_size(1), my_rank(0), memory_allocated(BASKET_CONF->MEMORY_ALLOCATED),
           name(name_), segment(), myset(), func_prefix(name_),
           backed_file(BASKET_CONF->BACKED_FILE_DIR + PATH_SEPARATOR + name_+"_"+std::to_string(my_server)),
-          server_on_node(BASKET_CONF->SERVER_ON_NODE) {
+          server_on_node(BASKET_CONF->SERVER_ON_NODE), hot_keys(nullptr), bloom(nullptr),
+          bloom_filters(BASKET_CONF->BLOOM_FILTER_BITS, BASKET_CONF->BLOOM_FILTER_HASHES,
+                        BASKET_CONF->BLOOM_FILTER_REFRESH, BASKET_CONF->NUM_SERVERS) {
     AutoTrace trace = AutoTrace("basket::set");
     /* Initialize MPI rank and size of world */
     MPI_Comm_size(MPI_COMM_WORLD, &comm_size);
@@ -56,6 +63,22 @@ set<KeyType, Compare>::set(CharStruct name_)
         myset = segment.construct<MySet>(name.c_str())(Compare(), alloc_inst);
         mutex = segment.construct<boost::interprocess::interprocess_mutex>(
             "mtx")();
+        /* Construct the hot key sketch if access tracking is enabled. */
+        if (BASKET_CONF->HOT_KEY_CAPACITY > 0) {
+            hot_keys = segment.construct<HotKeySketch<KeyType>>("hot_keys")(
+                BASKET_CONF->HOT_KEY_CAPACITY, segment.get_segment_manager());
+        }
+        /* Construct the Bloom filter clients use to skip absent keys. */
+        if (BASKET_CONF->BLOOM_FILTER_BITS > 0) {
+            bloom = segment.construct<CountingBloomFilter>("bloom_filter")(
+                BASKET_CONF->BLOOM_FILTER_BITS, BASKET_CONF->BLOOM_FILTER_HASHES,
+                segment.get_segment_manager());
+        }
+        /* Let operations on two sets find this one by name. */
+        {
+            std::lock_guard<std::mutex> lock(Servers().mutex);
+            Servers().sets[func_prefix.string()] = this;
+        }
         /* Create a RPC server and map the methods to it. */
         switch (BASKET_CONF->RPC_IMPLEMENTATION) {
 #ifdef BASKET_ENABLE_RPCLIB
@@ -78,6 +101,9 @@ set<KeyType, Compare>::set(CharStruct name_)
                                                        Compare>::LocalContainsInServer, this,
                                                        std::placeholders::_1,
                                                        std::placeholders::_2));
+                std::function<size_t(KeyType &, KeyType &)> countInServerFunc(
+                    std::bind(&set<KeyType, Compare>::LocalCountInServer, this,
+                              std::placeholders::_1, std::placeholders::_2));
                 std::function<std::pair<bool, KeyType>(void)>
                         seekFirstFunc(std::bind(&set<KeyType,
                                                Compare>::LocalSeekFirst, this));
@@ -90,15 +116,43 @@ set<KeyType, Compare>::set(CharStruct name_)
                 std::function<std::pair<bool, std::vector<KeyType>>(uint32_t)> localSeekFirstNFunc(
                         std::bind(&set<KeyType, Compare>::LocalSeekFirstN, this,
                                                       std::placeholders::_1));
+                std::function<std::vector<KeyType>(KeyType &, uint32_t)> seekNextNFunc(
+                    std::bind(&set<KeyType, Compare>::LocalSeekNextN, this,
+                              std::placeholders::_1, std::placeholders::_2));
+                std::function<std::vector<std::pair<KeyType, std::pair<uint64_t, uint64_t>>>(uint32_t)> hotKeysFunc(
+                    std::bind(&set<KeyType, Compare>::LocalHotKeys, this,
+                              std::placeholders::_1));
+                std::function<std::vector<uint64_t>(void)> bloomFilterFunc(
+                    std::bind(&set<KeyType, Compare>::LocalBloomFilter, this));
+                std::function<Optional<size_t>(uint16_t, CharStruct &)> setCountFunc(
+                    std::bind(&set<KeyType, Compare>::LocalSetCount, this,
+                              std::placeholders::_1, std::placeholders::_2));
+                std::function<Optional<std::vector<KeyType>>(uint16_t, CharStruct &,
+                                                             Optional<KeyType> &,
+                                                             uint32_t)> setPageFunc(
+                    std::bind(&set<KeyType, Compare>::LocalSetPage, this,
+                              std::placeholders::_1, std::placeholders::_2,
+                              std::placeholders::_3, std::placeholders::_4));
+                std::function<Optional<size_t>(uint16_t, CharStruct &, CharStruct &)> setStoreFunc(
+                    std::bind(&set<KeyType, Compare>::LocalSetStore, this,
+                              std::placeholders::_1, std::placeholders::_2,
+                              std::placeholders::_3));
                 rpc->bind(func_prefix+"_Put", putFunc);
                 rpc->bind(func_prefix+"_Get", getFunc);
                 rpc->bind(func_prefix+"_Erase", eraseFunc);
                 rpc->bind(func_prefix+"_GetAllData", getAllDataInServerFunc);
+                rpc->bind(func_prefix+"_HotKeys", hotKeysFunc);
+                rpc->bind(func_prefix+"_BloomFilter", bloomFilterFunc);
                 rpc->bind(func_prefix+"_Contains", containsInServerFunc);
+                rpc->bind(func_prefix+"_CountRange", countInServerFunc);
 
                 rpc->bind(func_prefix+"_SeekFirst", seekFirstFunc);
                 rpc->bind(func_prefix+"_PopFirst", popFirstFunc);
                 rpc->bind(func_prefix+"_SeekFirstN", localSeekFirstNFunc);
+                rpc->bind(func_prefix+"_SeekNextN", seekNextNFunc);
+                rpc->bind(func_prefix+"_SetCount", setCountFunc);
+                rpc->bind(func_prefix+"_SetPage", setPageFunc);
+                rpc->bind(func_prefix+"_SetStore", setStoreFunc);
                 rpc->bind(func_prefix+"_Size", sizeFunc);
                 break;
             }
@@ -131,6 +185,10 @@ set<KeyType, Compare>::set(CharStruct name_)
                                                        std::placeholders::_1,
                                                        std::placeholders::_2,
 						       std::placeholders::_3));
+                std::function<void(const tl::request &, KeyType &, KeyType &)> countInServerFunc(
+                    std::bind(&set<KeyType, Compare>::ThalliumLocalCountInServer, this,
+                              std::placeholders::_1, std::placeholders::_2,
+                              std::placeholders::_3));
                 std::function<void(const tl::request &)>
                         seekFirstFunc(std::bind(&set<KeyType,
 						Compare>::ThalliumLocalSeekFirst, this,
@@ -147,15 +205,47 @@ set<KeyType, Compare>::set(CharStruct name_)
                         std::bind(&set<KeyType, Compare>::ThalliumLocalSeekFirstN, this,
 				  std::placeholders::_1,
 				  std::placeholders::_2));
+                std::function<void(const tl::request &, KeyType &, uint32_t)> seekNextNFunc(
+                    std::bind(&set<KeyType, Compare>::ThalliumLocalSeekNextN, this,
+                              std::placeholders::_1, std::placeholders::_2,
+                              std::placeholders::_3));
+                std::function<void(const tl::request &, uint32_t)> hotKeysFunc(
+                    std::bind(&set<KeyType, Compare>::ThalliumLocalHotKeys, this,
+                              std::placeholders::_1, std::placeholders::_2));
+                std::function<void(const tl::request &)> bloomFilterFunc(
+                    std::bind(&set<KeyType, Compare>::ThalliumLocalBloomFilter, this,
+                              std::placeholders::_1));
+                std::function<void(const tl::request &, uint16_t, CharStruct &)> setCountFunc(
+                    std::bind(&set<KeyType, Compare>::ThalliumLocalSetCount, this,
+                              std::placeholders::_1, std::placeholders::_2,
+                              std::placeholders::_3));
+                std::function<void(const tl::request &, uint16_t, CharStruct &,
+                                   Optional<KeyType> &, uint32_t)> setPageFunc(
+                    std::bind(&set<KeyType, Compare>::ThalliumLocalSetPage, this,
+                              std::placeholders::_1, std::placeholders::_2,
+                              std::placeholders::_3, std::placeholders::_4,
+                              std::placeholders::_5));
+                std::function<void(const tl::request &, uint16_t, CharStruct &,
+                                   CharStruct &)> setStoreFunc(
+                    std::bind(&set<KeyType, Compare>::ThalliumLocalSetStore, this,
+                              std::placeholders::_1, std::placeholders::_2,
+                              std::placeholders::_3, std::placeholders::_4));
                 rpc->bind(func_prefix+"_Put", putFunc);
                 rpc->bind(func_prefix+"_Get", getFunc);
                 rpc->bind(func_prefix+"_Erase", eraseFunc);
                 rpc->bind(func_prefix+"_GetAllData", getAllDataInServerFunc);
+                rpc->bind(func_prefix+"_HotKeys", hotKeysFunc);
+                rpc->bind(func_prefix+"_BloomFilter", bloomFilterFunc);
                 rpc->bind(func_prefix+"_Contains", containsInServerFunc);
+                rpc->bind(func_prefix+"_CountRange", countInServerFunc);
 
                 rpc->bind(func_prefix+"_SeekFirst", seekFirstFunc);
                 rpc->bind(func_prefix+"_PopFirst", popFirstFunc);
-                // rpc->bind(func_prefix+"_SeekFirstN", localSeekFirstNFunc);
+                rpc->bind(func_prefix+"_SeekFirstN", localSeekFirstNFunc);
+                rpc->bind(func_prefix+"_SeekNextN", seekNextNFunc);
+                rpc->bind(func_prefix+"_SetCount", setCountFunc);
+                rpc->bind(func_prefix+"_SetPage", setPageFunc);
+                rpc->bind(func_prefix+"_SetStore", setStoreFunc);
                 rpc->bind(func_prefix+"_Size", sizeFunc);
 		break;
                 }
@@ -172,6 +262,8 @@ set<KeyType, Compare>::set(CharStruct name_)
                   boost::interprocess::managed_mapped_file::size_type> res2;
         res2 = segment.find<boost::interprocess::interprocess_mutex>("mtx");
         mutex = res2.first;
+        hot_keys = segment.find<HotKeySketch<KeyType>>("hot_keys").first;
+        bloom = segment.find<CountingBloomFilter>("bloom_filter").first;
     }
 }
 
@@ -184,9 +276,10 @@ set<KeyType, Compare>::set(CharStruct name_)
 template<typename KeyType, typename Compare>
 bool set<KeyType, Compare>::LocalPut(KeyType &key) {
     AutoTrace trace = AutoTrace("basket::set::Put(local)", key);
+    if (hot_keys != nullptr) hot_keys->Record(key, PayloadSize(key));
     boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex> lock(*mutex);
-    myset->insert(key);
-    
+    if (myset->insert(key).second && bloom != nullptr) bloom->Add(keyHash(key));
+
     return true;
 }
 
@@ -204,6 +297,7 @@ bool set<KeyType, Compare>::Put(KeyType &key) {
         return LocalPut(key);
     } else {
         AutoTrace trace = AutoTrace("basket::set::Put(remote)", key);
+        if (bloom_filters.Enabled()) bloom_filters.Add(key_int, key_hash);
         return RPC_CALL_WRAPPER("_Put", key_int, bool, key);
     }
 }
@@ -217,6 +311,7 @@ bool set<KeyType, Compare>::Put(KeyType &key) {
 template<typename KeyType, typename Compare>
 bool set<KeyType, Compare>::LocalGet(KeyType &key) {
     AutoTrace trace = AutoTrace("basket::set::Get(local)", key);
+    if (hot_keys != nullptr) hot_keys->Record(key, PayloadSize(key));
     boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex>
             lock(*mutex);
     typename MySet::iterator iterator = myset->find(key);
@@ -229,6 +324,11 @@ bool set<KeyType, Compare>::LocalGet(KeyType &key) {
 
 /**
  * Get the data in the set. Uses key to decide the server to hash it to,
+ * With BLOOM_FILTER_BITS set, a remote Get is only eventually consistent: a
+ * key another process inserted after this client last fetched the filter
+ * of its server may read as absent for up to BLOOM_FILTER_REFRESH
+ * microseconds. Keys this client put itself are seen at once, and
+ * BLOOM_FILTER_REFRESH 0 makes every remote Get ask the server.
  * @param key, key to get
  * @return return a pair of bool and Value. If bool is true then
  * data was found and is present in value part else bool is set to false
@@ -239,6 +339,8 @@ bool set<KeyType, Compare>::Get(KeyType &key) {
     uint16_t key_int = key_hash % num_servers;
     if (key_int == my_server && server_on_node) {
         return LocalGet(key);
+    } else if (!MayContain(key_int, key_hash)) {
+        return false;
     } else {
         AutoTrace trace = AutoTrace("basket::set::Get(remote)", key);
         typedef bool ret_type;
@@ -249,9 +351,10 @@ bool set<KeyType, Compare>::Get(KeyType &key) {
 template<typename KeyType, typename Compare>
 bool set<KeyType, Compare>::LocalErase(KeyType &key) {
     AutoTrace trace = AutoTrace("basket::set::Erase(local)", key);
+    if (hot_keys != nullptr) hot_keys->Record(key, PayloadSize(key));
     boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex> lock(*mutex);
     size_t s = myset->erase(key);
-    
+    if (s > 0 && bloom != nullptr) bloom->Remove(keyHash(key));
     return s > 0;
 }
 
@@ -292,6 +395,24 @@ set<KeyType, Compare>::Contains(KeyType &key_start, KeyType &key_end) {
     return final_values;
 }
 
+/**
+ * Count the keys in [key_start, key_end] across all servers. Each server
+ * answers with a number instead of the keys Contains would ship.
+ * @return the number of keys in the range
+ */
+template<typename KeyType, typename Compare>
+size_t set<KeyType, Compare>::CountRange(KeyType &key_start, KeyType &key_end) {
+    AutoTrace trace = AutoTrace("basket::set::CountRange", key_start, key_end);
+    size_t total = CountInServer(key_start, key_end);
+    for (int i = 0; i < num_servers; ++i) {
+        if (i != my_server) {
+            typedef size_t ret_type;
+            total += RPC_CALL_WRAPPER("_CountRange", i, ret_type, key_start, key_end);
+        }
+    }
+    return total;
+}
+
 template<typename KeyType, typename Compare>
 std::vector<KeyType> set<KeyType, Compare>::GetAllData() {
     AutoTrace trace = AutoTrace("basket::set::GetAllData");
@@ -314,6 +435,10 @@ std::vector<KeyType> set<KeyType, Compare>::LocalContainsInServer(KeyType &key_s
     std::vector<KeyType> final_values = std::vector<KeyType>();
     {
         boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex> lock(*mutex);
+        /* a roaring partition counts whole words, a tree would walk twice */
+        if constexpr (std::is_same<MySet, RoaringSet<KeyType>>::value) {
+            final_values.reserve(CountInRange(*myset, key_start, key_end));
+        }
         typename MySet::iterator lower_bound;
         size_t size = myset->size();
         if (size == 0) {
@@ -354,6 +479,28 @@ set<KeyType, Compare>::ContainsInServer(KeyType &key_start, KeyType &key_end) {
     }
 }
 
+/**
+ * Count the keys of the local partition in [key_start, key_end] without
+ * copying them out.
+ */
+template<typename KeyType, typename Compare>
+size_t set<KeyType, Compare>::LocalCountInServer(KeyType &key_start, KeyType &key_end) {
+    AutoTrace trace = AutoTrace("basket::set::CountInServer", key_start, key_end);
+    boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex> lock(*mutex);
+    return CountInRange(*myset, key_start, key_end);
+}
+
+template<typename KeyType, typename Compare>
+size_t set<KeyType, Compare>::CountInServer(KeyType &key_start, KeyType &key_end) {
+    if (server_on_node) {
+        return LocalCountInServer(key_start, key_end);
+    } else {
+        typedef size_t ret_type;
+        auto my_server_i = my_server;
+        return RPC_CALL_WRAPPER("_CountRange", my_server_i, ret_type, key_start, key_end);
+    }
+}
+
 template<typename KeyType, typename Compare>
 std::vector<KeyType> set<KeyType, Compare>::LocalGetAllDataInServer() {
     AutoTrace trace = AutoTrace("basket::set::GetAllDataInServer", NULL);
@@ -429,11 +576,337 @@ std::pair<bool, std::vector<KeyType>> set<KeyType, Compare>::SeekFirstN(uint16_t
         return LocalSeekFirstN(n);
     } else {
         AutoTrace trace = AutoTrace("basket::set::SeekFirstN(remote)", key_int,n);
-        typedef std::pair<bool, KeyType> ret_type;
+        typedef std::pair<bool, std::vector<KeyType>> ret_type;
         return RPC_CALL_WRAPPER("_SeekFirstN", key_int, ret_type,n);
     }
 }
 
+/**
+ * Get up to n keys of the local set that follow key, smallest first.
+ * @param key, the key to continue after, it need not be in the set
+ * @param n, the most keys to return
+ */
+template<typename KeyType, typename Compare>
+std::vector<KeyType> set<KeyType, Compare>::LocalSeekNextN(KeyType &key, uint32_t n) {
+    AutoTrace trace = AutoTrace("basket::set::SeekNextN(local)", key, n);
+    bip::scoped_lock<bip::interprocess_mutex> lock(*mutex);
+    std::vector<KeyType> keys;
+    for (auto iterator = myset->upper_bound(key);
+         iterator != myset->end() && keys.size() < n; ++iterator) {
+        keys.push_back(*iterator);
+    }
+    return keys;
+}
+
+/**
+ * Get up to n keys of the set on key_int that follow key, smallest first.
+ * @param key, the key to continue after, it need not be in the set
+ * @param n, the most keys to return
+ * @param key_int, key_int to know which server
+ */
+template<typename KeyType, typename Compare>
+std::vector<KeyType> set<KeyType, Compare>::SeekNextN(KeyType &key, uint32_t n,
+                                                      uint16_t &key_int) {
+    if (key_int == my_server && server_on_node) {
+        return LocalSeekNextN(key, n);
+    } else {
+        AutoTrace trace = AutoTrace("basket::set::SeekNextN(remote)", key, n, key_int);
+        typedef std::vector<KeyType> ret_type;
+        return RPC_CALL_WRAPPER("_SeekNextN", key_int, ret_type, key, n);
+    }
+}
+
+/**
+ * Get one page of a scan of the set on key_int: its first n keys, or the n
+ * keys following after.
+ */
+template<typename KeyType, typename Compare>
+std::vector<KeyType> set<KeyType, Compare>::SeekPage(uint16_t key_int,
+                                                     const Optional<KeyType> &after,
+                                                     uint32_t n) {
+    if (!after) return SeekFirstN(key_int, n).second;
+    KeyType key = *after;
+    return SeekNextN(key, n, key_int);
+}
+
+/**
+ * Get the n smallest keys across all servers. Each server sends at most
+ * SCAN_PAGE_SIZE keys at a time, so only about n keys cross the network.
+ * @param n, the most keys to return
+ * @return a vector of the keys, smallest first
+ */
+template<typename KeyType, typename Compare>
+std::vector<KeyType> set<KeyType, Compare>::GlobalSeekFirstN(uint32_t n) {
+    AutoTrace trace = AutoTrace("basket::set::GlobalSeekFirstN", n);
+    OrderedScan scan(num_servers, std::min(n, BASKET_CONF->SCAN_PAGE_SIZE), Compare(),
+                     [this](uint16_t key_int, const Optional<KeyType> &after, uint32_t page) {
+                         return SeekPage(key_int, after, page);
+                     });
+    return scan.NextN(n);
+}
+
+/**
+ * Iterate over all keys of the set in global order. The scan pulls
+ * SCAN_PAGE_SIZE keys from a server whenever it ran out of keys of it, and
+ * sees the keys a server holds at the time the page is pulled.
+ * @return the scan, call Next or NextN on it
+ */
+template<typename KeyType, typename Compare>
+typename set<KeyType, Compare>::OrderedScan set<KeyType, Compare>::Scan() {
+    return OrderedScan(num_servers, BASKET_CONF->SCAN_PAGE_SIZE, Compare(),
+                       [this](uint16_t key_int, const Optional<KeyType> &after, uint32_t page) {
+                           return SeekPage(key_int, after, page);
+                       });
+}
+
+template<typename KeyType, typename Compare>
+typename set<KeyType, Compare>::Registry &set<KeyType, Compare>::Servers() {
+    static Registry registry;
+    return registry;
+}
+
+/**
+ * Find the set named set_name this process serves.
+ * @return the set, nullptr if this process does not serve it
+ */
+template<typename KeyType, typename Compare>
+set<KeyType, Compare> *set<KeyType, Compare>::FindServer(const CharStruct &set_name) {
+    std::lock_guard<std::mutex> lock(Servers().mutex);
+    auto iterator = Servers().sets.find(set_name.string());
+    return iterator == Servers().sets.end() ? nullptr : iterator->second;
+}
+
+/**
+ * Walk the keys of op on the local partitions of this set and other that
+ * follow after, smallest first. Both sets use the same partitioner, so the
+ * keys the local partitions hold are the only ones they can share. The two
+ * mutexes are taken in order of the set names, so walks over a and b and
+ * over b and a cannot deadlock in any process.
+ * @param visit, callable (key) returning false to stop the walk
+ */
+template<typename KeyType, typename Compare>
+template<typename Visit>
+void set<KeyType, Compare>::Walk(SetOperation op, set &other, const Optional<KeyType> &after,
+                                 Visit visit) {
+    bip::interprocess_mutex *first = mutex, *second = other.mutex;
+    if (other.func_prefix < func_prefix) std::swap(first, second);
+    bip::scoped_lock<bip::interprocess_mutex> first_lock(*first);
+    bip::scoped_lock<bip::interprocess_mutex> second_lock(*second, bip::defer_lock);
+    if (second != first) second_lock.lock();
+    typename MySet::iterator mine = after ? myset->upper_bound(*after) : myset->begin();
+    typename MySet::iterator theirs = after ? other.myset->upper_bound(*after)
+                                            : other.myset->begin();
+    SetMergeWalk(op, mine, myset->end(), theirs, other.myset->end(), Compare(), visit);
+}
+
+template<typename KeyType, typename Compare>
+size_t set<KeyType, Compare>::CountWith(SetOperation op, set &other) {
+    size_t count = 0;
+    Walk(op, other, Optional<KeyType>(), [&count](const KeyType &) {
+        ++count;
+        return true;
+    });
+    return count;
+}
+
+template<typename KeyType, typename Compare>
+std::vector<KeyType> set<KeyType, Compare>::PageWith(SetOperation op, set &other,
+                                                     const Optional<KeyType> &after,
+                                                     uint32_t n) {
+    std::vector<KeyType> keys;
+    if (n == 0) return keys;
+    Walk(op, other, after, [&keys, n](const KeyType &key) {
+        keys.push_back(key);
+        return keys.size() < n;
+    });
+    return keys;
+}
+
+/**
+ * Insert the keys of op on the local partitions of this set and other into
+ * the local partition of target. The keys are collected before target is
+ * locked, so target may be this set or other.
+ * @return the number of keys of the result
+ */
+template<typename KeyType, typename Compare>
+size_t set<KeyType, Compare>::StoreWith(SetOperation op, set &other, set &target) {
+    std::vector<KeyType> keys = PageWith(op, other, Optional<KeyType>(),
+                                         std::numeric_limits<uint32_t>::max());
+    bip::scoped_lock<bip::interprocess_mutex> lock(*target.mutex);
+    for (auto &key : keys) {
+        if (target.myset->insert(key).second && target.bloom != nullptr) {
+            target.bloom->Add(keyHash(key));
+        }
+    }
+    return keys.size();
+}
+
+/**
+ * Count the keys of op on the local partitions of this set and the set
+ * named other.
+ * @return an Optional holding the count, empty if this process does not
+ * serve other
+ */
+template<typename KeyType, typename Compare>
+Optional<size_t> set<KeyType, Compare>::LocalSetCount(uint16_t op, CharStruct &other) {
+    AutoTrace trace = AutoTrace("basket::set::SetCount(local)", op, other);
+    set *other_set = FindServer(other);
+    if (other_set == nullptr) return Optional<size_t>();
+    return Optional<size_t>(CountWith(static_cast<SetOperation>(op), *other_set));
+}
+
+/**
+ * Get up to n keys of op on the local partitions of this set and the set
+ * named other that follow after, smallest first.
+ * @return an Optional holding the keys, empty if this process does not
+ * serve other
+ */
+template<typename KeyType, typename Compare>
+Optional<std::vector<KeyType>> set<KeyType, Compare>::LocalSetPage(uint16_t op,
+                                                                   CharStruct &other,
+                                                                   Optional<KeyType> &after,
+                                                                   uint32_t n) {
+    AutoTrace trace = AutoTrace("basket::set::SetPage(local)", op, other, n);
+    set *other_set = FindServer(other);
+    if (other_set == nullptr) return Optional<std::vector<KeyType>>();
+    return Optional<std::vector<KeyType>>(
+        PageWith(static_cast<SetOperation>(op), *other_set, after, n));
+}
+
+/**
+ * Store the keys of op on the local partitions of this set and the set
+ * named other in the local partition of the set named target.
+ * @return an Optional holding the number of keys of the result, empty if
+ * this process does not serve other or target
+ */
+template<typename KeyType, typename Compare>
+Optional<size_t> set<KeyType, Compare>::LocalSetStore(uint16_t op, CharStruct &other,
+                                                      CharStruct &target) {
+    AutoTrace trace = AutoTrace("basket::set::SetStore(local)", op, other, target);
+    set *other_set = FindServer(other);
+    set *target_set = FindServer(target);
+    if (other_set == nullptr || target_set == nullptr) return Optional<size_t>();
+    return Optional<size_t>(StoreWith(static_cast<SetOperation>(op), *other_set, *target_set));
+}
+
+/**
+ * Unwrap the answer of a server to a set operation. A server that does not
+ * serve one of the sets answers with an empty Optional; taking that as an
+ * empty part would make unions and differences silently wrong.
+ * @throw std::invalid_argument if answer is empty
+ */
+template<typename KeyType, typename Compare>
+template<typename T>
+T set<KeyType, Compare>::Served(Optional<T> &&answer, uint16_t key_int) {
+    if (!answer) {
+        throw std::invalid_argument("basket::set: server " + std::to_string(key_int) +
+                                    " does not serve every set of the operation");
+    }
+    return std::move(*answer);
+}
+
+template<typename KeyType, typename Compare>
+std::vector<KeyType> set<KeyType, Compare>::SetPage(SetOperation op, set &other,
+                                                    uint16_t key_int,
+                                                    const Optional<KeyType> &after,
+                                                    uint32_t n) {
+    if (key_int == my_server && server_on_node) {
+        return PageWith(op, other, after, n);
+    } else {
+        AutoTrace trace = AutoTrace("basket::set::SetPage(remote)", key_int, n);
+        typedef Optional<std::vector<KeyType>> ret_type;
+        uint16_t op_int = op;
+        Optional<KeyType> after_key = after;
+        ret_type page = RPC_CALL_WRAPPER("_SetPage", key_int, ret_type, op_int,
+                                         other.func_prefix, after_key, n);
+        return Served(std::move(page), key_int);
+    }
+}
+
+/**
+ * Count the keys of op on this set and other without moving any key. Both
+ * sets must have the same KeyType and be served by the same servers, every
+ * server then counts the result on its own partitions.
+ * @param op, the operation, for SET_DIFFERENCE the keys of this set not in
+ * other
+ * @return the number of keys of the result
+ * @throw std::invalid_argument if a server does not serve other
+ */
+template<typename KeyType, typename Compare>
+size_t set<KeyType, Compare>::Count(SetOperation op, set &other) {
+    AutoTrace trace = AutoTrace("basket::set::Count", op);
+    size_t count = 0;
+    for (uint16_t key_int = 0; key_int < num_servers; ++key_int) {
+        if (key_int == my_server && server_on_node) {
+            count += CountWith(op, other);
+        } else {
+            typedef Optional<size_t> ret_type;
+            uint16_t op_int = op;
+            ret_type server_count = RPC_CALL_WRAPPER("_SetCount", key_int, ret_type, op_int,
+                                                     other.func_prefix);
+            count += Served(std::move(server_count), key_int);
+        }
+    }
+    return count;
+}
+
+/**
+ * Iterate over the keys of op on this set and other in global order. Every
+ * server computes its part of the result with a merge walk over its two
+ * partitions and sends SCAN_PAGE_SIZE keys at a time.
+ * @return the scan, call Next or NextN on it, they throw
+ * std::invalid_argument if a server does not serve other
+ */
+template<typename KeyType, typename Compare>
+typename set<KeyType, Compare>::OrderedScan set<KeyType, Compare>::Scan(SetOperation op,
+                                                                        set &other) {
+    return OrderedScan(num_servers, BASKET_CONF->SCAN_PAGE_SIZE, Compare(),
+                       [this, op, &other](uint16_t key_int, const Optional<KeyType> &after,
+                                          uint32_t page) {
+                           return SetPage(op, other, key_int, after, page);
+                       });
+}
+
+/**
+ * Store the keys of op on this set and other in target. No key leaves the
+ * servers: every server inserts its part of the result into its partition
+ * of target, which must use the same servers as well.
+ * @return the number of keys of the result
+ * @throw std::invalid_argument if a server does not serve other or target
+ */
+template<typename KeyType, typename Compare>
+size_t set<KeyType, Compare>::Store(SetOperation op, set &other, set &target) {
+    AutoTrace trace = AutoTrace("basket::set::Store", op);
+    size_t count = 0;
+    for (uint16_t key_int = 0; key_int < num_servers; ++key_int) {
+        if (key_int == my_server && server_on_node) {
+            count += StoreWith(op, other, target);
+        } else {
+            typedef Optional<size_t> ret_type;
+            uint16_t op_int = op;
+            ret_type server_count = RPC_CALL_WRAPPER("_SetStore", key_int, ret_type, op_int,
+                                                     other.func_prefix, target.func_prefix);
+            count += Served(std::move(server_count), key_int);
+        }
+    }
+    return count;
+}
+
+template<typename KeyType, typename Compare>
+std::vector<KeyType> set<KeyType, Compare>::Intersect(set &other) {
+    return Scan(SET_INTERSECTION, other).NextN(std::numeric_limits<size_t>::max());
+}
+
+template<typename KeyType, typename Compare>
+std::vector<KeyType> set<KeyType, Compare>::Union(set &other) {
+    return Scan(SET_UNION, other).NextN(std::numeric_limits<size_t>::max());
+}
+
+template<typename KeyType, typename Compare>
+std::vector<KeyType> set<KeyType, Compare>::Difference(set &other) {
+    return Scan(SET_DIFFERENCE, other).NextN(std::numeric_limits<size_t>::max());
+}
+
 template<typename KeyType, typename Compare>
 std::pair<bool, KeyType> set<KeyType, Compare>::LocalPopFirst() {
     AutoTrace trace = AutoTrace("basket::set::PopFirst(local)");
@@ -442,6 +915,7 @@ std::pair<bool, KeyType> set<KeyType, Compare>::LocalPopFirst() {
         auto iterator = myset->begin();  // We want First (smallest) value in set
         KeyType value = *iterator;
         myset->erase(iterator);
+        if (bloom != nullptr) bloom->Remove(keyHash(value));
         return std::pair<bool, KeyType>(true, value);
     }
     return std::pair<bool, KeyType>(false, KeyType());
@@ -475,4 +949,64 @@ size_t set<KeyType, Compare>::Size(uint16_t &key_int) {
         return RPC_CALL_WRAPPER1("_Size", key_int, ret_type);
     }
 }
+
+/**
+ * Get the hottest keys of the local partition.
+ * @param k, number of keys to return
+ * @return a vector of key and (estimated hits, estimated bytes) pairs, the
+ * hottest first. Empty if HOT_KEY_CAPACITY is 0.
+ */
+template<typename KeyType, typename Compare>
+std::vector<std::pair<KeyType, std::pair<uint64_t, uint64_t>>>
+set<KeyType, Compare>::LocalHotKeys(uint32_t k) {
+    AutoTrace trace = AutoTrace("basket::set::HotKeys(local)", k);
+    if (hot_keys == nullptr) return std::vector<std::pair<KeyType, std::pair<uint64_t, uint64_t>>>();
+    return hot_keys->Top(k);
+}
+
+/**
+ * Get the hottest keys of a server partition.
+ * @param server, the server to query
+ * @param k, number of keys to return
+ * @return a vector of key and (estimated hits, estimated bytes) pairs, the
+ * hottest first.
+ */
+template<typename KeyType, typename Compare>
+std::vector<std::pair<KeyType, std::pair<uint64_t, uint64_t>>>
+set<KeyType, Compare>::HotKeys(uint16_t server, uint32_t k) {
+    if (server == my_server && server_on_node) {
+        return LocalHotKeys(k);
+    } else {
+        AutoTrace trace = AutoTrace("basket::set::HotKeys(remote)", server, k);
+        typedef std::vector<std::pair<KeyType, std::pair<uint64_t, uint64_t>>> ret_type;
+        return RPC_CALL_WRAPPER("_HotKeys", server, ret_type, k);
+    }
+}
+
+/**
+ * Get the Bloom filter of the local partition as a bit array.
+ * @return the words of the bit array, empty if the filter is disabled
+ */
+template<typename KeyType, typename Compare>
+std::vector<uint64_t> set<KeyType, Compare>::LocalBloomFilter() {
+    AutoTrace trace = AutoTrace("basket::set::BloomFilter(local)");
+    if (bloom == nullptr) return std::vector<uint64_t>();
+    boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex> lock(*mutex);
+    return bloom->Snapshot();
+}
+
+/**
+ * Check the snapshot of the Bloom filter of server for a key, refreshing the
+ * snapshot every BLOOM_FILTER_REFRESH.
+ * @return false if the key is absent from the snapshot, true otherwise
+ */
+template<typename KeyType, typename Compare>
+bool set<KeyType, Compare>::MayContain(uint16_t server, size_t key_hash) {
+    if (!bloom_filters.Enabled()) return true;
+    return bloom_filters.MayContain(server, key_hash, [&]() {
+        AutoTrace trace = AutoTrace("basket::set::BloomFilter(remote)", server);
+        typedef std::vector<uint64_t> ret_type;
+        return RPC_CALL_WRAPPER1("_BloomFilter", server, ret_type);
+    });
+}
 #endif  // INCLUDE_BASKET_SET_SET_CPP_
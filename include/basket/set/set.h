@@ -28,6 +28,11 @@
 #include <basket/communication/rpc_lib.h>
 #include <basket/common/singleton.h>
 #include <basket/common/debug.h>
+#include <basket/common/hot_key_sketch.h>
+#include <basket/common/bloom_filter.h>
+#include <basket/common/kway_merge.h>
+#include <basket/common/set_algebra.h>
+#include <basket/common/roaring_set.h>
 #include <basket/communication/rpc_factory.h>
 /** MPI Headers**/
 #include <mpi.h>
@@ -57,6 +62,10 @@
 #include <string>
 #include <set>
 #include <vector>
+#include <mutex>
+#include <unordered_map>
+#include <limits>
+#include <stdexcept>
 #include <boost/interprocess/managed_mapped_file.hpp>
 
 namespace basket {
@@ -71,12 +80,11 @@ template<typename KeyType, typename Compare =
          std::less<KeyType>>
 class set {
   private:
-    std::hash<KeyType> keyHash;
+    basket::hash<KeyType> keyHash;
     /** Class Typedefs for ease of use **/
     typedef boost::interprocess::allocator<KeyType, boost::interprocess::managed_mapped_file::segment_manager>
     ShmemAllocator;
-    typedef boost::interprocess::set<KeyType, Compare, ShmemAllocator>
-    MySet;
+    typedef SetContainer<KeyType, Compare, ShmemAllocator> MySet;
     /** Class attributes**/
     int comm_size, my_rank, num_servers;
     uint16_t  my_server;
@@ -89,8 +97,34 @@ class set {
     boost::interprocess::interprocess_mutex* mutex;
     bool server_on_node;
     CharStruct backed_file;
+    HotKeySketch<KeyType> *hot_keys;
+    CountingBloomFilter *bloom;
+    BloomFilterCache bloom_filters;
+
+    bool MayContain(uint16_t server, size_t key_hash);
+    std::vector<KeyType> SeekPage(uint16_t key_int, const Optional<KeyType> &after, uint32_t n);
+
+    /* the servers of this process by name, to find the other set of an operation */
+    struct Registry {
+        std::mutex mutex;
+        std::unordered_map<std::string, set *> sets;
+    };
+    static Registry &Servers();
+    static set *FindServer(const CharStruct &set_name);
+    template<typename Visit>
+    void Walk(SetOperation op, set &other, const Optional<KeyType> &after, Visit visit);
+    size_t CountWith(SetOperation op, set &other);
+    std::vector<KeyType> PageWith(SetOperation op, set &other, const Optional<KeyType> &after,
+                                  uint32_t n);
+    size_t StoreWith(SetOperation op, set &other, set &target);
+    std::vector<KeyType> SetPage(SetOperation op, set &other, uint16_t key_int,
+                                 const Optional<KeyType> &after, uint32_t n);
+    template<typename T>
+    static T Served(Optional<T> &&answer, uint16_t key_int);
 
   public:
+    typedef KWayMerge<KeyType, Compare> OrderedScan;
+
     ~set();
 
     explicit set(CharStruct name_ = std::string("TEST_SET"));
@@ -99,11 +133,19 @@ class set {
     bool LocalGet(KeyType &key);
     bool LocalErase(KeyType &key);
     std::vector<KeyType> LocalGetAllDataInServer();
+    std::vector<std::pair<KeyType, std::pair<uint64_t, uint64_t>>> LocalHotKeys(uint32_t k);
     std::vector<KeyType> LocalContainsInServer(KeyType &key_start, KeyType &key_end);
+    size_t LocalCountInServer(KeyType &key_start, KeyType &key_end);
     std::pair<bool, KeyType> LocalSeekFirst();
     std::pair<bool, KeyType> LocalPopFirst();
     size_t LocalSize();
     std::pair<bool, std::vector<KeyType>> LocalSeekFirstN(uint32_t n);
+    std::vector<KeyType> LocalSeekNextN(KeyType &key, uint32_t n);
+    std::vector<uint64_t> LocalBloomFilter();
+    Optional<size_t> LocalSetCount(uint16_t op, CharStruct &other);
+    Optional<std::vector<KeyType>> LocalSetPage(uint16_t op, CharStruct &other,
+                                                Optional<KeyType> &after, uint32_t n);
+    Optional<size_t> LocalSetStore(uint16_t op, CharStruct &other, CharStruct &target);
 
 
 #if defined(BASKET_ENABLE_THALLIUM_TCP) || defined(BASKET_ENABLE_THALLIUM_ROCE)
@@ -112,12 +154,22 @@ class set {
     THALLIUM_DEFINE(LocalErase, (key), KeyType &key)
     THALLIUM_DEFINE(LocalContainsInServer, (key_start, key_end), KeyType &key_start,
 		    KeyType &key_end)
+    THALLIUM_DEFINE(LocalCountInServer, (key_start, key_end), KeyType &key_start,
+                    KeyType &key_end)
     THALLIUM_DEFINE(LocalSeekFirstN, (n), uint32_t n)
+    THALLIUM_DEFINE(LocalSeekNextN, (key, n), KeyType &key, uint32_t n)
+    THALLIUM_DEFINE(LocalSetCount, (op, other), uint16_t op, CharStruct &other)
+    THALLIUM_DEFINE(LocalSetPage, (op, other, after, n), uint16_t op, CharStruct &other,
+                    Optional<KeyType> &after, uint32_t n)
+    THALLIUM_DEFINE(LocalSetStore, (op, other, target), uint16_t op, CharStruct &other,
+                    CharStruct &target)
 
     THALLIUM_DEFINE1(LocalSize)
     THALLIUM_DEFINE1(LocalSeekFirst)
     THALLIUM_DEFINE1(LocalPopFirst)
     THALLIUM_DEFINE1(LocalGetAllDataInServer)
+    THALLIUM_DEFINE(LocalHotKeys, (k), uint32_t k)
+    THALLIUM_DEFINE1(LocalBloomFilter)
 #endif
     
     bool Put(KeyType &key);
@@ -125,14 +177,26 @@ class set {
 
     bool Erase(KeyType &key);
     std::vector<KeyType> Contains(KeyType &key_start,KeyType &key_end);
+    size_t CountRange(KeyType &key_start, KeyType &key_end);
 
     std::vector<KeyType> GetAllData();
 
     std::vector<KeyType> ContainsInServer(KeyType &key_start,KeyType &key_end);
+    size_t CountInServer(KeyType &key_start, KeyType &key_end);
     std::vector<KeyType> GetAllDataInServer();
+    std::vector<std::pair<KeyType, std::pair<uint64_t, uint64_t>>> HotKeys(uint16_t server, uint32_t k);
     std::pair<bool, KeyType> SeekFirst(uint16_t &key_int);
     std::pair<bool, KeyType> PopFirst(uint16_t &key_int);
     std::pair<bool, std::vector<KeyType>> SeekFirstN(uint16_t &key_int,uint32_t n);
+    std::vector<KeyType> SeekNextN(KeyType &key, uint32_t n, uint16_t &key_int);
+    std::vector<KeyType> GlobalSeekFirstN(uint32_t n);
+    OrderedScan Scan();
+    size_t Count(SetOperation op, set &other);
+    OrderedScan Scan(SetOperation op, set &other);
+    size_t Store(SetOperation op, set &other, set &target);
+    std::vector<KeyType> Intersect(set &other);
+    std::vector<KeyType> Union(set &other);
+    std::vector<KeyType> Difference(set &other);
     size_t Size(uint16_t &key_int);
 };
 
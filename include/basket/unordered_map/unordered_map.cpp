@@ -25,6 +25,14 @@
 /* Constructor to deallocate the shared memory*/
 template<typename KeyType, typename MappedType>
 unordered_map<KeyType, MappedType>::~unordered_map() {
+    if (sweeper.joinable()) {
+        {
+            std::lock_guard<std::mutex> guard(sweeper_mutex);
+            sweeper_stop = true;
+        }
+        sweeper_condition.notify_all();
+        sweeper.join();
+    }
     if (is_server) {
         boost::interprocess::file_mapping::remove(backed_file.c_str());
     }
@@ -37,7 +45,12 @@ unordered_map<KeyType, MappedType>::unordered_map(CharStruct name_)
           comm_size(1), my_rank(0), memory_allocated(BASKET_CONF->MEMORY_ALLOCATED),
           name(name_), segment(), myHashMap(), func_prefix(name_),
           backed_file(BASKET_CONF->BACKED_FILE_DIR + PATH_SEPARATOR + name_+"_"+std::to_string(my_server)),
-          server_on_node(BASKET_CONF->SERVER_ON_NODE) {
+          server_on_node(BASKET_CONF->SERVER_ON_NODE), leases(nullptr),
+          cache(BASKET_CONF->CLIENT_CACHE_SIZE), hot_keys(nullptr), clock(nullptr),
+          sweeper(), sweeper_mutex(), sweeper_condition(), sweeper_stop(false),
+          bloom(nullptr),
+          bloom_filters(BASKET_CONF->BLOOM_FILTER_BITS, BASKET_CONF->BLOOM_FILTER_HASHES,
+                        BASKET_CONF->BLOOM_FILTER_REFRESH, BASKET_CONF->NUM_SERVERS) {
     // init my_server, num_servers, server_on_node, processor_name from RPC
     AutoTrace trace = AutoTrace("basket::unordered_map");
 
@@ -55,11 +68,35 @@ unordered_map<KeyType, MappedType>::unordered_map(CharStruct name_)
         boost::interprocess::file_mapping::remove(backed_file.c_str());
         /* allocate new shared memory space */
         segment = boost::interprocess::managed_mapped_file(boost::interprocess::create_only, backed_file.c_str(), memory_allocated);
-        mutex = segment.construct<boost::interprocess::interprocess_mutex>( "mtx")();
+        mutex = segment.construct<boost::interprocess::interprocess_sharable_mutex>( "mtx")();
         /* Construct unordered_map in the shared memory space. */
         myHashMap = segment.construct<MyHashMap>(name.c_str())(
-            128, std::hash<KeyType>(), std::equal_to<KeyType>(),
+            128, basket::hash<KeyType>(), std::equal_to<KeyType>(),
             segment.get_allocator<ValueType>());
+        /* Construct the lease table if clients may cache our values. */
+        if (BASKET_CONF->CLIENT_CACHE_SIZE > 0 && BASKET_CONF->CLIENT_CACHE_LEASE > 0) {
+            leases = segment.construct<LeaseTable<KeyType>>("leases")(
+                BASKET_CONF->CLIENT_CACHE_LEASE, segment.get_segment_manager());
+        }
+        /* Construct the hot key sketch if access tracking is enabled. */
+        if (BASKET_CONF->HOT_KEY_CAPACITY > 0) {
+            hot_keys = segment.construct<HotKeySketch<KeyType>>("hot_keys")(
+                BASKET_CONF->HOT_KEY_CAPACITY, segment.get_segment_manager());
+        }
+        /* Construct the clock table if the map is used as a cache. */
+        if (BASKET_CONF->CACHE_MODE) {
+            clock = segment.construct<ClockTable<KeyType>>("cache_clock")(
+                segment.get_segment_manager());
+            if (BASKET_CONF->CACHE_SWEEP_INTERVAL > 0) {
+                sweeper = std::thread(&unordered_map<KeyType, MappedType>::Sweep, this);
+            }
+        }
+        /* Construct the Bloom filter clients use to skip absent keys. */
+        if (BASKET_CONF->BLOOM_FILTER_BITS > 0) {
+            bloom = segment.construct<CountingBloomFilter>("bloom_filter")(
+                BASKET_CONF->BLOOM_FILTER_BITS, BASKET_CONF->BLOOM_FILTER_HASHES,
+                segment.get_segment_manager());
+        }
         /* Create a RPC server and map the methods to it. */
   switch (BASKET_CONF->RPC_IMPLEMENTATION) {
 #ifdef BASKET_ENABLE_RPCLIB
@@ -67,20 +104,46 @@ unordered_map<KeyType, MappedType>::unordered_map(CharStruct name_)
         std::function<bool(KeyType &, MappedType &)> putFunc(
             std::bind(&unordered_map<KeyType, MappedType>::LocalPut, this,
                       std::placeholders::_1, std::placeholders::_2));
-        std::function<std::pair<bool, MappedType>(KeyType &)> getFunc(
+        std::function<Optional<MappedType>(KeyType &)> getFunc(
             std::bind(&unordered_map<KeyType, MappedType>::LocalGet, this,
                       std::placeholders::_1));
-        std::function<std::pair<bool, MappedType>(KeyType &)> eraseFunc(
+        std::function<bool(KeyType &)> eraseFunc(
             std::bind(&unordered_map<KeyType, MappedType>::LocalErase, this,
                       std::placeholders::_1));
+        std::function<std::pair<Optional<MappedType>, HTime>(KeyType &)>
+                getWithLeaseFunc(std::bind(
+                    &unordered_map<KeyType, MappedType>::LocalGetWithLease, this,
+                    std::placeholders::_1));
         std::function<std::vector<std::pair<KeyType, MappedType>>(void)>
                 getAllDataInServerFunc(std::bind(
                     &unordered_map<KeyType, MappedType>::LocalGetAllDataInServer,
                     this));
+        std::function<std::vector<std::pair<KeyType, std::pair<uint64_t, uint64_t>>>(uint32_t)> hotKeysFunc(
+            std::bind(&unordered_map<KeyType, MappedType>::LocalHotKeys, this,
+                      std::placeholders::_1));
+        std::function<bool(KeyType &, MappedType &, HTime)> putWithTTLFunc(
+            std::bind(&unordered_map<KeyType, MappedType>::LocalPutWithTTL, this,
+                      std::placeholders::_1, std::placeholders::_2,
+                      std::placeholders::_3));
+        std::function<bool(KeyType &, MappedType &)> putIfAbsentFunc(
+            std::bind(&unordered_map<KeyType, MappedType>::LocalPutIfAbsent, this,
+                      std::placeholders::_1, std::placeholders::_2));
+        std::function<bool(KeyType &, MappedType &, MappedType &)> compareAndSwapFunc(
+            std::bind(&unordered_map<KeyType, MappedType>::LocalCompareAndSwap, this,
+                      std::placeholders::_1, std::placeholders::_2,
+                      std::placeholders::_3));
+        std::function<std::vector<uint64_t>(void)> bloomFilterFunc(
+            std::bind(&unordered_map<KeyType, MappedType>::LocalBloomFilter, this));
         rpc->bind(func_prefix+"_Put", putFunc);
+        rpc->bind(func_prefix+"_PutWithTTL", putWithTTLFunc);
+        rpc->bind(func_prefix+"_PutIfAbsent", putIfAbsentFunc);
+        rpc->bind(func_prefix+"_CompareAndSwap", compareAndSwapFunc);
         rpc->bind(func_prefix+"_Get", getFunc);
         rpc->bind(func_prefix+"_Erase", eraseFunc);
+        rpc->bind(func_prefix+"_GetWithLease", getWithLeaseFunc);
         rpc->bind(func_prefix+"_GetAllData", getAllDataInServerFunc);
+        rpc->bind(func_prefix+"_HotKeys", hotKeysFunc);
+        rpc->bind(func_prefix+"_BloomFilter", bloomFilterFunc);
 	break;
   }
 #endif
@@ -107,15 +170,43 @@ unordered_map<KeyType, MappedType>::unordered_map(CharStruct name_)
         std::function<void(const tl::request &, KeyType &)> eraseFunc(
             std::bind(&unordered_map<KeyType, MappedType>::ThalliumLocalErase, this,
                       std::placeholders::_1, std::placeholders::_2));
+        std::function<void(const tl::request &, KeyType &)> getWithLeaseFunc(
+            std::bind(&unordered_map<KeyType, MappedType>::ThalliumLocalGetWithLease, this,
+                      std::placeholders::_1, std::placeholders::_2));
         std::function<void(const tl::request &)>
                 getAllDataInServerFunc(std::bind(
                     &unordered_map<KeyType, MappedType>::ThalliumLocalGetAllDataInServer,
                     this, std::placeholders::_1));
 
+        std::function<void(const tl::request &, uint32_t)> hotKeysFunc(
+            std::bind(&unordered_map<KeyType, MappedType>::ThalliumLocalHotKeys, this,
+                      std::placeholders::_1, std::placeholders::_2));
+        std::function<void(const tl::request &, KeyType &, MappedType &, HTime)> putWithTTLFunc(
+            std::bind(&unordered_map<KeyType, MappedType>::ThalliumLocalPutWithTTL, this,
+                      std::placeholders::_1, std::placeholders::_2,
+                      std::placeholders::_3, std::placeholders::_4));
+        std::function<void(const tl::request &, KeyType &, MappedType &)> putIfAbsentFunc(
+            std::bind(&unordered_map<KeyType, MappedType>::ThalliumLocalPutIfAbsent, this,
+                      std::placeholders::_1, std::placeholders::_2,
+                      std::placeholders::_3));
+        std::function<void(const tl::request &, KeyType &, MappedType &, MappedType &)>
+                compareAndSwapFunc(std::bind(
+                    &unordered_map<KeyType, MappedType>::ThalliumLocalCompareAndSwap, this,
+                    std::placeholders::_1, std::placeholders::_2,
+                    std::placeholders::_3, std::placeholders::_4));
+        std::function<void(const tl::request &)> bloomFilterFunc(
+            std::bind(&unordered_map<KeyType, MappedType>::ThalliumLocalBloomFilter, this,
+                      std::placeholders::_1));
         rpc->bind(func_prefix+"_Put", putFunc);
+        rpc->bind(func_prefix+"_PutWithTTL", putWithTTLFunc);
+        rpc->bind(func_prefix+"_PutIfAbsent", putIfAbsentFunc);
+        rpc->bind(func_prefix+"_CompareAndSwap", compareAndSwapFunc);
         rpc->bind(func_prefix+"_Get", getFunc);
         rpc->bind(func_prefix+"_Erase", eraseFunc);
+        rpc->bind(func_prefix+"_GetWithLease", getWithLeaseFunc);
         rpc->bind(func_prefix+"_GetAllData", getAllDataInServerFunc);
+        rpc->bind(func_prefix+"_HotKeys", hotKeysFunc);
+        rpc->bind(func_prefix+"_BloomFilter", bloomFilterFunc);
 	break;
     }
 #endif
@@ -127,9 +218,13 @@ unordered_map<KeyType, MappedType>::unordered_map(CharStruct name_)
         res = segment.find<MyHashMap>(name.c_str());
         myHashMap = res.first;
         size_t size = myHashMap->size();
-        std::pair<boost::interprocess::interprocess_mutex *, boost::interprocess::managed_shared_memory::size_type> res2;
-        res2 = segment.find<boost::interprocess::interprocess_mutex>("mtx");
+        std::pair<boost::interprocess::interprocess_sharable_mutex *, boost::interprocess::managed_shared_memory::size_type> res2;
+        res2 = segment.find<boost::interprocess::interprocess_sharable_mutex>("mtx");
         mutex = res2.first;
+        hot_keys = segment.find<HotKeySketch<KeyType>>("hot_keys").first;
+        leases = segment.find<LeaseTable<KeyType>>("leases").first;
+        clock = segment.find<ClockTable<KeyType>>("cache_clock").first;
+        bloom = segment.find<CountingBloomFilter>("bloom_filter").first;
     }
 }
 
@@ -142,13 +237,57 @@ unordered_map<KeyType, MappedType>::unordered_map(CharStruct name_)
 template<typename KeyType, typename MappedType>
 bool unordered_map<KeyType, MappedType>::LocalPut(KeyType &key,
                                                   MappedType &data) {
-    boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex>lock(*mutex);
-    myHashMap->insert_or_assign(key, data);
-    
+    return LocalPutWithTTL(key, data, BASKET_CONF->CACHE_TTL);
+}
+
+/**
+ * Put the data into the local unordered map. In cache mode the entry expires
+ * after ttl, otherwise ttl is ignored.
+ * @param key, the key for put
+ * @param data, the value for put
+ * @param ttl, lifetime of the entry in microseconds, 0 never expires
+ * @return bool, true if Put was successful else false.
+ */
+template<typename KeyType, typename MappedType>
+bool unordered_map<KeyType, MappedType>::LocalPutWithTTL(KeyType &key,
+                                                         MappedType &data,
+                                                         HTime ttl) {
+    if (hot_keys != nullptr) hot_keys->Record(key, PayloadSize(key) + PayloadSize(data));
+    boost::interprocess::scoped_lock<boost::interprocess::interprocess_sharable_mutex>lock(*mutex);
+    if (leases != nullptr) leases->WaitForWrite(lock, key);
+    CacheInsert(key, ttl, [&]() {
+        if (myHashMap->insert_or_assign(key, data).second && bloom != nullptr)
+            bloom->Add(keyHash(key));
+    });
+    MakeRoom();
     return true;
 }
+
+/**
+ * Put the data into the unordered map with a time to live. Uses key to
+ * decide the server to hash it to.
+ * @param key, the key for put
+ * @param data, the value for put
+ * @param ttl, lifetime of the entry in microseconds, 0 never expires
+ * @return bool, true if Put was successful else false.
+ */
+template<typename KeyType, typename MappedType>
+bool unordered_map<KeyType, MappedType>::PutWithTTL(KeyType &key,
+                                                    MappedType &data,
+                                                    HTime ttl) {
+    uint16_t key_int = static_cast<uint16_t>(keyHash(key) % num_servers);
+    if (key_int == my_server && server_on_node) {
+        return LocalPutWithTTL(key, data, ttl);
+    } else {
+        if (cache.Enabled()) cache.Erase(key);
+        if (bloom_filters.Enabled()) bloom_filters.Add(key_int, keyHash(key));
+        return RPC_CALL_WRAPPER("_PutWithTTL", key_int, bool, key, data, ttl);
+    }
+}
 /**
  * Put the data into the unordered map. Uses key to decide the server to hash it to,
+ * A remote Put waits on the server until all leases on key expired, including
+ * the one held by this client.
  * @param key, the key for put
  * @param data, the value for put
  * @return bool, true if Put was successful else false.
@@ -156,10 +295,13 @@ bool unordered_map<KeyType, MappedType>::LocalPut(KeyType &key,
 template<typename KeyType, typename MappedType>
 bool unordered_map<KeyType, MappedType>::Put(KeyType &key,
                                              MappedType &data) {
-    uint16_t key_int = (uint16_t)keyHash(key)% num_servers;
+    size_t key_hash = keyHash(key);
+    uint16_t key_int = static_cast<uint16_t>(key_hash % num_servers);
     if (key_int == my_server && server_on_node) {
         return LocalPut(key, data);
     } else {
+        if (cache.Enabled()) cache.Erase(key);
+        if (bloom_filters.Enabled()) bloom_filters.Add(key_int, key_hash);
 // #ifdef BASKET_ENABLE_THALLIUM_ROCE
 //         tl::bulk bulk_handle = rpc->prep_rdma_client<MappedType>(data);
 //         return RPC_CALL_WRAPPER("_Put", key_int, bool,
@@ -171,6 +313,119 @@ bool unordered_map<KeyType, MappedType>::Put(KeyType &key,
     }
 }
 
+/**
+ * Put the data into the local unordered map unless key is already present.
+ * @param key, the key for put
+ * @param data, the value for put
+ * @return bool, true if data was inserted, false if key was present.
+ */
+template<typename KeyType, typename MappedType>
+bool unordered_map<KeyType, MappedType>::LocalPutIfAbsent(KeyType &key, MappedType &data) {
+    if (hot_keys != nullptr) hot_keys->Record(key, PayloadSize(key) + PayloadSize(data));
+    boost::interprocess::scoped_lock<boost::interprocess::interprocess_sharable_mutex>
+            lock(*mutex);
+    /* outside cache mode an existing value is never overwritten, so leases
+       need not expire */
+    if (clock == nullptr) {
+        bool inserted = myHashMap->try_emplace(key, data).second;
+        if (inserted && bloom != nullptr) bloom->Add(keyHash(key));
+        return inserted;
+    }
+    typename MyHashMap::iterator iterator = myHashMap->find(key);
+    if (iterator != myHashMap->end() && !clock->Expired(key, LeaseClock())) {
+        return false;
+    }
+    if (iterator != myHashMap->end() && leases != nullptr) {
+        /* the expired value is replaced, clients may still hold it under a
+           lease; the lock is released while waiting, so check again */
+        leases->WaitForWrite(lock, key);
+        iterator = myHashMap->find(key);
+        if (iterator != myHashMap->end() && !clock->Expired(key, LeaseClock())) {
+            return false;
+        }
+    }
+    CacheInsert(key, BASKET_CONF->CACHE_TTL, [&]() {
+        if (myHashMap->insert_or_assign(key, data).second && bloom != nullptr)
+            bloom->Add(keyHash(key));
+    });
+    MakeRoom();
+    return true;
+}
+
+/**
+ * Put the data into the unordered map unless key is already present. Uses key to
+ * decide the server to hash it to, the check and the insert run on the
+ * server in a single request.
+ * @param key, the key for put
+ * @param data, the value for put
+ * @return bool, true if data was inserted, false if key was present.
+ */
+template<typename KeyType, typename MappedType>
+bool unordered_map<KeyType, MappedType>::PutIfAbsent(KeyType &key, MappedType &data) {
+    uint16_t key_int = static_cast<uint16_t>(keyHash(key) % num_servers);
+    if (key_int == my_server && server_on_node) {
+        return LocalPutIfAbsent(key, data);
+    } else {
+        if (cache.Enabled()) cache.Erase(key);
+        if (bloom_filters.Enabled()) bloom_filters.Add(key_int, keyHash(key));
+        return RPC_CALL_WRAPPER("_PutIfAbsent", key_int, bool, key, data);
+    }
+}
+
+/**
+ * Replace the value of key in the local unordered map by desired if it equals
+ * expected. MappedType has to provide operator==.
+ * @param key, the key to swap
+ * @param expected, the value key must hold
+ * @param desired, the new value
+ * @return bool, true if the value was replaced, false if key was missing or
+ * held another value.
+ */
+template<typename KeyType, typename MappedType>
+bool unordered_map<KeyType, MappedType>::LocalCompareAndSwap(KeyType &key, MappedType &expected,
+                                                  MappedType &desired) {
+    if (hot_keys != nullptr) hot_keys->Record(key, PayloadSize(key) + PayloadSize(expected) + PayloadSize(desired));
+    boost::interprocess::scoped_lock<boost::interprocess::interprocess_sharable_mutex>
+            lock(*mutex);
+    if (leases != nullptr) leases->WaitForWrite(lock, key);
+    auto iterator = myHashMap->find(key);
+    if (iterator == myHashMap->end() || !(iterator->second == expected) ||
+        (clock != nullptr && clock->Expired(key, LeaseClock()))) {
+        return false;
+    }
+    if (clock == nullptr) {
+        iterator->second = desired;
+        return true;
+    }
+    CacheInsert(key, BASKET_CONF->CACHE_TTL,
+                [&]() { myHashMap->insert_or_assign(key, desired); });
+    MakeRoom();
+    return true;
+}
+
+/**
+ * Replace the value of key by desired if it equals expected. Uses key to
+ * decide the server to hash it to, the compare and the swap run on the
+ * server in a single request.
+ * @param key, the key to swap
+ * @param expected, the value key must hold
+ * @param desired, the new value
+ * @return bool, true if the value was replaced, false if key was missing or
+ * held another value.
+ */
+template<typename KeyType, typename MappedType>
+bool unordered_map<KeyType, MappedType>::CompareAndSwap(KeyType &key, MappedType &expected,
+                                             MappedType &desired) {
+    uint16_t key_int = static_cast<uint16_t>(keyHash(key) % num_servers);
+    if (key_int == my_server && server_on_node) {
+        return LocalCompareAndSwap(key, expected, desired);
+    } else {
+        if (cache.Enabled()) cache.Erase(key);
+        return RPC_CALL_WRAPPER("_CompareAndSwap", key_int, bool,
+                                key, expected, desired);
+    }
+}
+
 template<typename KeyType, typename MappedType>
 template<typename CF, typename ReturnType,typename... ArgsType>
 void unordered_map<KeyType, MappedType>::Bind(  CharStruct callback_name,
@@ -233,44 +488,94 @@ typename std::enable_if_t<std::is_void<ReturnType>::value,bool> unordered_map<Ke
 /**
  * Get the data in the local unordered map.
  * @param key, key to get
- * @return return a pair of bool and Value. If bool is true then data was
- * found and is present in value part else bool is set to false
+ * @return an Optional holding the value if the key was found, empty
+ * otherwise
  */
 template<typename KeyType, typename MappedType>
-std::pair<bool, MappedType>
+Optional<MappedType>
 unordered_map<KeyType, MappedType>::LocalGet(KeyType &key) {
-    boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex>
+    boost::interprocess::sharable_lock<boost::interprocess::interprocess_sharable_mutex>
             lock(*mutex);
     typename MyHashMap::iterator iterator = myHashMap->find(key);
-    if (iterator != myHashMap->end()) {
-        return std::pair<bool, MappedType>(true, iterator->second);
+    if (hot_keys != nullptr) {
+        hot_keys->Record(key, PayloadSize(key) + (iterator != myHashMap->end()
+                                                  ? PayloadSize(iterator->second) : 0));
+    }
+    if (iterator != myHashMap->end() &&
+        (clock == nullptr || clock->Touch(key, LeaseClock()))) {
+        return Optional<MappedType>(iterator->second);
     } else {
-        return std::pair<bool, MappedType>(false, MappedType());
+        return Optional<MappedType>();
+    }
+}
+
+/**
+ * Get the data in the local unordered map and grant a lease on it, so that
+ * the caller may cache the value until the lease runs out.
+ * @param key, key to get
+ * @return return a pair of the LocalGet result and the granted lease in
+ * microseconds. A lease of 0 means the value must not be cached.
+ */
+template<typename KeyType, typename MappedType>
+std::pair<Optional<MappedType>, HTime>
+unordered_map<KeyType, MappedType>::LocalGetWithLease(KeyType &key) {
+    boost::interprocess::sharable_lock<boost::interprocess::interprocess_sharable_mutex>
+            lock(*mutex);
+    typename MyHashMap::iterator iterator = myHashMap->find(key);
+    if (hot_keys != nullptr) {
+        hot_keys->Record(key, PayloadSize(key) + (iterator != myHashMap->end()
+                                                  ? PayloadSize(iterator->second) : 0));
+    }
+    if (iterator != myHashMap->end() &&
+        (clock == nullptr || clock->Touch(key, LeaseClock()))) {
+        HTime lease = leases != nullptr ? leases->Grant(key) : 0;
+        return std::make_pair(Optional<MappedType>(iterator->second), lease);
+    } else {
+        return std::make_pair(Optional<MappedType>(), HTime(0));
     }
 }
 
 /**
  * Get the data in the unordered map. Uses key to decide the server to hash it to,
+ * Remote values are served from the client cache while their lease lasts.
+ * With BLOOM_FILTER_BITS set, a remote Get is only eventually consistent: a
+ * key another process inserted after this client last fetched the filter
+ * of its server may read as absent for up to BLOOM_FILTER_REFRESH
+ * microseconds. Keys this client put itself are seen at once, and
+ * BLOOM_FILTER_REFRESH 0 makes every remote Get ask the server.
  * @param key, key to get
- * @return return a pair of bool and Value. If bool is true then data was
- * found and is present in value part else bool is set to false
+ * @return an Optional holding the value if the key was found, empty
+ * otherwise
  */
 template<typename KeyType, typename MappedType>
-std::pair<bool, MappedType>
+Optional<MappedType>
 unordered_map<KeyType, MappedType>::Get(KeyType &key) {
     size_t key_hash = keyHash(key);
     uint16_t key_int = static_cast<uint16_t>(key_hash % num_servers);
     if (key_int == my_server && server_on_node) {
         return LocalGet(key);
+    } else if (!MayContain(key_int, key_hash)) {
+        return Optional<MappedType>();
+    } else if (cache.Enabled()) {
+        Optional<MappedType> cached = cache.Get(key);
+        if (cached) return cached;
+        /* the lease is counted from before the request to stay conservative */
+        HTime start = LeaseClock();
+        typedef std::pair<Optional<MappedType>, HTime> ret_type;
+        auto result = RPC_CALL_WRAPPER("_GetWithLease", key_int, ret_type, key);
+        if (result.first && result.second > 0) {
+            cache.Put(key, *result.first, start + result.second);
+        }
+        return result.first;
     } else {
-        typedef std::pair<bool, MappedType> ret_type;
+        typedef Optional<MappedType> ret_type;
        return RPC_CALL_WRAPPER("_Get", key_int, ret_type,key);
     }
 }
 
 template<typename KeyType, typename MappedType>
 template<typename ReturnType,typename... CB_Tuple_Args>
-typename std::enable_if_t<std::is_void<ReturnType>::value,std::pair<bool, MappedType>>
+typename std::enable_if_t<std::is_void<ReturnType>::value,Optional<MappedType>>
 unordered_map<KeyType, MappedType>::LocalGetWithCallback(KeyType &key, CharStruct cb_name, CB_Tuple_Args... cb_args){
     auto ret_1=LocalGet(key);
     auto ret_2=Call<ReturnType>(cb_name,std::forward<CB_Tuple_Args>(cb_args)...);
@@ -279,7 +584,7 @@ unordered_map<KeyType, MappedType>::LocalGetWithCallback(KeyType &key, CharStruc
 
 template<typename KeyType, typename MappedType>
 template<typename ReturnType,typename... CB_Tuple_Args>
-typename std::enable_if_t<!std::is_void<ReturnType>::value,std::pair<std::pair<bool, MappedType>,ReturnType>>
+typename std::enable_if_t<!std::is_void<ReturnType>::value,std::pair<Optional<MappedType>,ReturnType>>
         unordered_map<KeyType, MappedType>::LocalGetWithCallback(KeyType &key, CharStruct cb_name, CB_Tuple_Args... cb_args) {
     auto ret_1=LocalGet(key);
     auto ret_2=Call<ReturnType>(cb_name,std::forward<CB_Tuple_Args>(cb_args)...);
@@ -288,7 +593,7 @@ typename std::enable_if_t<!std::is_void<ReturnType>::value,std::pair<std::pair<b
 
 template<typename KeyType, typename MappedType>
 template<typename ReturnType,typename... CB_Args>
-typename std::enable_if_t<!std::is_void<ReturnType>::value,std::pair<std::pair<bool, MappedType>,ReturnType>> unordered_map<KeyType, MappedType>::GetWithCallback(KeyType &key,
+typename std::enable_if_t<!std::is_void<ReturnType>::value,std::pair<Optional<MappedType>,ReturnType>> unordered_map<KeyType, MappedType>::GetWithCallback(KeyType &key,
                                                                                                                                                                   CharStruct c_name,
                                                                                                                                                                   CharStruct cb_name,
                                                          CB_Args... cb_args) {
@@ -296,14 +601,14 @@ typename std::enable_if_t<!std::is_void<ReturnType>::value,std::pair<std::pair<b
     if (key_int == my_server && server_on_node) {
         return LocalGetWithCallback<ReturnType>(key, cb_name, std::forward<CB_Args>(cb_args)...);
     } else {
-        typedef std::pair<std::pair<bool, MappedType>,ReturnType> ret;
+        typedef std::pair<Optional<MappedType>,ReturnType> ret;
         return RPC_CALL_WRAPPER_CB(c_name, key_int, ret, key, cb_name);
     }
 }
 
 template<typename KeyType, typename MappedType>
 template<typename ReturnType,typename... CB_Args>
-typename std::enable_if_t<std::is_void<ReturnType>::value,std::pair<bool, MappedType>> unordered_map<KeyType, MappedType>::GetWithCallback(KeyType &key,
+typename std::enable_if_t<std::is_void<ReturnType>::value,Optional<MappedType>> unordered_map<KeyType, MappedType>::GetWithCallback(KeyType &key,
                                                                                                                                            CharStruct c_name,
                                                                                                                                                 CharStruct cb_name,
                                                                                                                                                 CB_Args... cb_args) {
@@ -311,40 +616,45 @@ typename std::enable_if_t<std::is_void<ReturnType>::value,std::pair<bool, Mapped
     if (key_int == my_server && server_on_node) {
         return LocalGetWithCallback<ReturnType>(key, cb_name, std::forward<CB_Args>(cb_args)...);
     } else {
-        typedef std::pair<bool, MappedType> ret;
+        typedef Optional<MappedType> ret;
         return RPC_CALL_WRAPPER_CB(c_name, key_int, ret, key, cb_name);
     }
 }
 
 template<typename KeyType, typename MappedType>
-std::pair<bool, MappedType>
+bool
 unordered_map<KeyType, MappedType>::LocalErase(KeyType &key) {
-    boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex>
+    if (hot_keys != nullptr) hot_keys->Record(key, PayloadSize(key));
+    boost::interprocess::scoped_lock<boost::interprocess::interprocess_sharable_mutex>
             lock(*mutex);
+    if (leases != nullptr) leases->WaitForWrite(lock, key);
+    if (clock != nullptr) clock->Erase(key);
     size_t s = myHashMap->erase(key);
-    
-    return std::pair<bool, MappedType>(s > 0, MappedType());
+    if (s > 0 && bloom != nullptr) bloom->Remove(keyHash(key));
+
+    return s > 0;
 }
 
 template<typename KeyType, typename MappedType>
-std::pair<bool, MappedType>
+bool
 unordered_map<KeyType, MappedType>::Erase(KeyType &key) {
     size_t key_hash = keyHash(key);
     uint16_t key_int = static_cast<uint16_t>(key_hash % num_servers);
     if (key_int == my_server && server_on_node) {
         return LocalErase(key);
     } else {
-      typedef std::pair<bool, MappedType> ret_type;
+      if (cache.Enabled()) cache.Erase(key);
+      typedef bool ret_type;
       return RPC_CALL_WRAPPER("_Erase", key_int, ret_type,
 			      key);
       // return rpc->call(key_int, func_prefix+"_Erase",
-      //                  key).template as<std::pair<bool, MappedType>>();
+      //                  key).template as<bool>();
     }
 }
 
 template<typename KeyType, typename MappedType>
 template<typename ReturnType,typename... CB_Tuple_Args>
-typename std::enable_if_t<std::is_void<ReturnType>::value,std::pair<bool, MappedType>>
+typename std::enable_if_t<std::is_void<ReturnType>::value,bool>
 unordered_map<KeyType, MappedType>::LocalEraseWithCallback(KeyType &key, std::string cb_name, CB_Tuple_Args... cb_args){
     auto ret_1=LocalErase(key);
     auto ret_2=Call<ReturnType>(cb_name,std::forward<CB_Tuple_Args>(cb_args)...);
@@ -353,7 +663,7 @@ unordered_map<KeyType, MappedType>::LocalEraseWithCallback(KeyType &key, std::st
 
 template<typename KeyType, typename MappedType>
 template<typename ReturnType,typename... CB_Tuple_Args>
-typename std::enable_if_t<!std::is_void<ReturnType>::value,std::pair<std::pair<bool, MappedType>,ReturnType>> unordered_map<KeyType, MappedType>::LocalEraseWithCallback(KeyType &key,
+typename std::enable_if_t<!std::is_void<ReturnType>::value,std::pair<bool,ReturnType>> unordered_map<KeyType, MappedType>::LocalEraseWithCallback(KeyType &key,
                                                               std::string cb_name,
                                                               CB_Tuple_Args... cb_args) {
     auto ret_1=LocalErase(key);
@@ -363,7 +673,7 @@ typename std::enable_if_t<!std::is_void<ReturnType>::value,std::pair<std::pair<b
 
 template<typename KeyType, typename MappedType>
 template<typename ReturnType,typename... CB_Args>
-typename std::enable_if_t<!std::is_void<ReturnType>::value,std::pair<std::pair<bool, MappedType>,ReturnType>> unordered_map<KeyType, MappedType>::EraseWithCallback(KeyType &key,
+typename std::enable_if_t<!std::is_void<ReturnType>::value,std::pair<bool,ReturnType>> unordered_map<KeyType, MappedType>::EraseWithCallback(KeyType &key,
                                                          std::string c_name,
                                                          std::string cb_name,
                                                          CB_Args... cb_args) {
@@ -371,14 +681,14 @@ typename std::enable_if_t<!std::is_void<ReturnType>::value,std::pair<std::pair<b
     if (key_int == my_server && server_on_node) {
         return LocalEraseWithCallback<ReturnType>(key, cb_name, std::forward<CB_Args>(cb_args)...);
     } else {
-        typedef std::pair<std::pair<bool, MappedType>,ReturnType> ret;
+        typedef std::pair<bool,ReturnType> ret;
         return RPC_CALL_WRAPPER_CB(c_name, key_int, ret, key, cb_name);
     }
 }
 
 template<typename KeyType, typename MappedType>
 template<typename ReturnType,typename... CB_Args>
-typename std::enable_if_t<std::is_void<ReturnType>::value,std::pair<bool, MappedType>> unordered_map<KeyType, MappedType>::EraseWithCallback(KeyType &key,
+typename std::enable_if_t<std::is_void<ReturnType>::value,bool> unordered_map<KeyType, MappedType>::EraseWithCallback(KeyType &key,
                                                                                                                                                 std::string c_name,
                                                                                                                                                 std::string cb_name,
                                                                                                                                                 CB_Args... cb_args) {
@@ -386,7 +696,7 @@ typename std::enable_if_t<std::is_void<ReturnType>::value,std::pair<bool, Mapped
     if (key_int == my_server && server_on_node) {
         return LocalEraseWithCallback<ReturnType>(key, cb_name, std::forward<CB_Args>(cb_args)...);
     } else {
-        typedef std::pair<bool, MappedType> ret;
+        typedef bool ret;
         return RPC_CALL_WRAPPER_CB(c_name, key_int, ret, key, cb_name);
     }
 }
@@ -416,14 +726,18 @@ unordered_map<KeyType, MappedType>::LocalGetAllDataInServer() {
     std::vector<std::pair<KeyType, MappedType>> final_values =
             std::vector<std::pair<KeyType, MappedType>>();
     {
-        boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex>
+        boost::interprocess::sharable_lock<boost::interprocess::interprocess_sharable_mutex>
                 lock(*mutex);
         typename MyHashMap::iterator lower_bound;
+        HTime now = LeaseClock();
         if (myHashMap->size() > 0) {
             lower_bound = myHashMap->begin();
             while (lower_bound != myHashMap->end()) {
-                final_values.push_back(std::pair<KeyType, MappedType>(
-                    lower_bound->first, lower_bound->second));
+                /* like Get, hide cache entries the sweeper has not erased yet */
+                if (clock == nullptr || !clock->Expired(lower_bound->first, now)) {
+                    final_values.push_back(std::pair<KeyType, MappedType>(
+                        lower_bound->first, lower_bound->second));
+                }
                 lower_bound++;
             }
         }
@@ -495,4 +809,592 @@ unordered_map<KeyType, MappedType>::GetAllDataInServerWithCallback(std::string c
         return RPC_CALL_WRAPPER_CB(c_name, my_server_i, ret, cb_name);
     }
 }
+
+/**
+ * Get the hottest keys of the local partition.
+ * @param k, number of keys to return
+ * @return a vector of key and (estimated hits, estimated bytes) pairs, the
+ * hottest first. Empty if HOT_KEY_CAPACITY is 0.
+ */
+template<typename KeyType, typename MappedType>
+std::vector<std::pair<KeyType, std::pair<uint64_t, uint64_t>>>
+unordered_map<KeyType, MappedType>::LocalHotKeys(uint32_t k) {
+    AutoTrace trace = AutoTrace("basket::unordered_map::HotKeys(local)", k);
+    if (hot_keys == nullptr) return std::vector<std::pair<KeyType, std::pair<uint64_t, uint64_t>>>();
+    return hot_keys->Top(k);
+}
+
+/**
+ * Get the hottest keys of a server partition.
+ * @param server, the server to query
+ * @param k, number of keys to return
+ * @return a vector of key and (estimated hits, estimated bytes) pairs, the
+ * hottest first.
+ */
+template<typename KeyType, typename MappedType>
+std::vector<std::pair<KeyType, std::pair<uint64_t, uint64_t>>>
+unordered_map<KeyType, MappedType>::HotKeys(uint16_t server, uint32_t k) {
+    if (server == my_server && server_on_node) {
+        return LocalHotKeys(k);
+    } else {
+        AutoTrace trace = AutoTrace("basket::unordered_map::HotKeys(remote)", server, k);
+        typedef std::vector<std::pair<KeyType, std::pair<uint64_t, uint64_t>>> ret_type;
+        return RPC_CALL_WRAPPER("_HotKeys", server, ret_type, k);
+    }
+}
+
+/**
+ * Get the Bloom filter of the local partition as a bit array.
+ * @return the words of the bit array, empty if the filter is disabled
+ */
+template<typename KeyType, typename MappedType>
+std::vector<uint64_t> unordered_map<KeyType, MappedType>::LocalBloomFilter() {
+    if (bloom == nullptr) return std::vector<uint64_t>();
+    boost::interprocess::sharable_lock<boost::interprocess::interprocess_sharable_mutex>
+            lock(*mutex);
+    return bloom->Snapshot();
+}
+
+/**
+ * Check the snapshot of the Bloom filter of server for a key, refreshing the
+ * snapshot every BLOOM_FILTER_REFRESH.
+ * @return false if the key is absent from the snapshot, true otherwise
+ */
+template<typename KeyType, typename MappedType>
+bool unordered_map<KeyType, MappedType>::MayContain(uint16_t server, size_t key_hash) {
+    if (!bloom_filters.Enabled()) return true;
+    return bloom_filters.MayContain(server, key_hash, [&]() {
+        typedef std::vector<uint64_t> ret_type;
+        return RPC_CALL_WRAPPER1("_BloomFilter", server, ret_type);
+    });
+}
+
+/**
+ * Run visitor on the value of key in place in the local unordered map, without
+ * copying it out of shared memory. The partition is read locked while
+ * visitor runs, so visitor must not call back into this unordered map nor keep
+ * references to the value.
+ * @param key, key to visit
+ * @param visitor, callable taking a const MappedType &
+ * @return bool, true if key was found and visited
+ */
+template<typename KeyType, typename MappedType>
+template<typename Visitor>
+bool unordered_map<KeyType, MappedType>::LocalVisit(KeyType &key, Visitor visitor) {
+    boost::interprocess::sharable_lock<boost::interprocess::interprocess_sharable_mutex>
+            lock(*mutex);
+    typename MyHashMap::iterator iterator = myHashMap->find(key);
+    if (hot_keys != nullptr) {
+        hot_keys->Record(key, PayloadSize(key) + (iterator != myHashMap->end()
+                                                  ? PayloadSize(iterator->second) : 0));
+    }
+    if (iterator == myHashMap->end() ||
+        (clock != nullptr && !clock->Touch(key, LeaseClock()))) {
+        return false;
+    }
+    visitor(static_cast<const MappedType &>(iterator->second));
+    return true;
+}
+
+/**
+ * Run visitor on the value of key. Uses key to decide the server to hash it
+ * to, on-node values are visited in place and remote values are fetched
+ * with Get and visited on the copy.
+ * @param key, key to visit
+ * @param visitor, callable taking a const MappedType &
+ * @return bool, true if key was found and visited
+ */
+template<typename KeyType, typename MappedType>
+template<typename Visitor>
+bool unordered_map<KeyType, MappedType>::Visit(KeyType &key, Visitor visitor) {
+    uint16_t key_int = static_cast<uint16_t>(keyHash(key) % num_servers);
+    if (key_int == my_server && server_on_node) {
+        return LocalVisit(key, visitor);
+    } else {
+        Optional<MappedType> result = Get(key);
+        if (!result) return false;
+        visitor(static_cast<const MappedType &>(*result));
+        return true;
+    }
+}
+
+/**
+ * Register op under op_name in this process and, on servers, bind the RPC
+ * running it. op edits the stored value in place and gets true, or for a
+ * missing key a value initialized MappedType and false, in which case the
+ * value is inserted only if op returns true. Every process that may run the
+ * update on-node has to register it. Args are value types and Update must be
+ * called with exactly these types.
+ * @param op_name, name of the update
+ * @param op, the update
+ */
+template<typename KeyType, typename MappedType>
+template<typename... Args>
+void unordered_map<KeyType, MappedType>::RegisterUpdate(
+        CharStruct op_name, std::function<bool(MappedType &, bool, Args...)> op) {
+    static_assert(std::conjunction<std::is_same<Args, std::decay_t<Args>>...>::value,
+                  "update arguments must be passed by value");
+    updates.Register(op_name.c_str(), op);
+    if (!is_server) return;
+    std::string update_name = std::string("_Update_") + op_name.c_str();
+    switch (BASKET_CONF->RPC_IMPLEMENTATION) {
+#ifdef BASKET_ENABLE_RPCLIB
+        case RPCLIB: {
+            std::function<bool(KeyType &, Args...)> updateFunc(
+                [this, op_name](KeyType &key, Args... args) {
+                    return LocalUpdate<Args...>(key, op_name, args...);
+                });
+            rpc->bind(func_prefix + update_name, updateFunc);
+            break;
+        }
+#endif
+#ifdef BASKET_ENABLE_THALLIUM_TCP
+        case THALLIUM_TCP:
+#endif
+#ifdef BASKET_ENABLE_THALLIUM_ROCE
+        case THALLIUM_ROCE:
+#endif
+#if defined(BASKET_ENABLE_THALLIUM_TCP) || defined(BASKET_ENABLE_THALLIUM_ROCE)
+        {
+            std::function<void(const tl::request &, KeyType &, Args...)> updateFunc(
+                [this, op_name](const tl::request &thallium_req, KeyType &key,
+                                Args... args) {
+                    thallium_req.respond(LocalUpdate<Args...>(key, op_name, args...));
+                });
+            rpc->bind(func_prefix + update_name, updateFunc);
+            break;
+        }
+#endif
+    }
+}
+
+/**
+ * Run the update registered as op_name on key in the local unordered map. The
+ * partition is write locked while the update runs.
+ * @param key, key to update
+ * @param op_name, name of the registered update
+ * @param args, arguments passed to the update
+ * @return bool, the result of the update, false if op_name is not registered
+ * with these argument types
+ */
+template<typename KeyType, typename MappedType>
+template<typename... Args>
+bool unordered_map<KeyType, MappedType>::LocalUpdate(KeyType &key, CharStruct op_name,
+                                  Args... args) {
+    auto op = updates.Find<std::function<bool(MappedType &, bool, Args...)>>(
+        op_name.c_str());
+    if (op == nullptr) return false;
+    if (hot_keys != nullptr) hot_keys->Record(key, PayloadSize(key));
+    boost::interprocess::scoped_lock<boost::interprocess::interprocess_sharable_mutex>
+            lock(*mutex);
+    if (leases != nullptr) leases->WaitForWrite(lock, key);
+    typename MyHashMap::iterator iterator = myHashMap->find(key);
+    if (iterator != myHashMap->end() &&
+        (clock == nullptr || clock->Touch(key, LeaseClock()))) {
+        return (*op)(iterator->second, true, args...);
+    }
+    MappedType value = MappedType();
+    if (!(*op)(value, false, args...)) return false;
+    CacheInsert(key, BASKET_CONF->CACHE_TTL, [&]() {
+        if (myHashMap->insert_or_assign(key, value).second && bloom != nullptr)
+            bloom->Add(keyHash(key));
+    });
+    MakeRoom();
+    return true;
+}
+
+/**
+ * Run the update registered as op_name on key. Uses key to decide the server
+ * to hash it to, the value is changed on the server in a single request.
+ * @param key, key to update
+ * @param op_name, name of the registered update
+ * @param args, arguments passed to the update
+ * @return bool, the result of the update
+ */
+template<typename KeyType, typename MappedType>
+template<typename... Args>
+bool unordered_map<KeyType, MappedType>::Update(KeyType &key, CharStruct op_name, Args... args) {
+    uint16_t key_int = static_cast<uint16_t>(keyHash(key) % num_servers);
+    if (key_int == my_server && server_on_node) {
+        return LocalUpdate(key, op_name, args...);
+    } else {
+        if (cache.Enabled()) cache.Erase(key);
+        if (bloom_filters.Enabled()) bloom_filters.Add(key_int, keyHash(key));
+        std::string update_name = std::string("_Update_") + op_name.c_str();
+        return RPC_CALL_WRAPPER(update_name, key_int, bool, key, args...);
+    }
+}
+
+/**
+ * Register a map-reduce under name in this process and, on servers, bind the
+ * RPC running it. map_fn turns an entry into a result and reduce_fn combines
+ * two results; it must be associative and commutative, as entries are
+ * folded in bucket order by several threads at once. Both have to be safe
+ * to call concurrently. Clients need the registration too, they combine the
+ * results of the servers with reduce_fn.
+ * @param name, name of the map-reduce
+ * @param map_fn, function applied to every entry
+ * @param reduce_fn, function combining two results
+ */
+template<typename KeyType, typename MappedType>
+template<typename ResultType>
+void unordered_map<KeyType, MappedType>::RegisterMapReduce(
+        CharStruct name,
+        std::function<ResultType(const KeyType &, const MappedType &)> map_fn,
+        std::function<ResultType(const ResultType &, const ResultType &)> reduce_fn) {
+    mappers.Register(name.c_str(), map_fn);
+    reducers.Register(name.c_str(), reduce_fn);
+    if (!is_server) return;
+    std::string map_reduce_name = std::string("_MapReduce_") + name.c_str();
+    switch (BASKET_CONF->RPC_IMPLEMENTATION) {
+#ifdef BASKET_ENABLE_RPCLIB
+        case RPCLIB: {
+            std::function<Optional<ResultType>(void)> mapReduceFunc(
+                [this, name]() { return LocalMapReduce<ResultType>(name); });
+            rpc->bind(func_prefix + map_reduce_name, mapReduceFunc);
+            break;
+        }
+#endif
+#ifdef BASKET_ENABLE_THALLIUM_TCP
+        case THALLIUM_TCP:
+#endif
+#ifdef BASKET_ENABLE_THALLIUM_ROCE
+        case THALLIUM_ROCE:
+#endif
+#if defined(BASKET_ENABLE_THALLIUM_TCP) || defined(BASKET_ENABLE_THALLIUM_ROCE)
+        {
+            std::function<void(const tl::request &)> mapReduceFunc(
+                [this, name](const tl::request &thallium_req) {
+                    thallium_req.respond(LocalMapReduce<ResultType>(name));
+                });
+            rpc->bind(func_prefix + map_reduce_name, mapReduceFunc);
+            break;
+        }
+#endif
+    }
+}
+
+/**
+ * Run the map-reduce registered as name over the local partition. Buckets
+ * are split in contiguous ranges over up to SCAN_THREADS threads, each
+ * folding its range, while the partition is read locked.
+ * @param name, name of the registered map-reduce
+ * @return an Optional holding the result, empty if the partition is empty or
+ * name is not registered with ResultType
+ * @throw whatever the map or reduce function threw, after all threads ended
+ */
+template<typename KeyType, typename MappedType>
+template<typename ResultType>
+Optional<ResultType> unordered_map<KeyType, MappedType>::LocalMapReduce(CharStruct name) {
+    typedef std::function<ResultType(const KeyType &, const MappedType &)> MapFunction;
+    typedef std::function<ResultType(const ResultType &, const ResultType &)> ReduceFunction;
+    std::shared_ptr<MapFunction> map_fn = mappers.Find<MapFunction>(name.c_str());
+    std::shared_ptr<ReduceFunction> reduce_fn = reducers.Find<ReduceFunction>(name.c_str());
+    if (map_fn == nullptr || reduce_fn == nullptr) return Optional<ResultType>();
+    boost::interprocess::sharable_lock<boost::interprocess::interprocess_sharable_mutex>
+            lock(*mutex);
+    size_t buckets = myHashMap->bucket_count();
+    size_t num_threads = std::min<size_t>(
+        std::max<size_t>(BASKET_CONF->SCAN_THREADS, 1),
+        myHashMap->size() / SCAN_ENTRIES_PER_THREAD + 1);
+    std::vector<Optional<ResultType>> partials(num_threads);
+    /* a throwing user function must not escape a worker, that terminates
+       the server; the first error is rethrown once all threads joined */
+    std::vector<std::exception_ptr> errors(num_threads);
+    HTime now = LeaseClock();
+    auto fold = [&](size_t thread) {
+        size_t first = buckets * thread / num_threads;
+        size_t last = buckets * (thread + 1) / num_threads;
+        Optional<ResultType> &partial = partials[thread];
+        try {
+            for (size_t bucket = first; bucket < last; ++bucket) {
+                for (auto iterator = myHashMap->cbegin(bucket);
+                     iterator != myHashMap->cend(bucket); ++iterator) {
+                    if (clock != nullptr && clock->Expired(iterator->first, now)) continue;
+                    ResultType value = (*map_fn)(iterator->first, iterator->second);
+                    if (partial) {
+                        *partial = (*reduce_fn)(*partial, value);
+                    } else {
+                        partial.emplace(std::move(value));
+                    }
+                }
+            }
+        } catch (...) {
+            errors[thread] = std::current_exception();
+        }
+    };
+    std::vector<std::thread> workers;
+    for (size_t thread = 1; thread < num_threads; ++thread) {
+        workers.emplace_back(fold, thread);
+    }
+    fold(0);
+    for (std::thread &worker : workers) worker.join();
+    for (std::exception_ptr &error : errors) {
+        if (error) std::rethrow_exception(error);
+    }
+    Optional<ResultType> result;
+    for (Optional<ResultType> &partial : partials) {
+        if (!partial) continue;
+        if (result) {
+            *result = (*reduce_fn)(*result, *partial);
+        } else {
+            result = std::move(partial);
+        }
+    }
+    return result;
+}
+
+/**
+ * Run the map-reduce registered as name on every server and combine their
+ * results with its reduce function. Only one result per server is sent
+ * over the network.
+ * @param name, name of the registered map-reduce
+ * @return an Optional holding the result, empty if the map is empty or name
+ * is not registered with ResultType
+ */
+template<typename KeyType, typename MappedType>
+template<typename ResultType>
+Optional<ResultType> unordered_map<KeyType, MappedType>::MapReduce(CharStruct name) {
+    typedef std::function<ResultType(const ResultType &, const ResultType &)> ReduceFunction;
+    std::shared_ptr<ReduceFunction> reduce_fn = reducers.Find<ReduceFunction>(name.c_str());
+    if (reduce_fn == nullptr) return Optional<ResultType>();
+    std::string map_reduce_name = std::string("_MapReduce_") + name.c_str();
+    Optional<ResultType> result;
+    for (uint16_t server = 0; server < num_servers; ++server) {
+        Optional<ResultType> partial;
+        if (server == my_server && server_on_node) {
+            partial = LocalMapReduce<ResultType>(name);
+        } else {
+            typedef Optional<ResultType> ret_type;
+            partial = RPC_CALL_WRAPPER1(map_reduce_name, server, ret_type);
+        }
+        if (!partial) continue;
+        if (result) {
+            *result = (*reduce_fn)(*result, *partial);
+        } else {
+            result = std::move(partial);
+        }
+    }
+    return result;
+}
+
+/**
+ * Register a filter under name whose scans return the matching entries.
+ * @param name, name of the filter
+ * @param filter, predicate evaluated on every scanned entry
+ */
+template<typename KeyType, typename MappedType>
+template<typename... Args>
+void unordered_map<KeyType, MappedType>::RegisterFilter(
+        CharStruct name, std::function<bool(const KeyType &, const MappedType &, Args...)> filter) {
+    std::function<MappedType(const KeyType &, const MappedType &)> projection(
+        [](const KeyType &key, const MappedType &value) { return value; });
+    RegisterFilter<MappedType, Args...>(name, filter, projection);
+}
+
+/**
+ * Register a filter under name in this process and, on servers, bind the RPC
+ * running it. Scans evaluate filter with their arguments on the server and
+ * return projection of the matching entries only. Both functions must not
+ * call back into this unordered map, and Args are value types that scans
+ * have to pass exactly.
+ * @param name, name of the filter
+ * @param filter, predicate evaluated on every scanned entry
+ * @param projection, part of a matching entry to return
+ */
+template<typename KeyType, typename MappedType>
+template<typename ProjectedType, typename... Args>
+void unordered_map<KeyType, MappedType>::RegisterFilter(
+        CharStruct name, std::function<bool(const KeyType &, const MappedType &, Args...)> filter,
+        std::function<ProjectedType(const KeyType &, const MappedType &)> projection) {
+    static_assert(std::conjunction<std::is_same<Args, std::decay_t<Args>>...>::value,
+                  "filter arguments must be passed by value");
+    filters.Register(name.c_str(), filter);
+    projections.Register(name.c_str(), projection);
+    if (!is_server) return;
+    std::string filter_name = std::string("_Filter_") + name.c_str();
+    switch (BASKET_CONF->RPC_IMPLEMENTATION) {
+#ifdef BASKET_ENABLE_RPCLIB
+        case RPCLIB: {
+            std::function<std::vector<std::pair<KeyType, ProjectedType>>(Args...)> filterFunc(
+                [this, name](Args... args) {
+                    return LocalFilter<ProjectedType, Args...>(name, args...);
+                });
+            rpc->bind(func_prefix + filter_name, filterFunc);
+            break;
+        }
+#endif
+#ifdef BASKET_ENABLE_THALLIUM_TCP
+        case THALLIUM_TCP:
+#endif
+#ifdef BASKET_ENABLE_THALLIUM_ROCE
+        case THALLIUM_ROCE:
+#endif
+#if defined(BASKET_ENABLE_THALLIUM_TCP) || defined(BASKET_ENABLE_THALLIUM_ROCE)
+        {
+            std::function<void(const tl::request &, Args...)> filterFunc(
+                [this, name](const tl::request &thallium_req, Args... args) {
+                    thallium_req.respond(LocalFilter<ProjectedType, Args...>(name, args...));
+                });
+            rpc->bind(func_prefix + filter_name, filterFunc);
+            break;
+        }
+#endif
+    }
+}
+
+/**
+ * Scan the local partition with the filter registered as name.
+ * @param name, name of the registered filter
+ * @param args, arguments passed to the filter
+ * @return the projected matching entries, empty if name is not registered
+ * with these types
+ */
+template<typename KeyType, typename MappedType>
+template<typename ProjectedType, typename... Args>
+std::vector<std::pair<KeyType, ProjectedType>>
+unordered_map<KeyType, MappedType>::LocalFilter(CharStruct name, Args... args) {
+    typedef std::function<bool(const KeyType &, const MappedType &, Args...)> FilterFunction;
+    typedef std::function<ProjectedType(const KeyType &, const MappedType &)> ProjectFunction;
+    std::vector<std::pair<KeyType, ProjectedType>> final_values;
+    std::shared_ptr<FilterFunction> filter = filters.Find<FilterFunction>(name.c_str());
+    std::shared_ptr<ProjectFunction> projection = projections.Find<ProjectFunction>(name.c_str());
+    if (filter == nullptr || projection == nullptr) return final_values;
+    boost::interprocess::sharable_lock<boost::interprocess::interprocess_sharable_mutex>
+            lock(*mutex);
+    HTime now = LeaseClock();
+    for (auto iterator = myHashMap->begin(); iterator != myHashMap->end(); ++iterator) {
+        if (clock != nullptr && clock->Expired(iterator->first, now)) continue;
+        if ((*filter)(iterator->first, iterator->second, args...)) {
+            final_values.emplace_back(iterator->first,
+                                      (*projection)(iterator->first, iterator->second));
+        }
+    }
+    return final_values;
+}
+
+/**
+ * Scan every server with the filter registered as name. Only the projected
+ * matching entries are sent back.
+ * @param name, name of the registered filter
+ * @param args, arguments passed to the filter
+ * @return the projected matching entries of all servers
+ */
+template<typename KeyType, typename MappedType>
+template<typename ProjectedType, typename... Args>
+std::vector<std::pair<KeyType, ProjectedType>>
+unordered_map<KeyType, MappedType>::Filter(CharStruct name, Args... args) {
+    std::vector<std::pair<KeyType, ProjectedType>> final_values;
+    std::string filter_name = std::string("_Filter_") + name.c_str();
+    for (uint16_t server = 0; server < num_servers; ++server) {
+        std::vector<std::pair<KeyType, ProjectedType>> server_values;
+        if (server == my_server && server_on_node) {
+            server_values = LocalFilter<ProjectedType, Args...>(name, args...);
+        } else {
+            typedef std::vector<std::pair<KeyType, ProjectedType>> ret_type;
+            server_values = RPC_CALL_WRAPPER(filter_name, server, ret_type, args...);
+        }
+        final_values.insert(final_values.end(), server_values.begin(),
+                            server_values.end());
+    }
+    return final_values;
+}
+
+/**
+ * Run operation, which inserts or assigns key, and track key in the clock
+ * table in cache mode. If the segment is full, entries are evicted and
+ * operation is retried until it fits or nothing is left to evict.
+ * Expects the partition to be write locked.
+ * @param key, the key operation writes
+ * @param ttl, lifetime of the entry in microseconds, 0 never expires
+ * @param operation, the insertion, it must be safe to run again
+ */
+template<typename KeyType, typename MappedType>
+template<typename Operation>
+void unordered_map<KeyType, MappedType>::CacheInsert(const KeyType &key, HTime ttl,
+                                                     Operation operation) {
+    if (clock == nullptr) {
+        operation();
+        return;
+    }
+    HTime expiry = ttl > 0 ? LeaseClock() + ttl : 0;
+    while (true) {
+        try {
+            clock->Insert(key, expiry);
+            operation();
+            return;
+        } catch (const boost::interprocess::bad_alloc &) {
+            if (Evict(clock->Size() / 16 + 1) == 0) throw;
+        }
+    }
+}
+
+/**
+ * Whether a client may still serve key from its cache, so that erasing it
+ * now would leave the client with a value the server no longer has.
+ */
+template<typename KeyType, typename MappedType>
+bool unordered_map<KeyType, MappedType>::Leased(const KeyType &key) {
+    return leases != nullptr && leases->Leased(key);
+}
+
+/**
+ * Evict up to count entries chosen by the clock hand, passing over keys
+ * with a live lease. Expects the partition to be write locked.
+ * @return the number of evicted entries
+ */
+template<typename KeyType, typename MappedType>
+size_t unordered_map<KeyType, MappedType>::Evict(size_t count) {
+    size_t evicted = 0;
+    HTime now = LeaseClock();
+    for (; evicted < count; ++evicted) {
+        Optional<KeyType> victim =
+            clock->Victim(now, [this](const KeyType &key) { return Leased(key); });
+        if (!victim) break;
+        if (myHashMap->erase(*victim) > 0 && bloom != nullptr) bloom->Remove(keyHash(*victim));
+    }
+    return evicted;
+}
+
+/**
+ * Evict entries until the segment use drops below CACHE_HIGH_WATER. Does
+ * nothing outside cache mode. Expects the partition to be write locked.
+ */
+template<typename KeyType, typename MappedType>
+void unordered_map<KeyType, MappedType>::MakeRoom() {
+    if (clock == nullptr) return;
+    size_t high_water = static_cast<size_t>(segment.get_size() *
+                                            BASKET_CONF->CACHE_HIGH_WATER);
+    while (segment.get_size() - segment.get_free_memory() > high_water) {
+        if (Evict(1) == 0) break;
+    }
+}
+
+/**
+ * Body of the sweeper thread of servers in cache mode. Every
+ * CACHE_SWEEP_INTERVAL it walks the clock table in batches of
+ * CACHE_SWEEP_BATCH slots, releasing the partition lock in between, and
+ * erases the expired entries. Entries still under a lease are left to a
+ * later sweep.
+ */
+template<typename KeyType, typename MappedType>
+void unordered_map<KeyType, MappedType>::Sweep() {
+    std::unique_lock<std::mutex> guard(sweeper_mutex);
+    while (!sweeper_condition.wait_for(
+            guard, std::chrono::microseconds(BASKET_CONF->CACHE_SWEEP_INTERVAL),
+            [this]() { return sweeper_stop; })) {
+        size_t examined = 0, slots = 0;
+        do {
+            boost::interprocess::scoped_lock<boost::interprocess::interprocess_sharable_mutex>
+                    lock(*mutex);
+            examined += clock->Expire(LeaseClock(), CACHE_SWEEP_BATCH,
+                                      [this](const KeyType &key) { return Leased(key); },
+                                      [this](const KeyType &key) {
+                if (myHashMap->erase(key) > 0 && bloom != nullptr) bloom->Remove(keyHash(key));
+            });
+            slots = clock->Slots();
+            MakeRoom();
+        } while (examined < slots);
+    }
+}
 #endif  // INCLUDE_BASKET_UNORDERED_MAP_UNORDERED_MAP_CPP_
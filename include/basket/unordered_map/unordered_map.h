@@ -34,11 +34,21 @@
 #include <string>
 #include <vector>
 #include <tuple>
+#include <thread>
+#include <exception>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
 
 #include <basket/communication/rpc_lib.h>
 #include <basket/communication/rpc_factory.h>
 #include <basket/common/singleton.h>
 #include <basket/common/typedefs.h>
+#include <basket/common/client_cache.h>
+#include <basket/common/hot_key_sketch.h>
+#include <basket/common/function_registry.h>
+#include <basket/common/clock_table.h>
+#include <basket/common/bloom_filter.h>
 
 
 /** MPI Headers**/
@@ -60,6 +70,10 @@
 #include <boost/functional/hash.hpp>
 #include <boost/algorithm/string.hpp>
 #include <boost/interprocess/managed_mapped_file.hpp>
+#include <boost/interprocess/sync/interprocess_sharable_mutex.hpp>
+#include <boost/interprocess/sync/scoped_lock.hpp>
+#include <boost/interprocess/sync/sharable_lock.hpp>
+#include <boost/interprocess/exceptions.hpp>
 
 /** Namespaces Uses **/
 
@@ -75,12 +89,12 @@ namespace basket {
 template<typename KeyType, typename MappedType>
 class unordered_map {
   private:
-    std::hash<KeyType> keyHash;
+    basket::hash<KeyType> keyHash;
     /** Class Typedefs for ease of use **/
     typedef std::pair<const KeyType, MappedType> ValueType;
     typedef boost::interprocess::allocator<ValueType, boost::interprocess::managed_mapped_file::segment_manager> ShmemAllocator;
     typedef boost::interprocess::managed_mapped_file managed_segment;
-    typedef boost::unordered::unordered_map<KeyType, MappedType, std::hash<KeyType>,
+    typedef boost::unordered::unordered_map<KeyType, MappedType, basket::hash<KeyType>,
                                                                 std::equal_to<KeyType>,
                                                                 ShmemAllocator>
                                                                 MyHashMap;
@@ -93,10 +107,29 @@ class unordered_map {
     boost::interprocess::managed_mapped_file segment;
     CharStruct name, func_prefix;
     MyHashMap *myHashMap;
-    boost::interprocess::interprocess_mutex* mutex;
+    boost::interprocess::interprocess_sharable_mutex* mutex;
     bool server_on_node;
     std::unordered_map<CharStruct, void*> binding_map;
     CharStruct backed_file;
+    LeaseTable<KeyType> *leases;
+    ClientCache<KeyType, MappedType> cache;
+    HotKeySketch<KeyType> *hot_keys;
+    FunctionRegistry updates, mappers, reducers, filters, projections;
+    ClockTable<KeyType> *clock;
+    std::thread sweeper;
+    std::mutex sweeper_mutex;
+    std::condition_variable sweeper_condition;
+    bool sweeper_stop;
+    CountingBloomFilter *bloom;
+    BloomFilterCache bloom_filters;
+
+    bool MayContain(uint16_t server, size_t key_hash);
+    template<typename Operation>
+    void CacheInsert(const KeyType &key, HTime ttl, Operation operation);
+    bool Leased(const KeyType &key);
+    size_t Evict(size_t count);
+    void MakeRoom();
+    void Sweep();
 
   public:
     ~unordered_map();
@@ -122,12 +155,30 @@ class unordered_map {
     void BindClient(std::string rpc_name);
 
     bool LocalPut(KeyType &key, MappedType &data);
-    std::pair<bool, MappedType> LocalGet(KeyType &key);
-    std::pair<bool, MappedType> LocalErase(KeyType &key);
+    bool LocalPutWithTTL(KeyType &key, MappedType &data, HTime ttl);
+    bool LocalPutIfAbsent(KeyType &key, MappedType &data);
+    bool LocalCompareAndSwap(KeyType &key, MappedType &expected, MappedType &desired);
+    Optional<MappedType> LocalGet(KeyType &key);
+    bool LocalErase(KeyType &key);
+    std::pair<Optional<MappedType>, HTime> LocalGetWithLease(KeyType &key);
     std::vector<std::pair<KeyType, MappedType>> LocalGetAllDataInServer();
+    template<typename Visitor>
+    bool LocalVisit(KeyType &key, Visitor visitor);
+    template<typename... Args>
+    bool LocalUpdate(KeyType &key, CharStruct op_name, Args... args);
+    template<typename ProjectedType, typename... Args>
+    std::vector<std::pair<KeyType, ProjectedType>> LocalFilter(CharStruct name, Args... args);
+    template<typename ResultType>
+    Optional<ResultType> LocalMapReduce(CharStruct name);
+    std::vector<std::pair<KeyType, std::pair<uint64_t, uint64_t>>> LocalHotKeys(uint32_t k);
+    std::vector<uint64_t> LocalBloomFilter();
 
 #if defined(BASKET_ENABLE_THALLIUM_TCP) || defined(BASKET_ENABLE_THALLIUM_ROCE)
     THALLIUM_DEFINE(LocalPut, (key,data) ,KeyType &key, MappedType &data)
+    THALLIUM_DEFINE(LocalPutWithTTL, (key,data,ttl), KeyType &key, MappedType &data, HTime ttl)
+    THALLIUM_DEFINE(LocalPutIfAbsent, (key,data), KeyType &key, MappedType &data)
+    THALLIUM_DEFINE(LocalCompareAndSwap, (key,expected,desired), KeyType &key,
+                    MappedType &expected, MappedType &desired)
 
     // void ThalliumLocalPut(const tl::request &thallium_req, tl::bulk &bulk_handle, KeyType key) {
     //     MappedType data = rpc->prep_rdma_server<MappedType>(thallium_req.get_endpoint(), bulk_handle);
@@ -146,14 +197,43 @@ class unordered_map {
 
     THALLIUM_DEFINE(LocalGet, (key), KeyType &key)
     THALLIUM_DEFINE(LocalErase, (key), KeyType &key)
+    THALLIUM_DEFINE(LocalGetWithLease, (key), KeyType &key)
     THALLIUM_DEFINE1(LocalGetAllDataInServer)
+    THALLIUM_DEFINE(LocalHotKeys, (k), uint32_t k)
+    THALLIUM_DEFINE1(LocalBloomFilter)
 #endif
 
     bool Put(KeyType &key, MappedType &data);
-    std::pair<bool, MappedType> Get(KeyType &key);
-    std::pair<bool, MappedType> Erase(KeyType &key);
+    bool PutWithTTL(KeyType &key, MappedType &data, HTime ttl);
+    bool PutIfAbsent(KeyType &key, MappedType &data);
+    bool CompareAndSwap(KeyType &key, MappedType &expected, MappedType &desired);
+    Optional<MappedType> Get(KeyType &key);
+    bool Erase(KeyType &key);
     std::vector<std::pair<KeyType, MappedType>> GetAllData();
     std::vector<std::pair<KeyType, MappedType>> GetAllDataInServer();
+    template<typename Visitor>
+    bool Visit(KeyType &key, Visitor visitor);
+    template<typename... Args>
+    void RegisterUpdate(CharStruct op_name,
+                        std::function<bool(MappedType &, bool, Args...)> op);
+    template<typename... Args>
+    bool Update(KeyType &key, CharStruct op_name, Args... args);
+    template<typename... Args>
+    void RegisterFilter(CharStruct name,
+                        std::function<bool(const KeyType &, const MappedType &, Args...)> filter);
+    template<typename ProjectedType, typename... Args>
+    void RegisterFilter(CharStruct name,
+                        std::function<bool(const KeyType &, const MappedType &, Args...)> filter,
+                        std::function<ProjectedType(const KeyType &, const MappedType &)> projection);
+    template<typename ProjectedType = MappedType, typename... Args>
+    std::vector<std::pair<KeyType, ProjectedType>> Filter(CharStruct name, Args... args);
+    template<typename ResultType>
+    void RegisterMapReduce(CharStruct name,
+                           std::function<ResultType(const KeyType &, const MappedType &)> map_fn,
+                           std::function<ResultType(const ResultType &, const ResultType &)> reduce_fn);
+    template<typename ResultType>
+    Optional<ResultType> MapReduce(CharStruct name);
+    std::vector<std::pair<KeyType, std::pair<uint64_t, uint64_t>>> HotKeys(uint16_t server, uint32_t k);
 
     template<typename ReturnType,typename... CB_Tuple_Args>
     typename std::enable_if_t<std::is_void<ReturnType>::value,bool>
@@ -183,52 +263,52 @@ class unordered_map {
 
 
     template<typename ReturnType,typename... CB_Tuple_Args>
-    typename std::enable_if_t<std::is_void<ReturnType>::value,std::pair<bool, MappedType>>
+    typename std::enable_if_t<std::is_void<ReturnType>::value,Optional<MappedType>>
     LocalGetWithCallback(KeyType &key,
                          CharStruct cb_name,
                          CB_Tuple_Args... cb_args);
 
     template<typename ReturnType,typename... CB_Tuple_Args>
-    typename std::enable_if_t<!std::is_void<ReturnType>::value,std::pair<std::pair<bool, MappedType>,ReturnType>>
+    typename std::enable_if_t<!std::is_void<ReturnType>::value,std::pair<Optional<MappedType>,ReturnType>>
     LocalGetWithCallback(KeyType &key,
                          CharStruct cb_name,
                          CB_Tuple_Args... cb_args);
 
     template<typename ReturnType,typename... CB_Args>
-    typename std::enable_if_t<!std::is_void<ReturnType>::value,std::pair<std::pair<bool, MappedType>,ReturnType>>
+    typename std::enable_if_t<!std::is_void<ReturnType>::value,std::pair<Optional<MappedType>,ReturnType>>
     GetWithCallback(KeyType &key,
                     CharStruct c_name,
                     CharStruct cb_name,
                     CB_Args... cb_args);
 
     template<typename ReturnType,typename... CB_Args>
-    typename std::enable_if_t<std::is_void<ReturnType>::value,std::pair<bool, MappedType>>
+    typename std::enable_if_t<std::is_void<ReturnType>::value,Optional<MappedType>>
     GetWithCallback(KeyType &key,
                     CharStruct c_name,
                     CharStruct cb_name,
                     CB_Args... cb_args);
 
     template<typename ReturnType,typename... CB_Tuple_Args>
-    typename std::enable_if_t<std::is_void<ReturnType>::value,std::pair<bool, MappedType>>
+    typename std::enable_if_t<std::is_void<ReturnType>::value,bool>
     LocalEraseWithCallback(KeyType &key,
                          std::string cb_name,
                          CB_Tuple_Args... cb_args);
 
     template<typename ReturnType,typename... CB_Tuple_Args>
-    typename std::enable_if_t<!std::is_void<ReturnType>::value,std::pair<std::pair<bool, MappedType>,ReturnType>>
+    typename std::enable_if_t<!std::is_void<ReturnType>::value,std::pair<bool,ReturnType>>
     LocalEraseWithCallback(KeyType &key,
                          std::string cb_name,
                          CB_Tuple_Args... cb_args);
 
     template<typename ReturnType,typename... CB_Args>
-    typename std::enable_if_t<!std::is_void<ReturnType>::value,std::pair<std::pair<bool, MappedType>,ReturnType>>
+    typename std::enable_if_t<!std::is_void<ReturnType>::value,std::pair<bool,ReturnType>>
     EraseWithCallback(KeyType &key,
                     std::string c_name,
                     std::string cb_name,
                     CB_Args... cb_args);
 
     template<typename ReturnType,typename... CB_Args>
-    typename std::enable_if_t<std::is_void<ReturnType>::value,std::pair<bool, MappedType>>
+    typename std::enable_if_t<std::is_void<ReturnType>::value,bool>
     EraseWithCallback(KeyType &key,
                     std::string c_name,
                     std::string cb_name,
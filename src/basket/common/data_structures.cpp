@@ -28,6 +28,3 @@ std::ostream &operator<<(std::ostream &os, char const *m) {
 std::ostream &operator<<(std::ostream &os, uint8_t const &m) {
     return os << std::to_string(m);
 }
-std::ostream &operator<<(std::ostream &os, CharStruct const &m){
-    return os   << "{TYPE:CharStruct," << "value:" << m.c_str()<<"}";
-}
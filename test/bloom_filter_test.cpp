@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2019  Hariharan Devarajan, Keith Bateman
+ *
+ * This file is part of Basket
+ * 
+ * Basket is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <basket/common/bloom_filter.h>
+#include <unistd.h>
+#include <vector>
+#include "unit_test.h"
+
+/* Test a key against a bit array snapshot of a filter. */
+bool SnapshotContains(const std::vector<uint64_t> &words, size_t bits,
+                      uint16_t hashes, size_t hash) {
+    for (uint16_t i = 0; i < hashes; ++i) {
+        size_t bit = basket::BloomProbe(hash, i, bits);
+        if ((words[bit / 64] & (1ULL << (bit % 64))) == 0) return false;
+    }
+    return true;
+}
+
+/* Every added key stays in the filter until it is removed, and removing
+   one key keeps the others that share its counters. */
+void TestCounting(TestSegment &scratch) {
+    const size_t bits = 4096;
+    basket::CountingBloomFilter *filter =
+            scratch.segment.construct<basket::CountingBloomFilter>("counting")(
+                bits, 4, scratch.Manager());
+    for (size_t key = 0; key < 500; ++key) filter->Add(basket::hash<size_t>()(key));
+    std::vector<uint64_t> words = filter->Snapshot();
+    BASKET_CHECK(words.size() == bits / 64);
+    for (size_t key = 0; key < 500; ++key) {
+        BASKET_CHECK(SnapshotContains(words, bits, 4, basket::hash<size_t>()(key)));
+    }
+    for (size_t key = 0; key < 500; key += 2) filter->Remove(basket::hash<size_t>()(key));
+    words = filter->Snapshot();
+    size_t removed_present = 0;
+    for (size_t key = 0; key < 500; ++key) {
+        bool present = SnapshotContains(words, bits, 4, basket::hash<size_t>()(key));
+        if (key % 2 == 1) BASKET_CHECK(present);
+        else if (present) ++removed_present;
+    }
+    BASKET_CHECK(removed_present < 50);
+    scratch.segment.destroy_ptr(filter);
+}
+
+/* Counters that saturated stay set, so removals never clear a key that is
+   still there. */
+void TestSaturation(TestSegment &scratch) {
+    basket::CountingBloomFilter *filter =
+            scratch.segment.construct<basket::CountingBloomFilter>("saturation")(
+                64, 1, scratch.Manager());
+    size_t hash = basket::hash<size_t>()(42);
+    for (int i = 0; i < 300; ++i) filter->Add(hash);
+    for (int i = 0; i < 299; ++i) filter->Remove(hash);
+    BASKET_CHECK(SnapshotContains(filter->Snapshot(), 64, 1, hash));
+    scratch.segment.destroy_ptr(filter);
+}
+
+/* A client snapshot is fetched once per refresh period, learns the keys of
+   the client right away and answers present without a filter to test. */
+void TestCache() {
+    const size_t bits = 1024;
+    const HTime refresh = 20000;
+    std::vector<uint64_t> server(bits / 64, 0);
+    int fetches = 0;
+    auto fetch = [&]() {
+        ++fetches;
+        return server;
+    };
+    basket::BloomFilterCache cache(bits, 3, refresh, 2);
+    BASKET_CHECK(cache.Enabled());
+    size_t hash = basket::hash<size_t>()(7);
+    BASKET_CHECK(!cache.MayContain(1, hash, fetch));
+    BASKET_CHECK(fetches == 1);
+    /* a key another process inserts is missed until the snapshot expires */
+    for (uint16_t i = 0; i < 3; ++i) {
+        size_t bit = basket::BloomProbe(hash, i, bits);
+        server[bit / 64] |= 1ULL << (bit % 64);
+    }
+    BASKET_CHECK(!cache.MayContain(1, hash, fetch));
+    BASKET_CHECK(fetches == 1);
+    usleep(refresh * 2);
+    BASKET_CHECK(cache.MayContain(1, hash, fetch));
+    BASKET_CHECK(fetches == 2);
+    /* a key the client puts itself is seen at once */
+    size_t own = basket::hash<size_t>()(8);
+    cache.Add(1, own);
+    BASKET_CHECK(cache.MayContain(1, own, fetch));
+    /* a server without a filter answers an empty bit array */
+    BASKET_CHECK(cache.MayContain(0, hash, []() { return std::vector<uint64_t>(); }));
+    BASKET_CHECK(!basket::BloomFilterCache(bits, 3, 0, 2).Enabled());
+}
+
+int main() {
+    TestSegment scratch("basket_bloom_filter_test", 16 * 1024 * 1024);
+    TestCounting(scratch);
+    TestSaturation(scratch);
+    TestCache();
+    printf("bloom_filter_test passed\n");
+    return 0;
+}
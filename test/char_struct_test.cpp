@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2019  Hariharan Devarajan, Keith Bateman
+ *
+ * This file is part of Basket
+ * 
+ * Basket is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <basket/common/data_structures.h>
+#include <stdexcept>
+#include <string>
+#include "unit_test.h"
+
+/* Keys up to the capacity are kept whole, longer ones are refused instead
+   of being cut to a prefix another key may share. */
+void TestCapacity() {
+    std::string longest(31, 'k');
+    ShortCharStruct key(longest);
+    BASKET_CHECK(key.size() == 31 && key.string() == longest);
+    bool refused = false;
+    try {
+        ShortCharStruct too_long(longest + "1");
+    } catch (const std::length_error &) {
+        refused = true;
+    }
+    BASKET_CHECK(refused);
+    refused = false;
+    try {
+        key += ShortCharStruct("2");
+    } catch (const std::length_error &) {
+        refused = true;
+    }
+    BASKET_CHECK(refused);
+}
+
+/* Length and hash are cached and take part in comparisons. */
+void TestCompare() {
+    CharStruct a("abc"), b(std::string("abc")), c("abd"), d("ab");
+    BASKET_CHECK(a == b && a.hash() == b.hash());
+    BASKET_CHECK(a != c && a < c && d < a && c > d);
+    BASKET_CHECK(std::hash<CharStruct>()(a) == a.hash());
+}
+
+int main() {
+    TestCapacity();
+    TestCompare();
+    printf("char_struct_test passed\n");
+    return 0;
+}
@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2019  Hariharan Devarajan, Keith Bateman
+ *
+ * This file is part of Basket
+ * 
+ * Basket is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <basket/common/clock_table.h>
+#include <basket/common/client_cache.h>
+#include <set>
+#include <vector>
+#include "unit_test.h"
+
+typedef basket::ClockTable<int> Clock;
+
+/* Victims come in hand order; a touched key gets a second chance and
+   goes last, and a refreshed key counts as touched. */
+void TestSecondChance(TestSegment &scratch) {
+    Clock *clock = scratch.segment.construct<Clock>("chance")(scratch.Manager());
+    for (int key = 1; key <= 4; ++key) clock->Insert(key, 0);
+    HTime now = basket::LeaseClock();
+    BASKET_CHECK(clock->Touch(2, now));
+    clock->Insert(3, 0);
+    std::vector<int> victims;
+    for (auto victim = clock->Victim(now); victim; victim = clock->Victim(now)) {
+        victims.push_back(*victim);
+    }
+    BASKET_CHECK((victims == std::vector<int>{1, 4, 2, 3}));
+    BASKET_CHECK(clock->Size() == 0);
+    scratch.segment.destroy_ptr(clock);
+}
+
+/* Expired keys fail Touch and are taken by the hand even if referenced,
+   Expire erases them unless they are pinned. */
+void TestExpiry(TestSegment &scratch) {
+    Clock *clock = scratch.segment.construct<Clock>("expiry")(scratch.Manager());
+    HTime now = basket::LeaseClock();
+    clock->Insert(1, now + 1000000);
+    clock->Insert(2, now - 1);
+    clock->Insert(3, now - 1);
+    clock->Insert(4, 0);
+    BASKET_CHECK(clock->Touch(1, now) && clock->Touch(4, now));
+    BASKET_CHECK(!clock->Touch(2, now) && clock->Expired(2, now));
+    BASKET_CHECK(!clock->Expired(1, now) && !clock->Expired(4, now));
+    std::vector<int> erased;
+    size_t examined = clock->Expire(now, 16, [](const int &key) { return key == 3; },
+                                    [&erased](const int &key) { erased.push_back(key); });
+    BASKET_CHECK(examined == 4);
+    BASKET_CHECK((erased == std::vector<int>{2}));
+    BASKET_CHECK(clock->Size() == 3 && clock->Expired(3, now));
+    /* the referenced but expired key 3 goes before the live ones */
+    clock->Insert(5, 0);
+    BASKET_CHECK(clock->Touch(5, now));
+    auto victim = clock->Victim(now);
+    BASKET_CHECK(victim && *victim == 3);
+    scratch.segment.destroy_ptr(clock);
+}
+
+/* Pinned keys are never taken, the hand gives up once only they are left. */
+void TestPinned(TestSegment &scratch) {
+    Clock *clock = scratch.segment.construct<Clock>("pinned")(scratch.Manager());
+    HTime now = basket::LeaseClock();
+    for (int key = 0; key < 10; ++key) {
+        clock->Insert(key, 0);
+        clock->Touch(key, now);
+    }
+    auto odd = [](const int &key) { return key % 2 == 1; };
+    std::set<int> victims;
+    for (auto victim = clock->Victim(now, odd); victim; victim = clock->Victim(now, odd)) {
+        victims.insert(*victim);
+    }
+    BASKET_CHECK((victims == std::set<int>{0, 2, 4, 6, 8}));
+    BASKET_CHECK(clock->Size() == 5);
+    BASKET_CHECK(!clock->Victim(now, [](const int &) { return true; }));
+    scratch.segment.destroy_ptr(clock);
+}
+
+/* Erased and evicted slots are reused, the table does not grow under
+   churn. */
+void TestReuse(TestSegment &scratch) {
+    Clock *clock = scratch.segment.construct<Clock>("reuse")(scratch.Manager());
+    HTime now = basket::LeaseClock();
+    for (int key = 0; key < 100; ++key) clock->Insert(key, 0);
+    size_t slots = clock->Slots();
+    for (int key = 100; key < 10000; ++key) {
+        if (key % 2 == 0) {
+            clock->Erase(key - 1);
+        } else {
+            BASKET_CHECK(clock->Victim(now));
+        }
+        clock->Insert(key, 0);
+    }
+    BASKET_CHECK(clock->Size() == 100);
+    BASKET_CHECK(clock->Slots() == slots);
+    scratch.segment.destroy_ptr(clock);
+}
+
+int main() {
+    TestSegment scratch("basket_clock_table_test", 64 * 1024 * 1024);
+    TestSecondChance(scratch);
+    TestExpiry(scratch);
+    TestPinned(scratch);
+    TestReuse(scratch);
+    printf("clock_table_test passed\n");
+    return 0;
+}
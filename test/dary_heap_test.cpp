@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2019  Hariharan Devarajan, Keith Bateman
+ *
+ * This file is part of Basket
+ * 
+ * Basket is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <basket/common/dary_heap.h>
+#include <functional>
+#include <random>
+#include <set>
+#include <vector>
+#include "unit_test.h"
+
+/* Random pushes, batch pushes, pops and top_n calls agree with a sorted
+   reference, for max and min heaps of several arities. Batches are small
+   or larger than the heap, so both push_n paths are taken. */
+template<typename Compare, size_t Arity>
+void TestAgainstReference(TestSegment &scratch, const char *name, unsigned seed) {
+    typedef basket::DaryHeap<int, Compare, Arity> Heap;
+    Heap *heap = scratch.segment.construct<Heap>(name)(Compare(), scratch.Manager());
+    /* the reference iterates best first */
+    auto better = [](int a, int b) { return Compare()(b, a); };
+    std::multiset<int, decltype(better)> reference(better);
+    std::mt19937 random(seed);
+    for (int round = 0; round < 20000; ++round) {
+        switch (random() % 4) {
+            case 0: {
+                int value = random() % 1000;
+                heap->push(std::move(value));
+                reference.insert(value);
+                break;
+            }
+            case 1: {
+                size_t count = round % 100 == 0 && heap->size() < 1000
+                               ? heap->size() + 1 + random() % 100 : random() % 4;
+                std::vector<int> batch;
+                for (size_t i = 0; i < count; ++i) batch.push_back(random() % 1000);
+                reference.insert(batch.begin(), batch.end());
+                heap->push_n(batch.begin(), batch.end());
+                break;
+            }
+            case 2: {
+                if (reference.empty()) {
+                    BASKET_CHECK(heap->empty());
+                    break;
+                }
+                BASKET_CHECK(heap->top() == *reference.begin());
+                BASKET_CHECK(heap->pop_top() == *reference.begin());
+                reference.erase(reference.begin());
+                break;
+            }
+            default: {
+                std::vector<int> best = heap->top_n(7);
+                BASKET_CHECK(best.size() == std::min<size_t>(7, reference.size()));
+                auto expected = reference.begin();
+                for (int value : best) BASKET_CHECK(value == *expected++);
+            }
+        }
+        BASKET_CHECK(heap->size() == reference.size());
+    }
+    while (!reference.empty()) {
+        BASKET_CHECK(heap->pop_top() == *reference.begin());
+        reference.erase(reference.begin());
+    }
+    BASKET_CHECK(heap->empty());
+    scratch.segment.destroy_ptr(heap);
+}
+
+/* Many one element batches keep the heap valid and do not exhaust the
+   segment with a reallocation per batch. */
+void TestSmallBatches(TestSegment &scratch) {
+    typedef basket::DaryHeap<int> Heap;
+    Heap *heap = scratch.segment.construct<Heap>("small")(std::less<int>(), scratch.Manager());
+    for (int i = 0; i < 100000; ++i) {
+        int value = (i * 7919) % 100000;
+        heap->push_n(&value, &value + 1);
+    }
+    for (int i = 99999; i >= 0; --i) BASKET_CHECK(heap->pop_top() == i);
+    scratch.segment.destroy_ptr(heap);
+}
+
+int main() {
+    TestSegment scratch("basket_dary_heap_test", 32 * 1024 * 1024);
+    TestAgainstReference<std::less<int>, 2>(scratch, "binary", 1);
+    TestAgainstReference<std::less<int>, 4>(scratch, "quaternary", 2);
+    TestAgainstReference<std::greater<int>, 4>(scratch, "min", 3);
+    TestAgainstReference<std::greater<int>, 8>(scratch, "octonary", 4);
+    TestSmallBatches(scratch);
+    printf("dary_heap_test passed\n");
+    return 0;
+}
@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2019  Hariharan Devarajan, Keith Bateman
+ *
+ * This file is part of Basket
+ * 
+ * Basket is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <basket/common/hot_key_sketch.h>
+#include <thread>
+#include <vector>
+#include "unit_test.h"
+
+typedef basket::HotKeySketch<int> Sketch;
+
+/* Under a skewed load from several threads the hottest keys are reported
+   first, with exact counts as long as the sketch has no collisions. */
+void TestSkew(TestSegment &scratch) {
+    Sketch *sketch = scratch.segment.construct<Sketch>("skew")(8, scratch.Manager());
+    std::vector<std::thread> threads;
+    for (int thread = 0; thread < 4; ++thread) {
+        threads.emplace_back([sketch, thread]() {
+            for (int round = 0; round < 1000; ++round) {
+                for (int key = 0; key < 4; ++key) {
+                    for (int hit = 0; hit <= key; ++hit) sketch->Record(key, 10);
+                }
+                sketch->Record(100 + thread * 1000 + round, 1);
+            }
+        });
+    }
+    for (auto &thread : threads) thread.join();
+    auto top = sketch->Top(4);
+    BASKET_CHECK(top.size() == 4);
+    for (int rank = 0; rank < 4; ++rank) {
+        int key = 3 - rank;
+        BASKET_CHECK(top[rank].first == key);
+        BASKET_CHECK(top[rank].second.first >= 4000u * (key + 1));
+        BASKET_CHECK(top[rank].second.second >= 40000u * (key + 1));
+    }
+    scratch.segment.destroy_ptr(sketch);
+}
+
+/* A key that turns hot later replaces the coldest tracked key. */
+void TestReplacement(TestSegment &scratch) {
+    Sketch *sketch = scratch.segment.construct<Sketch>("replace")(2, scratch.Manager());
+    for (int hit = 0; hit < 10; ++hit) sketch->Record(1, 1);
+    for (int hit = 0; hit < 5; ++hit) sketch->Record(2, 1);
+    for (int hit = 0; hit < 20; ++hit) sketch->Record(3, 1);
+    auto top = sketch->Top(2);
+    BASKET_CHECK(top.size() == 2);
+    BASKET_CHECK(top[0].first == 3 && top[1].first == 1);
+    scratch.segment.destroy_ptr(sketch);
+}
+
+struct SmallKey {
+    uint64_t a;
+    bool operator==(const SmallKey &o) const { return a == o.a; }
+};
+namespace basket {
+    template<>
+    struct hash<SmallKey> {
+        size_t operator()(const SmallKey &k) const { return k.a; }
+    };
+}
+
+/* Keys placed by an identity hash, the smallest of which equal the member
+   set markers, are still counted apart. */
+void TestIdentityHash(TestSegment &scratch) {
+    typedef basket::HotKeySketch<SmallKey> IdentitySketch;
+    IdentitySketch *sketch =
+        scratch.segment.construct<IdentitySketch>("identity")(4, scratch.Manager());
+    for (uint64_t key = 0; key < 4; ++key) {
+        for (uint64_t hit = 0; hit < 10 - 2 * key; ++hit) sketch->Record(SmallKey{key}, 1);
+    }
+    auto top = sketch->Top(4);
+    BASKET_CHECK(top.size() == 4);
+    for (uint64_t key = 0; key < 4; ++key) {
+        BASKET_CHECK(top[key].first.a == key);
+        BASKET_CHECK(top[key].second.first == 10 - 2 * key);
+    }
+    scratch.segment.destroy_ptr(sketch);
+}
+
+/* Payloads count the characters of strings and the contents of vectors. */
+void TestPayloadSize() {
+    BASKET_CHECK(basket::PayloadSize(CharStruct("abc")) == 3);
+    BASKET_CHECK(basket::PayloadSize(std::string("abcd")) == 4);
+    BASKET_CHECK(basket::PayloadSize(std::vector<int>(5)) == 5 * sizeof(int));
+    BASKET_CHECK(basket::PayloadSize(7) == sizeof(int));
+}
+
+int main() {
+    TestSegment scratch("basket_hot_key_sketch_test", 64 * 1024 * 1024);
+    TestSkew(scratch);
+    TestReplacement(scratch);
+    TestIdentityHash(scratch);
+    TestPayloadSize();
+    printf("hot_key_sketch_test passed\n");
+    return 0;
+}
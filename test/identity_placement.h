@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2019  Hariharan Devarajan, Keith Bateman
+ *
+ * This file is part of Basket
+ * 
+ * Basket is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/*-------------------------------------------------------------------------
+ *
+ * Created: identity_placement.h
+ *
+ * Purpose: Defines the key placement shared by the keyed benchmarks.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef BASKET_TEST_IDENTITY_PLACEMENT_H
+#define BASKET_TEST_IDENTITY_PLACEMENT_H
+
+#include <cstddef>
+#include <basket/common/hash.h>
+
+/*
+ * The benchmarks pick each key so that key.a % num_servers is the server
+ * they mean to hit, so the routing hash has to stay the identity instead of
+ * the mixing basket::hash default. Specialize basket::hash for a benchmark
+ * key by deriving from this functor.
+ */
+template<typename Key>
+struct IdentityPlacement {
+    size_t operator()(const Key &k) const {
+        return k.a;
+    }
+};
+
+#endif //BASKET_TEST_IDENTITY_PLACEMENT_H
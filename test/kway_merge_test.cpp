@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2019  Hariharan Devarajan, Keith Bateman
+ *
+ * This file is part of Basket
+ * 
+ * Basket is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <basket/common/kway_merge.h>
+#include <algorithm>
+#include <functional>
+#include <random>
+#include <vector>
+#include "unit_test.h"
+
+/* Sorted runs of random length, some empty, with keys shared across runs. */
+template<typename Less>
+std::vector<std::vector<int>> MakeRuns(size_t sources, std::mt19937 &random) {
+    std::vector<std::vector<int>> runs(sources);
+    for (std::vector<int> &run : runs) {
+        size_t length = random() % 4 == 0 ? 0 : random() % 60;
+        for (size_t i = 0; i < length; ++i) run.push_back(random() % 200);
+        std::sort(run.begin(), run.end(), Less());
+        run.erase(std::unique(run.begin(), run.end()), run.end());
+    }
+    return runs;
+}
+
+/* The merge yields every element of every run once in global order, and
+   pulls pages only as they are consumed. */
+template<typename Less>
+void TestMerge(size_t sources, uint32_t page_size, unsigned seed) {
+    std::mt19937 random(seed);
+    std::vector<std::vector<int>> runs = MakeRuns<Less>(sources, random);
+    std::vector<int> expected;
+    for (const std::vector<int> &run : runs) expected.insert(expected.end(), run.begin(), run.end());
+    std::stable_sort(expected.begin(), expected.end(), Less());
+    size_t transferred = 0;
+    auto fetch = [&](uint16_t source, const basket::Optional<int> &last, uint32_t n) {
+        const std::vector<int> &run = runs[source];
+        auto from = last ? std::upper_bound(run.begin(), run.end(), *last, Less()) : run.begin();
+        std::vector<int> page(from, from + std::min<size_t>(n, run.end() - from));
+        transferred += page.size();
+        return page;
+    };
+    basket::KWayMerge<int, Less> merge(sources, page_size, Less(), fetch);
+    size_t head = std::min<size_t>(5, expected.size());
+    std::vector<int> merged = merge.NextN(head);
+    /* the first elements only cost the first page of every source */
+    BASKET_CHECK(transferred <= head + sources * page_size);
+    std::vector<int> rest = merge.NextN(expected.size());
+    merged.insert(merged.end(), rest.begin(), rest.end());
+    BASKET_CHECK(merged == expected);
+    BASKET_CHECK(!merge.Next());
+    BASKET_CHECK(transferred == expected.size());
+}
+
+int main() {
+    for (unsigned seed = 0; seed < 20; ++seed) {
+        TestMerge<std::less<int>>(1 + seed % 7, 1, seed);
+        TestMerge<std::less<int>>(1 + seed % 7, 4, seed);
+        TestMerge<std::greater<int>>(1 + seed % 7, 16, seed);
+        TestMerge<std::less<int>>(1 + seed % 7, 1000, seed);
+    }
+    printf("kway_merge_test passed\n");
+    return 0;
+}
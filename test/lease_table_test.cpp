@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2019  Hariharan Devarajan, Keith Bateman
+ *
+ * This file is part of Basket
+ * 
+ * Basket is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <basket/common/client_cache.h>
+#include <mutex>
+#include <thread>
+#include "unit_test.h"
+
+typedef basket::LeaseTable<int> Leases;
+
+/* A lease is granted once per period and never extended while it runs. */
+void TestGrant(TestSegment &scratch) {
+    Leases *leases = scratch.segment.construct<Leases>("grant")(100000, scratch.Manager());
+    BASKET_CHECK(leases->Grant(1) == 100000);
+    HTime remaining = leases->Grant(1);
+    BASKET_CHECK(remaining > 0 && remaining <= 100000);
+    BASKET_CHECK(leases->Size() == 1);
+    BASKET_CHECK(leases->Leased(1) && !leases->Leased(2));
+    scratch.segment.destroy_ptr(leases);
+}
+
+/* Keys that are read but never written do not pile up in the table. */
+void TestSweep(TestSegment &scratch) {
+    Leases *leases = scratch.segment.construct<Leases>("sweep")(10, scratch.Manager());
+    for (int round = 0; round < 50; ++round) {
+        for (int key = 0; key < 100; ++key) leases->Grant(round * 100 + key);
+        usleep(20);
+    }
+    BASKET_CHECK(leases->Size() <= 300);
+    scratch.segment.destroy_ptr(leases);
+}
+
+/* A writer waits for the lease to run out, and no lease is granted while
+   it waits. */
+void TestWaitForWrite(TestSegment &scratch) {
+    const HTime lease_time = 50000;
+    Leases *leases = scratch.segment.construct<Leases>("write")(lease_time, scratch.Manager());
+    std::mutex partition;
+    HTime start = basket::LeaseClock();
+    leases->Grant(7);
+    std::thread writer([&]() {
+        std::unique_lock<std::mutex> lock(partition);
+        leases->WaitForWrite(lock, 7);
+    });
+    usleep(lease_time / 5);
+    BASKET_CHECK(leases->Grant(7) == 0);
+    writer.join();
+    BASKET_CHECK(basket::LeaseClock() - start >= lease_time);
+    BASKET_CHECK(leases->Size() == 0);
+    /* an unleased key is written right away */
+    std::unique_lock<std::mutex> lock(partition);
+    leases->WaitForWrite(lock, 8);
+    BASKET_CHECK(lock.owns_lock());
+    scratch.segment.destroy_ptr(leases);
+}
+
+int main() {
+    TestSegment scratch("basket_lease_table_test", 64 * 1024 * 1024);
+    TestGrant(scratch);
+    TestSweep(scratch);
+    TestWaitForWrite(scratch);
+    printf("lease_table_test passed\n");
+    return 0;
+}
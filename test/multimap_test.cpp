@@ -30,6 +30,7 @@
 #include <map>
 #include <basket/common/data_structures.h>
 #include <basket/multimap/multimap.h>
+#include "identity_placement.h"
 
 struct KeyType{
     size_t a;
@@ -70,6 +71,10 @@ namespace std {
         }
     };
 }
+namespace basket {
+    template<>
+    struct hash<KeyType> : IdentityPlacement<KeyType> {};
+}
 
 
 int main (int argc,char* argv[])
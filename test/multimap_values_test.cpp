@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2019  Hariharan Devarajan, Keith Bateman
+ *
+ * This file is part of Basket
+ * 
+ * Basket is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <basket/multimap/multimap.h>
+#include <mpi.h>
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <random>
+#include "identity_placement.h"
+#include "unit_test.h"
+
+/* Key with the range lookup multimap::Contains needs, placed by value. */
+struct Key {
+    uint64_t a;
+    Key() : a(0) {}
+    Key(uint64_t a_) : a(a_) {}
+#ifdef BASKET_ENABLE_RPCLIB
+    MSGPACK_DEFINE(a);
+#endif
+    bool operator==(const Key &o) const { return a == o.a; }
+    bool operator<(const Key &o) const { return a < o.a; }
+    bool Contains(const Key &o) const { return a == o.a; }
+#if defined(BASKET_ENABLE_THALLIUM_TCP) || defined(BASKET_ENABLE_THALLIUM_ROCE)
+    template<typename A>
+    void serialize(A &ar) const {
+        ar & a;
+    }
+#endif
+};
+namespace basket {
+    template<>
+    struct hash<Key> : IdentityPlacement<Key> {};
+}
+
+/*
+ * Every rank runs a multimap server and works on its own keys, which are
+ * spread over all servers by their value. Put, Append, GetValues, Get and Erase must agree
+ * with a map of deques kept by the rank, and GetAllData must return one
+ * pair per value of every rank.
+ */
+int main(int argc, char *argv[]) {
+    int provided;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_MULTIPLE, &provided);
+    BASKET_CHECK(provided >= MPI_THREAD_MULTIPLE);
+    int comm_size, my_rank;
+    MPI_Comm_size(MPI_COMM_WORLD, &comm_size);
+    MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+
+    BASKET_CONF->IS_SERVER = true;
+    BASKET_CONF->MY_SERVER = my_rank;
+    BASKET_CONF->NUM_SERVERS = comm_size;
+    BASKET_CONF->SERVER_ON_NODE = true;
+    BASKET_CONF->SERVER_LIST = std::vector<CharStruct>(comm_size, CharStruct("localhost"));
+    BASKET_CONF->BACKED_FILE_DIR = "/tmp";
+    BASKET_CONF->RPC_THREADS = 4;
+    basket::multimap<Key, uint64_t> *multimap =
+        new basket::multimap<Key, uint64_t>("basket_multimap_values_test");
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    std::map<Key, std::deque<uint64_t>> reference;
+    std::mt19937_64 random(my_rank);
+    uint64_t next = 0;
+    for (int round = 0; round < 3000; ++round) {
+        Key key(my_rank * 1000 + random() % 64);
+        switch (random() % 6) {
+            case 0:
+            case 1: {
+                uint64_t value = next++;
+                BASKET_CHECK(multimap->Put(key, value));
+                std::deque<uint64_t> &values = reference[key];
+                if (!values.empty()) values.pop_front();
+                values.push_back(value);
+                break;
+            }
+            case 2: {
+                std::vector<uint64_t> block(random() % 20);
+                for (uint64_t &value : block) value = next++;
+                BASKET_CHECK(multimap->Append(key, block));
+                if (!block.empty()) {
+                    reference[key].insert(reference[key].end(), block.begin(), block.end());
+                }
+                break;
+            }
+            case 3:
+                multimap->Erase(key);
+                reference.erase(key);
+                break;
+            default: {
+                auto expected = reference.find(key);
+                std::vector<uint64_t> values = multimap->GetValues(key);
+                basket::Optional<uint64_t> oldest = multimap->Get(key);
+                if (expected == reference.end()) {
+                    BASKET_CHECK(values.empty() && !oldest);
+                } else {
+                    BASKET_CHECK(std::equal(values.begin(), values.end(),
+                                            expected->second.begin(), expected->second.end()));
+                    BASKET_CHECK(oldest && *oldest == expected->second.front());
+                }
+            }
+        }
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+    uint64_t stored = 0, all_stored = 0;
+    for (const auto &entry : reference) stored += entry.second.size();
+    MPI_Allreduce(&stored, &all_stored, 1, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
+    BASKET_CHECK(multimap->GetAllData().size() == all_stored);
+    MPI_Barrier(MPI_COMM_WORLD);
+    delete multimap;
+    if (my_rank == 0) printf("multimap_values_test passed\n");
+    MPI_Finalize();
+    return 0;
+}
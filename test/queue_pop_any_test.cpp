@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2019  Hariharan Devarajan, Keith Bateman
+ *
+ * This file is part of Basket
+ * 
+ * Basket is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <basket/queue/queue.h>
+#include <mpi.h>
+#include <atomic>
+#include <thread>
+#include "unit_test.h"
+
+/*
+ * Every rank runs a queue server and pushes its elements to server 0 only,
+ * which is bounded and fails fast when full, while all ranks consume with
+ * PopAny. The other ranks can only make progress by stealing, and stolen
+ * elements that fit neither partition must come back from PopAny later.
+ * In the end every element must have been popped exactly once.
+ */
+int main(int argc, char *argv[]) {
+    int provided;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_MULTIPLE, &provided);
+    BASKET_CHECK(provided >= MPI_THREAD_MULTIPLE);
+    int comm_size, my_rank;
+    MPI_Comm_size(MPI_COMM_WORLD, &comm_size);
+    MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+    const uint64_t elements = 2000;
+
+    BASKET_CONF->IS_SERVER = true;
+    BASKET_CONF->MY_SERVER = my_rank;
+    BASKET_CONF->NUM_SERVERS = comm_size;
+    BASKET_CONF->SERVER_ON_NODE = true;
+    BASKET_CONF->SERVER_LIST = std::vector<CharStruct>(comm_size, CharStruct("localhost"));
+    BASKET_CONF->BACKED_FILE_DIR = "/tmp";
+    BASKET_CONF->RPC_THREADS = 4;
+    BASKET_CONF->QUEUE_CAPACITY = 32;
+    BASKET_CONF->QUEUE_FULL_POLICY = QUEUE_FULL_FAIL;
+    BASKET_CONF->STEAL_BATCH = 64;
+    basket::queue<uint64_t> *queue = new basket::queue<uint64_t>("basket_queue_pop_any_test");
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    std::atomic<bool> produced(false);
+    std::thread producer([&]() {
+        uint16_t target = 0;
+        for (uint64_t i = 1; i <= elements; ++i) {
+            uint64_t value = my_rank * elements + i;
+            while (!queue->Push(value, target)) std::this_thread::yield();
+        }
+        produced = true;
+    });
+    uint64_t popped = 0, sum = 0;
+    while (true) {
+        basket::Optional<uint64_t> value = queue->PopAny();
+        if (value) {
+            ++popped;
+            sum += *value;
+        } else if (produced) {
+            break;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+    MPI_Barrier(MPI_COMM_WORLD);
+    /* drain until a whole round pops nothing anywhere */
+    while (true) {
+        uint64_t round = 0, total = 0;
+        for (basket::Optional<uint64_t> value = queue->PopAny(); value;
+             value = queue->PopAny()) {
+            ++round;
+            sum += *value;
+        }
+        popped += round;
+        MPI_Allreduce(&round, &total, 1, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
+        if (total == 0) break;
+    }
+    uint64_t all_popped = 0, all_sum = 0;
+    MPI_Allreduce(&popped, &all_popped, 1, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
+    MPI_Allreduce(&sum, &all_sum, 1, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
+    uint64_t pushed = comm_size * elements;
+    BASKET_CHECK(all_popped == pushed);
+    BASKET_CHECK(all_sum == pushed * (pushed + 1) / 2);
+    MPI_Barrier(MPI_COMM_WORLD);
+    delete queue;
+    if (my_rank == 0) printf("queue_pop_any_test passed\n");
+    MPI_Finalize();
+    return 0;
+}
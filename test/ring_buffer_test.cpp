@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2019  Hariharan Devarajan, Keith Bateman
+ *
+ * This file is part of Basket
+ * 
+ * Basket is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <basket/common/ring_buffer.h>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "unit_test.h"
+
+typedef basket::RingBuffer<long> Ring;
+
+/* Elements come out in push order, a full ring refuses pushes without
+   touching them, and batches go in whole or not at all. */
+void TestOrder(TestSegment &scratch) {
+    Ring *ring = scratch.segment.construct<Ring>("order")(6, scratch.Manager());
+    BASKET_CHECK(ring->Capacity() == 8);
+    for (int lap = 0; lap < 3; ++lap) {
+        for (long i = 0; i < 8; ++i) BASKET_CHECK(ring->TryPush(i));
+        long extra = 99;
+        BASKET_CHECK(!ring->TryPush(extra) && extra == 99);
+        BASKET_CHECK(ring->Size() == 8);
+        long value = -1;
+        for (long i = 0; i < 8; ++i) BASKET_CHECK(ring->TryPop(value) && value == i);
+        BASKET_CHECK(!ring->TryPop(value) && ring->Size() == 0);
+    }
+    std::vector<long> batch = {1, 2, 3, 4, 5};
+    BASKET_CHECK(ring->TryPushN(batch.data(), batch.size()));
+    BASKET_CHECK(!ring->TryPushN(batch.data(), batch.size()));
+    BASKET_CHECK(ring->Size() == 5);
+    std::vector<long> too_large(9, 0);
+    long value = 0;
+    while (ring->TryPop(value)) {}
+    BASKET_CHECK(!ring->TryPushN(too_large.data(), too_large.size()));
+    scratch.segment.destroy_ptr(ring);
+}
+
+/* A sink that throws still gives the slot back. */
+void TestThrowingSink(TestSegment &scratch) {
+    Ring *ring = scratch.segment.construct<Ring>("sink")(4, scratch.Manager());
+    long value = 5;
+    ring->TryPush(value);
+    bool thrown = false;
+    try {
+        ring->TryPopInto([](long &&) { throw std::runtime_error("sink"); });
+    } catch (const std::runtime_error &) {
+        thrown = true;
+    }
+    BASKET_CHECK(thrown && ring->Size() == 0);
+    for (long i = 0; i < 4; ++i) BASKET_CHECK(ring->TryPush(i));
+    long popped = -1;
+    BASKET_CHECK(ring->TryPopInto([&popped](long &&data) { popped = data; }) && popped == 0);
+    scratch.segment.destroy_ptr(ring);
+}
+
+/* Concurrent producers, mixing single and batch pushes, and consumers move
+   every element exactly once. */
+void TestConcurrent(TestSegment &scratch) {
+    Ring *ring = scratch.segment.construct<Ring>("concurrent")(256, scratch.Manager());
+    const int threads = 4;
+    const long per_producer = 100000;
+    std::atomic<long> consumed(0), sum(0);
+    std::vector<std::thread> workers;
+    for (int p = 0; p < threads; ++p) {
+        workers.emplace_back([ring, p]() {
+            for (long i = 0; i < per_producer; i += 2) {
+                long base = p * per_producer + i;
+                std::vector<long> pair = {base + 1, base + 2};
+                if (p % 2 == 0) {
+                    while (!ring->TryPushN(pair.data(), 2)) std::this_thread::yield();
+                } else {
+                    while (!ring->TryPush(pair[0])) std::this_thread::yield();
+                    while (!ring->TryPush(pair[1])) std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (int c = 0; c < threads; ++c) {
+        workers.emplace_back([&]() {
+            long value;
+            while (consumed.load() < threads * per_producer) {
+                if (ring->TryPop(value)) {
+                    sum += value;
+                    ++consumed;
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (std::thread &worker : workers) worker.join();
+    long total = threads * per_producer;
+    BASKET_CHECK(consumed.load() == total);
+    BASKET_CHECK(sum.load() == total * (total + 1) / 2);
+    BASKET_CHECK(ring->Size() == 0);
+    scratch.segment.destroy_ptr(ring);
+}
+
+int main() {
+    TestSegment scratch("basket_ring_buffer_test", 16 * 1024 * 1024);
+    TestOrder(scratch);
+    TestThrowingSink(scratch);
+    TestConcurrent(scratch);
+    printf("ring_buffer_test passed\n");
+    return 0;
+}
@@ -0,0 +1,126 @@
+/*
+ * Copyright (C) 2019  Hariharan Devarajan, Keith Bateman
+ *
+ * This file is part of Basket
+ * 
+ * Basket is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <basket/common/roaring_set.h>
+#include <cstdint>
+#include <iterator>
+#include <random>
+#include <set>
+#include <vector>
+#include "unit_test.h"
+
+typedef boost::interprocess::managed_mapped_file::segment_manager SegmentManager;
+
+/* Draws keys from a dense run, which turns its containers into bitmaps, a
+   sparse spread over the whole key range, and the ends of the range. */
+template<typename KeyType>
+KeyType RandomKey(std::mt19937_64 &random, KeyType base) {
+    switch (random() % 8) {
+        case 0:
+            return std::numeric_limits<KeyType>::min() + static_cast<KeyType>(random() % 3);
+        case 1:
+            return std::numeric_limits<KeyType>::max() - static_cast<KeyType>(random() % 3);
+        case 2:
+        case 3:
+            return static_cast<KeyType>(random());
+        default:
+            return static_cast<KeyType>(base + static_cast<KeyType>(random() % 20000));
+    }
+}
+
+/* Inserts, erases, lookups, both iteration directions and range counts
+   agree with a std::set, as containers fill up, turn into bitmaps and
+   empty again. The tree CountInRange walks gives the same counts. */
+template<typename KeyType>
+void TestAgainstReference(TestSegment &scratch, const char *name, KeyType base,
+                          unsigned seed) {
+    typedef basket::RoaringSet<KeyType> Set;
+    typedef boost::interprocess::allocator<KeyType, SegmentManager> Allocator;
+    typedef boost::interprocess::set<KeyType, std::less<KeyType>, Allocator> Tree;
+    Set *keys = scratch.segment.construct<Set>(name)(std::less<KeyType>(),
+                                                     Allocator(scratch.Manager()));
+    Tree tree(std::less<KeyType>(), Allocator(scratch.Manager()));
+    std::set<KeyType> reference;
+    std::mt19937_64 random(seed);
+    for (int round = 0; round < 60000; ++round) {
+        KeyType key = RandomKey(random, base);
+        /* insert heavily first, then mostly erase, so containers go both ways */
+        bool inserting = round < 40000 ? random() % 4 != 0 : random() % 4 == 0;
+        if (inserting) {
+            auto inserted = keys->insert(key);
+            BASKET_CHECK(inserted.second == reference.insert(key).second);
+            BASKET_CHECK(*inserted.first == key);
+            tree.insert(key);
+        } else {
+            BASKET_CHECK(keys->erase(key) == reference.erase(key));
+            tree.erase(key);
+        }
+        BASKET_CHECK(keys->size() == reference.size());
+        BASKET_CHECK(keys->empty() == reference.empty());
+        KeyType probe = RandomKey(random, base);
+        BASKET_CHECK(keys->count(probe) == reference.count(probe));
+        BASKET_CHECK((keys->find(probe) != keys->end()) == (reference.count(probe) == 1));
+        auto lower = keys->lower_bound(probe);
+        auto expected_lower = reference.lower_bound(probe);
+        BASKET_CHECK((lower == keys->end()) == (expected_lower == reference.end()));
+        if (expected_lower != reference.end()) BASKET_CHECK(*lower == *expected_lower);
+        auto upper = keys->upper_bound(probe);
+        auto expected_upper = reference.upper_bound(probe);
+        BASKET_CHECK((upper == keys->end()) == (expected_upper == reference.end()));
+        if (expected_upper != reference.end()) BASKET_CHECK(*upper == *expected_upper);
+        if (round % 50 == 0) {
+            KeyType first = RandomKey(random, base), last = RandomKey(random, base);
+            size_t expected = last < first
+                              ? 0
+                              : std::distance(reference.lower_bound(first),
+                                              reference.upper_bound(last));
+            BASKET_CHECK(keys->count_range(first, last) == expected);
+            BASKET_CHECK(basket::CountInRange(*keys, first, last) == expected);
+            BASKET_CHECK(basket::CountInRange(tree, first, last) == expected);
+        }
+        if (round % 5000 == 0) {
+            BASKET_CHECK(std::vector<KeyType>(keys->begin(), keys->end()) ==
+                         std::vector<KeyType>(reference.begin(), reference.end()));
+            std::vector<KeyType> backwards;
+            for (auto it = keys->end(); it != keys->begin();) backwards.push_back(*--it);
+            BASKET_CHECK(std::vector<KeyType>(backwards.rbegin(), backwards.rend()) ==
+                         std::vector<KeyType>(reference.begin(), reference.end()));
+        }
+    }
+    /* erasing through iterators walks the rest in order */
+    for (auto it = keys->begin(); it != keys->end();) {
+        BASKET_CHECK(*it == *reference.begin());
+        reference.erase(reference.begin());
+        it = keys->erase(it);
+    }
+    BASKET_CHECK(keys->empty() && reference.empty());
+    scratch.segment.destroy_ptr(keys);
+}
+
+int main() {
+    TestSegment scratch("basket_roaring_set_test", 256 * 1024 * 1024);
+    for (unsigned seed = 0; seed < 3; ++seed) {
+        TestAgainstReference<int64_t>(scratch, "signed", -10000, seed);
+        TestAgainstReference<uint64_t>(scratch, "unsigned", 65000, seed);
+        TestAgainstReference<int32_t>(scratch, "narrow", -70000, seed);
+    }
+    printf("roaring_set_test passed\n");
+    return 0;
+}
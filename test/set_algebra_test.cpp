@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2019  Hariharan Devarajan, Keith Bateman
+ *
+ * This file is part of Basket
+ * 
+ * Basket is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <basket/common/set_algebra.h>
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <random>
+#include <set>
+#include <vector>
+#include "unit_test.h"
+
+/* Result of op on a and b as the standard algorithms compute it. */
+template<typename Compare>
+std::vector<int> Expected(SetOperation op, const std::set<int, Compare> &a,
+                          const std::set<int, Compare> &b) {
+    std::vector<int> result;
+    auto out = std::back_inserter(result);
+    switch (op) {
+        case SET_INTERSECTION:
+            std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), out, Compare());
+            break;
+        case SET_UNION:
+            std::set_union(a.begin(), a.end(), b.begin(), b.end(), out, Compare());
+            break;
+        case SET_DIFFERENCE:
+            std::set_difference(a.begin(), a.end(), b.begin(), b.end(), out, Compare());
+            break;
+    }
+    return result;
+}
+
+/* The walk visits the result in order, and a walk stopped after k visits
+   has seen exactly its first k elements. */
+template<typename Compare>
+void TestWalk(unsigned seed) {
+    std::mt19937 random(seed);
+    std::set<int, Compare> a, b;
+    size_t a_size = random() % 80, b_size = random() % 80;
+    int range = 1 + random() % 150;
+    for (size_t i = 0; i < a_size; ++i) a.insert(random() % range);
+    for (size_t i = 0; i < b_size; ++i) b.insert(random() % range);
+    for (SetOperation op : {SET_INTERSECTION, SET_UNION, SET_DIFFERENCE}) {
+        std::vector<int> expected = Expected(op, a, b);
+        std::vector<int> walked;
+        basket::SetMergeWalk(op, a.begin(), a.end(), b.begin(), b.end(), Compare(),
+                             [&walked](int value) {
+                                 walked.push_back(value);
+                                 return true;
+                             });
+        BASKET_CHECK(walked == expected);
+        size_t limit = random() % (expected.size() + 1);
+        std::vector<int> prefix;
+        basket::SetMergeWalk(op, a.begin(), a.end(), b.begin(), b.end(), Compare(),
+                             [&prefix, limit](int value) {
+                                 prefix.push_back(value);
+                                 return prefix.size() < limit;
+                             });
+        size_t seen = std::max<size_t>(limit, expected.empty() ? 0 : 1);
+        seen = std::min(seen, expected.size());
+        BASKET_CHECK(prefix.size() == seen);
+        BASKET_CHECK(std::equal(prefix.begin(), prefix.end(), expected.begin()));
+    }
+}
+
+int main() {
+    for (unsigned seed = 0; seed < 500; ++seed) {
+        TestWalk<std::less<int>>(seed);
+        TestWalk<std::greater<int>>(seed);
+    }
+    printf("set_algebra_test passed\n");
+    return 0;
+}
@@ -30,6 +30,7 @@
 #include <set>
 #include <basket/common/data_structures.h>
 #include <basket/set/set.h>
+#include "identity_placement.h"
 
 struct KeyType{
     size_t a;
@@ -76,6 +77,10 @@ namespace std {
         }
     };
 }
+namespace basket {
+    template<>
+    struct hash<KeyType> : IdentityPlacement<KeyType> {};
+}
 
 
 int main (int argc,char* argv[])
@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2019  Hariharan Devarajan, Keith Bateman
+ *
+ * This file is part of Basket
+ * 
+ * Basket is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/*-------------------------------------------------------------------------
+ *
+ * Created: unit_test.h
+ *
+ * Purpose: Defines the checks and the scratch segment of the single
+ * process tests of Basket's building blocks.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef BASKET_TEST_UNIT_TEST_H
+#define BASKET_TEST_UNIT_TEST_H
+
+#include <boost/interprocess/managed_mapped_file.hpp>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+/* Fail the test with the location of the first check that does not hold. */
+#define BASKET_CHECK(condition)                                              \
+    do {                                                                     \
+        if (!(condition)) {                                                  \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, \
+                    #condition);                                             \
+            exit(EXIT_FAILURE);                                              \
+        }                                                                    \
+    } while (0)
+
+/**
+ * Mapped segment backed by a file in /tmp, removed again when the test
+ * is done with it.
+ */
+class TestSegment {
+  private:
+    std::string path;
+
+  public:
+    boost::interprocess::managed_mapped_file segment;
+
+    TestSegment(const std::string &name, size_t size)
+            : path("/tmp/" + name), segment() {
+        boost::interprocess::file_mapping::remove(path.c_str());
+        segment = boost::interprocess::managed_mapped_file(
+            boost::interprocess::create_only, path.c_str(), size);
+    }
+
+    ~TestSegment() {
+        boost::interprocess::file_mapping::remove(path.c_str());
+    }
+
+    boost::interprocess::managed_mapped_file::segment_manager *Manager() {
+        return segment.get_segment_manager();
+    }
+};
+
+#endif  // BASKET_TEST_UNIT_TEST_H
@@ -31,6 +31,7 @@
 #include <unordered_map>
 #include <basket/common/data_structures.h>
 #include <basket/unordered_map/unordered_map.h>
+#include "identity_placement.h"
 
 struct KeyType{
     size_t a;
@@ -68,6 +69,10 @@ namespace std {
         }
     };
 }
+namespace basket {
+    template<>
+    struct hash<KeyType> : IdentityPlacement<KeyType> {};
+}
 
 
 int main (int argc,char* argv[])
@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2019  Hariharan Devarajan, Keith Bateman
+ *
+ * This file is part of Basket
+ * 
+ * Basket is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <basket/common/value_list.h>
+#include <boost/interprocess/allocators/allocator.hpp>
+#include <deque>
+#include <random>
+#include <vector>
+#include "unit_test.h"
+
+typedef boost::interprocess::allocator<
+    int, boost::interprocess::managed_mapped_file::segment_manager> Allocator;
+typedef basket::ValueList<int, Allocator> List;
+
+/* Appends, pushes and replacements of the oldest value keep the same
+   values in the same order as a deque, whether the list holds only its
+   inline value or has a long overflow that gets compacted. */
+void TestAgainstReference(TestSegment &scratch, unsigned seed) {
+    std::mt19937 random(seed);
+    int next = 0;
+    List *list = scratch.segment.construct<List>("list")(next, Allocator(scratch.Manager()));
+    std::deque<int> reference(1, next++);
+    for (int round = 0; round < 20000; ++round) {
+        switch (random() % 5) {
+            case 0:
+                list->push_back(next);
+                reference.push_back(next++);
+                break;
+            case 1: {
+                std::vector<int> block(random() % (round % 1000 == 0 ? 300 : 4));
+                for (int &value : block) value = next++;
+                list->append(block.begin(), block.end());
+                reference.insert(reference.end(), block.begin(), block.end());
+                break;
+            }
+            default:
+                list->replace_oldest(next);
+                reference.pop_front();
+                reference.push_back(next++);
+        }
+        BASKET_CHECK(list->size() == reference.size());
+        BASKET_CHECK(list->front() == reference.front());
+        if (round % 100 == 0) {
+            BASKET_CHECK(std::vector<int>(list->begin(), list->end()) ==
+                         std::vector<int>(reference.begin(), reference.end()));
+        }
+    }
+    scratch.segment.destroy_ptr(list);
+}
+
+/* A key that only ever holds one value never touches its overflow. */
+void TestSingleValue(TestSegment &scratch) {
+    List *list = scratch.segment.construct<List>("single")(0, Allocator(scratch.Manager()));
+    size_t free_memory = scratch.segment.get_free_memory();
+    for (int value = 1; value <= 1000; ++value) {
+        list->replace_oldest(value);
+        BASKET_CHECK(list->size() == 1 && list->front() == value);
+    }
+    BASKET_CHECK(scratch.segment.get_free_memory() == free_memory);
+    BASKET_CHECK(std::vector<int>(list->begin(), list->end()) == std::vector<int>(1, 1000));
+    scratch.segment.destroy_ptr(list);
+}
+
+int main() {
+    TestSegment scratch("basket_value_list_test", 16 * 1024 * 1024);
+    for (unsigned seed = 0; seed < 20; ++seed) TestAgainstReference(scratch, seed);
+    TestSingleValue(scratch);
+    printf("value_list_test passed\n");
+    return 0;
+}